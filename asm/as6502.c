@@ -2,1300 +2,925 @@
 /* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
 
 /* Modification:
- * 1983-06-16 JRH Initial coding (in Ratfor)
- * 1999-08-18 JRH Added hex format options
- * 1999-08-20 JRH Fixed error-checking in 'convert'
- * 1999-08-21 JRH Fixed error-checking in directives
- * 1999-08-22 JRH Added check for current address beyond $FFFF
- * 1999-08-22 JRH Fixed accumulator-mode syntax: ASL A
- * 2000-01-28 JRH Added cycle counts
- * 2000-02-01 JRH Changed behaviour of listing for EQU directives
- * 2000-02-02 JRH Improved handling of erroneous input
- * 2000-02-15 JRH Made lower-case A, X and Y registers legal
- * 2000-02-17 JRH Made mnemonics and directives case-insensitive
- * 2000-06-21 JRH Made assembler return non-zero exit status on error
- * 2000-06-28 JRH Generate code when address bad, to maintain code size
- * 2023-10-25 JRH Add EOF record to checksum hex output file
- * 2023-10-25 JRH Protect against filling up symbol table and detect duplicate labels
+ * 2026-10-17 agent Split from the assembler proper, which is now libas6502
+ * 2026-10-17 agent Batch mode, assembling many files on a pool of threads
+ * 2026-10-17 agent Server mode on a Unix socket, and pre-loaded definition files
+ * 2026-10-17 agent Pass source file names on, for INCLUDE files and diagnostics
+ * 2026-10-17 agent Relaxation option, -R
+ * 2026-10-17 agent Timing summary option, -c
  */
- 
-/* #define DB */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
 #include "as6502.h"
-
-#define AREG(c) (((c) == 'A') || ((c) == 'a'))
-#define XREG(c) (((c) == 'X') || ((c) == 'x'))
-#define YREG(c) (((c) == 'Y') || ((c) == 'y'))
-
-int     Errs,              /* Error counter */
-        Pass,              /* Pass 1 or 2 */
-        Nline,             /* Line number */
-        Nlabels,           /* Number of labels */
-        Hexfmt,            /* Type of hex file */
-        Nbytes;            /* Number of bytes for current instruction */
-address Addr;              /* Current assembly address */
-
-FILE    *Source,            /* Source code fp */
-        *Object,            /* Object code fp */
-        *Listing,           /* Listing fp */ 
-        *Errorfd;           /* Error list fp */
-
-struct Sym {
-   char    Label[MAXLABEL];   /* Label name      */
-   address Address;           /* Label address   */
-   int     References;        /* Reference count */
+#include "libas6502.h"
+
+struct Job {                     /* One source file in batch mode */
+   char    *Source;              /* File names */
+   char    *Object;
+   char    *Listing;
+   int     Errs;                 /* Number of errors */
+   char    *Msgs;                /* Error and warning messages */
+   size_t  Msglen;
 };
 
-struct Sym Symbol[MAXSYMBOLS];   /* The symbol table */
-
-char      Line[MAXLINE];         /* Text of current line */
-
-int     Byte[MAXBYTES],          /* Bytes of current instruction */
-        Block[MAXBLOCK],         /* Checksum block for 'save' */
-        Blkptr,                  /* Pointer to next space in Block */
-        Nblocks;                 /* Number of blocks of checksum data */
-address Blkaddr;                 /* Start address of block */
-
-/* inh, imm, abs, abs,X, abs,Y, zpage, zpage,X, zpage,Y, ind,X, ind,Y, rel, ind */
-
-struct {
-   char mnem[4];
-   int flags;
-   int obj[MAXMODES];
-   int cyc[MAXMODES];
-} Opcodes[] = {
-   {"ADC", 1,
-   { ERR, 0x69, 0x6D, 0x7D, 0x79, 0x65, 0x75,  ERR, 0x61, 0x71,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"AND", 1,
-   { ERR, 0x29, 0x2D, 0x3D, 0x39, 0x25, 0x35,  ERR, 0x21, 0x31,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"ASL", 0,
-   {0x0A,  ERR, 0x0E, 0x1E,  ERR, 0x06, 0x16,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"BCC", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x90,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BCS", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xB0,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BEQ", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xF0,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BIT", 0,
-   { ERR,  ERR, 0x2C,  ERR,  ERR, 0x24,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
-   {"BMI", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x30,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BNE", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xD0,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BPL", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x10,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BRK", 0,
-   {0x00,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   7,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"BVC", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x50,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"BVS", 0,
-   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x70,  ERR},
-   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
-   {"CLC", 0,
-   {0x18,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"CLD", 0,
-   {0xD8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"CLI", 0,
-   {0x58,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"CLV", 0,
-   {0xB8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"CMP", 0,
-   { ERR, 0xC9, 0xCD, 0xDD, 0xD9, 0xC5, 0xD5,  ERR, 0xC1, 0xD1,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"CPX", 0,
-   { ERR, 0xE0, 0xEC,  ERR,  ERR, 0xE4,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    2,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
-   {"CPY", 0,
-   { ERR, 0xC0, 0xCC,  ERR,  ERR, 0xC4,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    2,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
-   {"DEC", 0,
-   { ERR,  ERR, 0xCE, 0xDE,  ERR, 0xC6, 0xD6,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"DEX", 0,
-   {0xCA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"DEY", 0,
-   {0x88,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"EOR", 1,
-   { ERR, 0x49, 0x4D, 0x5D, 0x59, 0x45, 0x55,  ERR, 0x41, 0x51,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"INC", 0,
-   { ERR,  ERR, 0xEE, 0xFE,  ERR, 0xE6, 0xF6,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"INX", 0,
-   {0xE8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"INY", 0,
-   {0xC8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"JMP", 0,
-   { ERR,  ERR, 0x4C,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x6C},
-   {   0,    0,    3,    0,    0,    0,    0,    0,    0,    0,    0,    5}},
-   {"JSR", 0,
-   { ERR,  ERR, 0x20,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    6,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"LDA", 1,
-   { ERR, 0xA9, 0xAD, 0xBD, 0xB9, 0xA5, 0xB5,  ERR, 0xA1, 0xB1,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"LDX", 1,
-   { ERR, 0xA2, 0xAE,  ERR, 0xBE, 0xA6,  ERR, 0xB6,  ERR,  ERR,  ERR,  ERR},
-   {   0,    2,    4,    0,    4,    3,    0,    4,    0,    0,    0,    0}},
-   {"LDY", 1,
-   { ERR, 0xA0, 0xAC, 0xBC,  ERR, 0xA4, 0xB4,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    2,    4,    4,    0,    3,    4,    0,    0,    0,    0,    0}},
-   {"LSR", 0,
-   {0x4A,  ERR, 0x4E, 0x5E,  ERR, 0x46, 0x56,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"NOP", 0,
-   {0xEA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"ORA", 0,
-   { ERR, 0x09, 0x0D, 0x1D, 0x19, 0x05, 0x15,  ERR, 0x01, 0x11,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"PHA", 0,
-   {0x48,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   3,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"PHP", 0,
-   {0x08,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   3,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"PLA", 0,
-   {0x68,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   4,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"PLP", 0,
-   {0x28,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   4,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"ROL", 0,
-   {0x2A,  ERR, 0x2E, 0x3E,  ERR, 0x26, 0x36,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"ROR", 0,
-   {0x6A,  ERR, 0x6E, 0x7E,  ERR, 0x66, 0x76,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
-   {"RTI", 0,
-   {0x40,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   6,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"RTS", 0,
-   {0x60,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   6,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"SBC", 1,
-   { ERR, 0xE9, 0xED, 0xFD, 0xF9, 0xE5, 0xF5,  ERR, 0xE1, 0xF1,  ERR,  ERR},
-   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
-   {"SEC", 0,
-   {0x38,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"SED", 0,
-   {0xF8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"SEI", 0,
-   {0x78,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"STA", 0,
-   { ERR,  ERR, 0x8D, 0x9D, 0x99, 0x85, 0x95,  ERR, 0x81, 0x91,  ERR,  ERR},
-   {   0,    0,    4,    5,    5,    3,    4,    0,    6,    6,    0,    0}},
-   {"STX", 0,
-   { ERR,  ERR, 0x8E,  ERR,  ERR, 0x86,  ERR, 0x96,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    4,    0,    0,    3,    0,    4,    0,    0,    0,    0}},
-   {"STY", 0,
-   { ERR,  ERR, 0x8C,  ERR,  ERR, 0x84, 0x94,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   0,    0,    4,    0,    0,    3,    4,    0,    0,    0,    0,    0}},
-   {"TAX", 0,
-   {0xAA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"TAY", 0,
-   {0xA8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"TSX", 0,
-   {0xBA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"TXA", 0,
-   {0x8A,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"TXS", 0,
-   {0x9A,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
-   {"TYA", 0,
-   {0x98,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
-   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}}
-};
+int     Onepass,                 /* Options, for every context */
+        Relax,
+        Timing,
+        Hexfmt,
+        Trim,
+        Fill,
+        Reclen;
+
+struct Job *Job;                 /* Batch of source files */
+long    Njobs,                   /* Number of files in batch */
+        Maxjobs,                 /* Allocated size of Job */
+        Nextjob;                 /* Next one for a worker to pick up */
+pthread_mutex_t Joblock = PTHREAD_MUTEX_INITIALIZER;
+
+struct Asm **Idle;               /* Server contexts with no connection */
+int     Nidle,
+        Maxidle;
+pthread_mutex_t Idlelock = PTHREAD_MUTEX_INITIALIZER;
+
+char    *Predef[MAXPREDEF];      /* Text of definition files, pre-loaded into every context */
+long    Predlen[MAXPREDEF];
+const char *Predname[MAXPREDEF];
+int     Npredefs;
 
 #ifdef __STDC__
 int main (int argc, const char * *argv);
-void chop_up (const char *lin, char *label, char *mnem, char *operand, char *comment);
-int assemble (const char *mnem, const char *oper, char *cycles);
-void instruction (int mn, const char *oper, char *cycles);
-int operand (const char *oper, int *modep, address *opp);
-int valid_symbol (const char *label);
-int add_symbol (const char *label, address addr);
-void symbols (void);
-int look_up (const char *mnem);
-int opcode_for (int mn, int *modep, address *opp, char *cycles);
-void directive (int dir, const char *oper);
-int eval (const char *str, address *nump);
-int evaluate (const char *str, int *ip, address *nump);
-int convert (const char *str, int *ip, address *nump);
-int sym (const char *str, int *ip, address *nump);
-void nerd (const char *str);
-void for_ref (const char *str);
-void unused (const char *str);
-void set_up (int argc, const char * *argv);
-void list_it (const char *cycles, const char *label, const char *mnem, int mn, const char *oper, const char *comment);
-void putbyte (int byte);
-void putblock (void);
-void puteof (void);
+void configure (struct Asm *as);
+char *slurp (const char *path, long *lenp);
+int serve (const char *path);
+void *client (void *arg);
+struct Asm *get_context (void);
+void put_context (struct Asm *as);
+int readall (int fd, void *buf, long n);
+int writeall (int fd, const void *buf, long n);
+int writevall (int fd, struct iovec *iov, int niov);
+void put32 (unsigned char *p, unsigned long val);
+unsigned long get32 (const unsigned char *p);
+void add_job (const char *source, const char *object, const char *listing);
+void read_manifest (const char *path);
+char *outname (const char *source, const char *ext);
+int batch (int nthreads);
+void *worker (void *arg);
+void do_job (struct Asm *as, struct Job *j);
+void *grow_jobs (void);
+void usage (void);
 void cant (const char *path, int bomb);
-address gctol (const char *str, int *ip, int base);
 #else
 #define const
 int main ();
-void chop_up ();
-int assemble ();
-void instruction ();
-int operand ();
-int valid_symbol ();
-int add_symbol ();
-void symbols ();
-int look_up ();
-int opcode_for ();
-void directive ();
-int eval ();
-int evaluate ();
-int convert ();
-int sym ();
-void nerd ();
-void for_ref ();
-void unused ();
-void set_up ();
-void list_it ();
-void putbyte ();
-void putblock ();
-void puteof ();
+void configure ();
+char *slurp ();
+int serve ();
+void *client ();
+struct Asm *get_context ();
+void put_context ();
+int readall ();
+int writeall ();
+int writevall ();
+void put32 ();
+unsigned long get32 ();
+void add_job ();
+void read_manifest ();
+char *outname ();
+int batch ();
+void *worker ();
+void do_job ();
+void *grow_jobs ();
+void usage ();
 void cant ();
-address gctol ();
 #endif   /* __STDC__ */
 
-void strupr (char *s);
-
 int main (argc, argv)
 const int argc;
 const char *argv[];
 {
-   char label[MAXLABEL], mnem[MAXMNEM];
-   char oper[MAXOPER], comment[MAXCOMMENT];
-   char cycles[MAXCYCSTR];
-   int i;
-   int mn;
    static char vers[] = "2.1";
+   struct Asm *as;
+   FILE *source, *object, *listing;
+   int errs;
+   int a;
+   int nthreads;
+   const char *manifest;
+   const char *sockpath;
+   char *end;
+   long n;
+
+   Onepass  = NO;
+   Relax    = NO;
+   Timing   = NO;
+   Hexfmt   = MOS_HEX;
+   Trim     = NO;
+   Fill     = 0xff;
+   Reclen   = BYTES_PER_BLOCK;
+   nthreads = ERR;            /* Not in batch mode */
+   manifest = NULL;
+   sockpath = NULL;
+   Npredefs = 0;
+
+   for (a = 1; a < argc && argv[a][0] == '-' && argv[a][1] != EOS; a++) {
+      switch (argv[a][1]) {
+      case '1':
+         Onepass = YES;    /* Single pass, fixing up forward references */
+         break;
+      case 'c':
+         Timing = YES;     /* Cycle counts after the symbol table */
+         break;
+      case 'R':
+         Relax = YES;      /* Shrink forward references, stretch long branches */
+         break;
+      case 'b':
+         Hexfmt = BIN_IMAGE;     /* Full 64K binary image */
+         break;
+      case 't':
+         Hexfmt = BIN_IMAGE;     /* Binary image, lowest to highest address used */
+         Trim = YES;
+         break;
+      case 'f':
+         if (++a >= argc)
+            usage ();
 
-   set_up (argc, argv);    /* Set up files & globals */
-   Pass = 1;               /* First pass */
+         n = strtol (argv[a], &end, 0);
+         if (end == argv[a] || *end != EOS || n < 0 || n > 0xff)
+            usage ();
+
+         Fill = n;
+         break;
+      case 's':
+         Hexfmt = SREC_HEX;      /* Motorola S19 */
+         break;
+      case 'i':
+         Hexfmt = INTEL_HEX;
+         break;
+      case 'r':
+         if (++a >= argc)
+            usage ();
+
+         Reclen = strtol (argv[a], NULL, 0);
+         if (Reclen < 1 || Reclen > MAXBLOCK) {
+            fprintf (stderr, "Record length must be 1 to %d bytes\n", MAXBLOCK);
+            exit (1);
+         }
+         break;
+      case 'j':
+         if (++a >= argc)
+            usage ();
 
-   while (fgets (Line, MAXLINE, Source) != NULL) { /* Pass 1 */
-      Nline++;
-      Nbytes = 0;
-      cycles[0] = EOS;
-#ifdef DB
-      fprintf (stderr, "%4d: %s", Nline, Line);
-#endif   /* DB */
+         nthreads = strtol (argv[a], NULL, 0);   /* Zero means one per processor */
+         if (nthreads < 0)
+            usage ();
+         break;
+      case 'm':
+         if (++a >= argc)
+            usage ();
 
-      chop_up (Line, label, mnem, oper, comment);
+         manifest = argv[a];
+         if (nthreads == ERR)
+            nthreads = 0;
+         break;
+      case 'p':
+         if (++a >= argc || Npredefs >= MAXPREDEF)
+            usage ();
 
-      if (label[0] != EOS) {     /* Fill in the Symbol Table */
-         if (valid_symbol (label) == OK)
-            if (add_symbol (label, Addr) == ERR)
-               nerd ("Duplicate label");
-      }     
+         Predname[Npredefs] = argv[a];
+         Predef[Npredefs] = slurp (argv[a], &Predlen[Npredefs]);
+         Npredefs++;
+         break;
+      case 'S':
+         if (++a >= argc)
+            usage ();
 
-      if (mnem[0] != EOS) {      /* Ignore comment lines */
-         if (assemble (mnem, oper, cycles) == ERR)
-            nerd ("Unfroodish mnemonic");
+         sockpath = argv[a];
+         break;
+      default:
+         usage ();
       }
-
-      Addr += ADDR(Nbytes);
    }
 
-   rewind (Source);     /* rewind source file for second pass */
-   Nline = 0;           /* reset line number counter */
-   Nblocks = 0;         /* Reset hex block counter */
-   Pass = 2;            /* Second pass */
-   Addr  = ADDR(0);     /* reset current address pointer */
+   if (sockpath != NULL)
+      return (serve (sockpath));
 
-   while (fgets (Line, MAXLINE, Source) != NULL) { /* Pass 2 */
-      Nline++;
-      Nbytes = 0;
-      cycles[0] = EOS;
-      mn = ERR;
+   if (nthreads != ERR) {     /* Batch mode: every other argument is a source file */
+      if (manifest != NULL)
+         read_manifest (manifest);
 
-      chop_up (Line, label, mnem, oper, comment);
+      for ( ; a < argc; a++)
+         add_job (argv[a], NULL, NULL);
 
-      if (mnem[0] != EOS)     /* Ignore comments */
-         mn = assemble (mnem, oper, cycles);
+      if (nthreads == 0)
+         nthreads = sysconf (_SC_NPROCESSORS_ONLN);
 
-      if (mn != ERR) {
-         for (i = 0; i < Nbytes; i++)
-            putbyte (Byte[i]);
-      }
+      errs = batch (nthreads);
+
+      fprintf (TTY, "%04d ERRORS in %ld files [6502 ASSEMBLER Rev.%s]\n", errs, Njobs, vers);
+
+      return (errs == 0 ? 0 : 1);
+   }
+
+   /* Remaining arguments are the file names */
+
+   if (argc > a) {
+      source = fopen (argv[a], READ);
+      if (source == NULL)
+         cant (argv[a], YES);
+   }
+   else
+      source = stdin;
+
+   if (argc > a + 1) {
+      object = fopen (argv[a + 1], (Hexfmt == BIN_IMAGE) ? WRITEBIN : WRITE);
+      if (object == NULL)
+         cant (argv[a + 1], YES);
+   }
+   else
+      object = stdout;
+
+   if (argc > a + 2) {
+      listing = fopen (argv[a + 2], WRITE);
+      if (listing == NULL)
+         cant (argv[a + 2], YES);
+   }
+   else
+      listing = stdout;
 
-      list_it (cycles, label, mnem, mn, oper, comment);
-      Addr += ADDR(Nbytes);
+   as = as_new ();
+   if (as == NULL) {
+      fputs ("as6502: out of memory\n", stderr);
+      exit (1);
    }
 
-   if (Blkptr != 0)
-      putblock ();   /* Put out the last block of hex. */
-   
-   puteof ();  /* Write EOF marker */
-   
-   symbols ();
+   configure (as);
+   as_source_name (as, argc > a ? argv[a] : NULL);
+   errs = as_file (as, source, object, listing, stderr);
+
+   fprintf (TTY, "%04d ERRORS [6502 ASSEMBLER Rev.%s]\n", errs, vers);
 
-   fprintf (TTY, "%04d ERRORS [6502 ASSEMBLER Rev.%s]\n", Errs, vers);
+   as_free (as);
 
-   if (Errs == 0)
+   if (errs == 0)
       return (0);
    else
       return (1);
 }
 
 
-/* chop_up --- chop up the source line */
+/* configure --- apply the command line options to an assembler context */
 
-void chop_up (lin, label, mnem, operand, comment)
-const char lin[];
-char label[], mnem[], operand[], comment[];
+void configure (as)
+struct Asm *as;
 {
    int i, j;
 
-   label[0]   = EOS;
-   mnem[0]    = EOS;
-   operand[0] = EOS;
-   comment[0] = EOS;
+   as_option (as, OPT_ONEPASS, Onepass);
+   as_option (as, OPT_FORMAT, Hexfmt);
+   as_option (as, OPT_TRIM, Trim);
+   as_option (as, OPT_FILL, Fill);
+   as_option (as, OPT_RECLEN, Reclen);
+   as_option (as, OPT_RELAX, Relax);
+   as_option (as, OPT_TIMING, Timing);
 
-   if (lin[0] == NEWLINE)     /* Blank line */
-      return;
-   else if (lin[0] == COMMENT_SYM) {   /* Entire line is a comment */
-      for (i = 0; lin[i] != NEWLINE; i++)
-         comment[i] = lin[i];
+   for (i = 0; i < Npredefs; i++) {
+      as_source_name (as, Predname[i]);   /* For its INCLUDE files */
 
-      comment[i] = EOS;
-      return;
-   }
+      if (as_predefine (as, Predef[i], Predlen[i]) != 0) {
+         fprintf (stderr, "%s: errors in definitions:\n", Predname[i]);
 
-   for (i = j = 0; (lin[i] != ' ') && (lin[i] != LABEL_SYM) && (lin[i] != NEWLINE); i++)
-      if (i < (MAXLABEL - 1))    /* Truncate excessively long labels */
-         label[j++] = lin[i];
-
-   label[j] = EOS;
-   
-   if (i != j)
-      fprintf (Errorfd, "Warning: %s: label truncated at %d characters\n", label, MAXLABEL - 1);
-   
-   if (lin[i] == LABEL_SYM)   /* Skip the colon if there was one */
-      i++;
-   
-   SKIPBL(lin, i);   /* Skip blanks between label and mnemonic */
-
-   if (lin[i] != COMMENT_SYM) {
-      for (j = 0; lin[i] != ' ' && lin[i] != NEWLINE; i++)
-         if (j < (MAXMNEM - 1))
-            mnem[j++] = lin[i];    /* Grab mnemonic */
-
-      mnem[j] = EOS;
-   }
-   else
-      mnem[0] = EOS;
-
-   while (lin[i] == ' ' && lin[i] != NEWLINE)  /* Skip blanks between mnemonic and operand */
-      i++;
-
-   if (lin[i] != COMMENT_SYM && lin[i] != NEWLINE) {
-      if (lin[i] == '"' || lin[i] == '\'') {   /* Allow for quoted operands */
-         const char quote = lin[i];    /* terminating character */
-         operand[0] = quote;
-         i++;           /* Skip the opening quote */
-         for (j = 1; lin[i] != quote && lin[i] != NEWLINE ; i++)
-            if (j < (MAXOPER - 2))
-               operand[j++] = lin[i]; /* Grab operand */
-
-         operand[j++] = quote;
-         operand[j] = EOS;
-         i++;
-         SKIPBL(lin, i);
+         for (j = 0; j < as_ndiags (as); j++)
+            fprintf (stderr, "%s\n", as_diag (as, j)->Msg);
+
+         exit (1);
       }
-      else {   /* Normal operand - not quoted */
-         for (j = 0; lin[i] != ' ' && lin[i] != NEWLINE; i++)
-            if (j < (MAXOPER - 1))
-               operand[j++] = lin[i]; /* Grab operand */
+   }
+
+   as_source_name (as, NULL);
+}
 
-         operand[j] = EOS;
 
-         while (lin[i] == ' ' && lin[i] != NEWLINE)
-            i++;
+/* slurp --- read the whole of a file into memory */
+
+char *slurp (path, lenp)
+const char *path;
+long *lenp;
+{
+   FILE *fp;
+   char *buf;
+   long max;
+   size_t n;
+
+   if ((fp = fopen (path, READ)) == NULL)
+      cant (path, YES);
+
+   buf = NULL;
+   max = 0L;
+   *lenp = 0L;
+
+   do {
+      if (*lenp + BUFSIZ > max) {
+         max = (max == 0L) ? (BUFSIZ * 4L) : max * 2L;
+         buf = realloc (buf, max);
+         if (buf == NULL) {
+            fputs ("as6502: out of memory\n", stderr);
+            exit (1);
+         }
       }
-   }
 
-   for (j = 0; lin[i] != NEWLINE; i++, j++)
-      comment[j] = lin[i];
+      n = fread (buf + *lenp, sizeof (char), max - *lenp, fp);
+      *lenp += n;
+   } while (n > 0);
 
-   comment[j] = EOS;
+   fclose (fp);
+
+   return (buf);
 }
 
 
-/* assemble --- do a line of assembly */
+/* serve --- assemble requests arriving on a Unix socket, for ever */
 
-int assemble (mnem, oper, cycles)
-const char mnem[], oper[];
-char cycles[];
+int serve (path)
+const char *path;
 {
-   int mn;
-      
-   if (Addr > 0xffffL)
-      nerd ("Current address beyond $FFFF");
+   struct sockaddr_un sa;
+   pthread_attr_t attr;
+   pthread_t tid;
+   int lfd, fd;
 
-   mn = look_up (mnem);
+   if (strlen (path) >= sizeof (sa.sun_path)) {
+      fprintf (stderr, "%s: socket path too long\n", path);
+      return (1);
+   }
 
-   if (mn == ERR)       /* Ignore illegal mnemonics */
-      return (mn);
+   put_context (get_context ());    /* Check the definitions before taking requests */
 
-   if (IS_DIRECTIVE(mn)) { /* Sort out directives */
-      directive (mn, oper);
-      cycles[0] = EOS;
+   memset (&sa, 0, sizeof (sa));
+   sa.sun_family = AF_UNIX;
+   strcpy (sa.sun_path, path);
+
+   unlink (path);    /* Left over from last time */
+
+   if ((lfd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+       bind (lfd, (struct sockaddr *)&sa, sizeof (sa)) < 0 ||
+       listen (lfd, 16) < 0) {
+      perror (path);
+      return (1);
    }
-   else
-      instruction (mn, oper, cycles);
-      
-   return (mn);
-}
 
+   signal (SIGPIPE, SIG_IGN);    /* Client went away: just drop it */
 
-/* instruction --- handle instructions */
+   pthread_attr_init (&attr);
+   pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
 
-void instruction (mn, oper, cycles)
-const int mn;
-const char oper[];
-char cycles[];
-{
-   int mode;
-   address op;
-
-   if (operand (oper, &mode, &op) != ERR) {
-      Byte[0] = opcode_for (mn, &mode, &op, cycles);  /* Work out opcode */
-      if (Byte[0] == ERR)
-         nerd ("Illegal instruction/address mode");
-
-      switch (mode) {
-      case INHERENT:
-         Nbytes = 1;
-         break;         /* No address bytes */
-      case RELATIVE:
-         Byte[1] = NUM(op & 0xff);
-         Nbytes = 2;
-         break;
-      case IMMEDIATE:
-      case Z_PAGE:
-      case Z_INDEX_X:
-      case Z_INDEX_Y:
-      case INDIRECT_X:
-      case INDIRECT_Y:
-         if (op > 0xff) {
-            nerd ("operand too big");
-            Byte[1] = 0xff;
-         }
-         else
-            Byte[1] = NUM(op & 0xff);
+   for (;;) {
+      if ((fd = accept (lfd, NULL, NULL)) < 0)
+         continue;
 
-         Nbytes = 2;
-         break;
-      case ABSOLUTE:
-      case INDEX_X:
-      case INDEX_Y:
-      case INDIRECT:
-         Byte[1] = NUM(op & 0xff);
-         Byte[2] = NUM(op / 256);
-         Nbytes = 3;
-         break;
-      default:
-         fprintf (stderr, "%d: bad mode\n", mode);
-         /* Falls through */
-      case ERR:
-         Nbytes = 0;
-         cycles[0] = EOS;
-         break;
+      /* Each connection on a thread of its own, so that an idle one holds up nobody */
+      if (pthread_create (&tid, &attr, client, (void *)(long)fd) != 0) {
+         fputs ("as6502: can't start thread\n", stderr);
+         close (fd);
       }
    }
 }
 
 
-/* operand --- sort out the operand and address mode */
+/* client --- assemble the requests on one connection until it is closed */
 
-int operand (oper, modep, opp)
-const char oper[];
-int *modep;
-address *opp;
+void *client (arg)
+void *arg;
 {
-   int mode;
+   int fd = (int)(long)arg;
+   struct Asm *as;
+   struct iovec iov[4];
+   unsigned char hdr[16];
+   unsigned long len, namelen;
+   char name[MAXPATH + 1];
+   char *src;
+   unsigned long maxsrc;
+   FILE *msgs;
+   char *msgtext;
+   size_t msglen, objlen, lstlen;
+   const struct Diag *d;
+   int errs;
    int i;
-   int stat;
 
-   mode = ERR;          /* Guilty until proven innocent... */
-   stat = ERR;
+   as = get_context ();
 
-   if ((oper[0] == EOS) || (AREG(oper[0]) && (oper[1] == EOS))) {
-      mode = INHERENT;
-      stat = OK;
-      *modep = mode;
-      return (OK);
-   }
-   else if (oper[0] == IMM_SYM) {
-      mode = IMMEDIATE;
-      i = 1;            /* Skip the '#'... */
-      stat = evaluate (oper, &i, opp);
-   }
-   else if (oper[0] == INDIRECT_SYM) {
-      i = 1;
-      stat = evaluate (oper, &i, opp);
-      if (oper[i] == INDEX_SYM && XREG(oper[i+1]) &&
-          oper[i+2] == INDIRECT_END && oper[i+3] == EOS) {
-         i += 3;
-         mode = INDIRECT_X;      /* LDA (PTR,X) */
-      }
-      else if (oper[i] == INDIRECT_END && oper[i+1] == INDEX_SYM &&
-               YREG(oper[i+2]) && oper[i+3] == EOS) {
-         i += 3;
-         mode = INDIRECT_Y;      /* LDA (PTR),Y */
-      }                   
-      else if (oper[i] == INDIRECT_END && oper[i+1] == EOS) {
-         i++;   
-         mode = INDIRECT;        /* JMP (PTR) */
+   src = NULL;
+   maxsrc = 0UL;
+   msgtext = NULL;
+   msglen = 0;
+
+   /* Any number of requests per connection: lengths of name and source, then their text */
+   while (readall (fd, hdr, 8) == OK) {
+      namelen = get32 (hdr);
+      len = get32 (hdr + 4);
+
+      if (len > MAXSOURCE || namelen > MAXPATH) {    /* Don't let one client eat all the memory */
+         fprintf (stderr, "as6502: %lu byte request refused\n", len + namelen);
+         break;
       }
-      else
-         mode = ERR;
-   }
-   else {
-      i = 0;
-      stat = evaluate (oper, &i, opp);
-      if (oper[i] == INDEX_SYM) {
-         if (XREG(oper[i+1]) && oper[i+2] == EOS) {
-            i += 2;
-            mode = INDEX_X;   /* LDA TAB,X */
-         }
-         else if (YREG(oper[i+1]) && oper[i+2] == EOS) {
-            i += 2;
-            mode = INDEX_Y;   /* LDA TAB,Y */
+
+      if (readall (fd, name, namelen) != OK)
+         break;
+
+      name[namelen] = EOS;
+      as_source_name (as, (namelen > 0) ? name : NULL);    /* For its INCLUDE files */
+
+      if (len > maxsrc) {
+         maxsrc = len;
+         src = realloc (src, maxsrc);
+         if (src == NULL) {
+            fputs ("as6502: out of memory\n", stderr);
+            exit (1);
          }
-         else
-            mode = ERR;
       }
-      else
-         mode = ABSOLUTE;     /* LDA ABS */
-   }
-   
-#ifdef DB
-   fprintf (stderr, "stat = %d, mode = %d, i = %d\n", stat, mode, i);
-#endif
 
-   *modep = mode;
+      if (readall (fd, src, len) != OK)
+         break;
 
-   if ((stat == ERR) && PASS2) {
-      nerd ("Undefined label");
-      *opp = (address)0xffff;    /* Dummy address */
-      return (OK); /* Allow code generation anyway */
-   }
+      errs = as_buffer (as, src, len);
+
+      msgs = open_memstream (&msgtext, &msglen);
+      if (msgs == NULL) {
+         fputs ("as6502: out of memory\n", stderr);
+         exit (1);
+      }
+
+      for (i = 0; i < as_ndiags (as); i++) {
+         d = as_diag (as, i);
+         fprintf (msgs, "%s\n", d->Msg);
+         if (d->Text != NULL)
+            fprintf (msgs, "%s\n", d->Text);
+      }
+
+      fclose (msgs);
+
+      /* Reply: error count and three lengths, then object, listing and messages */
+      iov[1].iov_base = (void *)as_object (as, &objlen);
+      iov[1].iov_len = objlen;
+      iov[2].iov_base = (void *)as_listing (as, &lstlen);
+      iov[2].iov_len = lstlen;
+      iov[3].iov_base = msgtext;
+      iov[3].iov_len = msglen;
+
+      put32 (hdr, errs);
+      put32 (hdr + 4, objlen);
+      put32 (hdr + 8, lstlen);
+      put32 (hdr + 12, msglen);
+      iov[0].iov_base = hdr;
+      iov[0].iov_len = sizeof (hdr);
+
+      if (writevall (fd, iov, 4) != OK) {
+         free (msgtext);
+         msgtext = NULL;
+         break;
+      }
 
-   if (PASS1 && (mode == ERR || oper[i] != EOS)) {
-      nerd ("Bad syntax in operand");  /* Look for extra characters at end of line */
-      return (ERR);
+      free (msgtext);
+      msgtext = NULL;
    }
 
-   return (OK);
+   close (fd);
+   free (src);
+   put_context (as);
+
+   return (NULL);
 }
 
 
-/*  valid_symbol --- test a label for invalid characters */
+/* get_context --- take an idle server context, or make a new one */
 
-int valid_symbol (label)
-const char label[];
+struct Asm *get_context ()
 {
-   int i;
-   
-   if (isdigit (label[0])) {
-      nerd ("Label names must not begin with a digit");
-      return (ERR);
-   }
-   
-   for (i = 0; label[i] != EOS; i++) {
-      if (!(isalpha (label[i]) || isdigit (label[i]) || (label[i] == '_'))) {
-         nerd ("Invalid character(s) in label name");
-         return (ERR);
+   struct Asm *as;
+
+   pthread_mutex_lock (&Idlelock);
+   as = (Nidle > 0) ? Idle[--Nidle] : NULL;
+   pthread_mutex_unlock (&Idlelock);
+
+   if (as == NULL) {
+      as = as_new ();
+      if (as == NULL) {
+         fputs ("as6502: out of memory\n", stderr);
+         exit (1);
       }
+
+      configure (as);
    }
-   
-   if (AREG(label[0]) && (label[1] == EOS)) {
-      nerd ("Labels may not be named 'A' or 'a'");
-      return (ERR);
-   }
-   
-   return (OK);
+
+   return (as);
 }
 
 
-/* add_symbol --- add a symbol to the symbol table */
+/* put_context --- keep a server context, warm, for the next connection */
 
-int add_symbol (label, addr)
-const char label[];
-const address addr;
+void put_context (as)
+struct Asm *as;
 {
-   int i;
-   
-#ifdef DB
-   fprintf (stderr, "add_symbol: label = '%s'\n", label);
-#endif
-   
-   if (Nlabels >= (MAXSYMBOLS - 1)) {
-      nerd ("Too many labels");
-      exit (1);
-   }
-   
-   for (i = 0; i < Nlabels; i++) {
-      if (strcmp (label, Symbol[i].Label) == 0)
-         return (ERR);
+   pthread_mutex_lock (&Idlelock);
+
+   if (Nidle >= Maxidle) {
+      Maxidle = (Maxidle == 0) ? 16 : Maxidle * 2;
+      Idle = realloc (Idle, Maxidle * sizeof (struct Asm *));
+      if (Idle == NULL) {
+         fputs ("as6502: out of memory\n", stderr);
+         exit (1);
+      }
    }
-      
-   strcpy (Symbol[Nlabels].Label, label);
-   Symbol[Nlabels].Address = addr;
 
-   Nlabels++;
-   
-   return (OK);
+   Idle[Nidle++] = as;
+
+   pthread_mutex_unlock (&Idlelock);
 }
 
 
-/* symbols --- print the symbol table */
+/* readall --- read exactly n bytes from a socket */
 
-void symbols ()
+int readall (fd, buf, n)
+int fd;
+void *buf;
+long n;
 {
-   int i;
+   char *p = buf;
+   ssize_t got;
 
-   fprintf (Listing, "\nSymbol Table\n\n");
+   while (n > 0) {
+      if ((got = read (fd, p, n)) <= 0)
+         return (ERR);
 
-   for (i = 0; i < Nlabels; i++) {
-      if (Symbol[i].References == 0)
-         unused (Symbol[i].Label);
-         
-      fprintf (Listing, "%-15.15s %04lX  ", Symbol[i].Label, Symbol[i].Address);
-      if ((i % 4) == 3)
-         putc (NEWLINE, Listing);
+      p += got;
+      n -= got;
    }
 
-   fprintf (Listing, "\n\n%d labels used\n", Nlabels);
+   return (OK);
 }
 
 
-/* look_up --- look up a mnemonic in the list of opcodes */
+/* writevall --- write all the buffers to a socket, carrying on after a short writev */
 
-int look_up (mnem)
-const char mnem[];
+int writevall (fd, iov, niov)
+int fd;
+struct iovec *iov;
+int niov;
 {
+   ssize_t put;
    int i;
-   char str[MAXMNEM];
-   static struct {
-      char dir[MAXMNEM];
-      int token;
-   } dirtab[] = {
-      {"ORG", ORG},  /* ORG and LOC are synonyms */
-      {"LOC", ORG},
-      {"FCB", FCB},  /* FCB and BYT are synonyms */
-      {"BYT", FCB},
-      {"FCW", FCW},  /* FCW and WRD are synonyms */
-      {"WRD", FCW},
-      {"RMB", RMB},  /* RMB not yet implemented */
-      {"TEX", TEX},
-      {"EQU", EQU},
-      {"END", END}   /* END does nothing */
-   };
-
-   strcpy (str, mnem);  /* Copy the mnemonic... */
-   strupr (str);        /* Map to upper case */
-   
-   for (i = 0; i < (sizeof (Opcodes) / sizeof (Opcodes[0])); i++)
-      if (strcmp (str, Opcodes[i].mnem) == 0)
-         return (i);
-
-   for (i = 0; i < (sizeof (dirtab) / sizeof (dirtab[0])); i++)
-      if (strcmp (str, dirtab[i].dir) == 0)
-         return (dirtab[i].token);
-         
-   return (ERR);
-}
-
 
-/* opcode_for --- find the opcode for a given mnemonic */
+   put = writev (fd, iov, niov);
+   if (put < 0)
+      put = 0;       /* Nothing went: start again from the beginning */
 
-int opcode_for (mn, modep, opp, cycles)
-const int mn;
-int *modep;
-address *opp;
-char cycles[];
-{
-#ifdef DB
-   fprintf (stderr, "opcode_for: mn = %d (%s), mode = %d\n", mn, Opcodes[mn].mnem, *modep);
-#endif
-
-   if ((*modep == ABSOLUTE || *modep == INDEX_X || *modep == INDEX_Y) &&
-         (*opp < 256 && *opp >=0))   /* Zero page ? */
-      if (Opcodes[mn].obj[*modep + Z_OFFSET] != ERR)
-         *modep += Z_OFFSET;
-   
-   if (*modep == ABSOLUTE && Opcodes[mn].obj[*modep] == ERR) { 
-      const address a1 = Addr + ADDR(2);    /* Calculate relative addressing */
-      const address a2 = *opp;
-      address rel = a2 - a1;
-      
-      if (PASS2 && (rel > 127 || rel < -128)) {
-         nerd ("Branch too far");
-         rel = 0;
+   for (i = 0; i < niov; i++) {
+      if ((size_t)put >= iov[i].iov_len) {      /* Sent already */
+         put -= iov[i].iov_len;
+         continue;
       }
 
-      if (rel < 0)    /* sort out two's complement */
-         rel += 256;
-
-      *modep = RELATIVE;
-      *opp = rel;
+      if (writeall (fd, (const char *)iov[i].iov_base + put, iov[i].iov_len - put) != OK)
+         return (ERR);
 
-      if ((a1 & 0xff00) == (a2 & 0xff00))
-         strcpy (cycles, "2/4"); /* Branch within same page */
-      else
-         strcpy (cycles, "2/5"); /* Branch across page boundary */
+      put = 0;
    }
-   else
-      snprintf (cycles, MAXCYCSTR, " %1d ", Opcodes[mn].cyc[*modep]);
 
-   return (Opcodes[mn].obj[*modep]);
+   return (OK);
 }
 
 
-/* directive --- handle directives */
+/* writeall --- write exactly n bytes to a socket */
 
-void directive (dir, oper)
-const int dir;
-const char oper[];
+int writeall (fd, buf, n)
+int fd;
+const void *buf;
+long n;
 {
-   int i, stat;
-   address op;
-
-   Nbytes = 0;
-   i = 0;
-   switch (dir) {
-   case ORG:
-      if (eval (oper, &op) == ERR)
-         for_ref ("ORG");
-      else
-         Addr = op;
-
-      if (PASS2) {
-         if (Blkptr != 0)     /* Flush out any remaining object code */
-            putblock ();
-
-         Blkaddr = Addr;
-      }
-      break;
-   case EQU:
-      if (PASS1) {   /* Ignore EQU second time around */
-         if (eval (oper, &op) == ERR)
-            for_ref ("EQU");
-         else
-            Symbol[Nlabels - 1].Address = op;
-      }
-      break;
-   case FCB:
-      do {
-         stat = evaluate (oper, &i, &op);
-         
-         if (stat == ERR) {
-            Byte[Nbytes++] = ERR;   /* May just be a forward reference in pass 1. Maintain code size */
-            
-            if (PASS2)
-               nerd ("Undefined label in FCB directive");
-         }
-         else if (op <= ADDR(0xff)) {
-            Byte[Nbytes++] = NUM(op);
-         }
-         else {
-            nerd ("Byte value out of range");
-            Byte[Nbytes++] = ERR;  /* Maintain code size by generating one dud byte */
-         }
-      } while (!(oper[i++] != ',' || Nbytes >= MAXBYTES));
-      
-      break;
-   case FCW:
-      do {
-         stat = evaluate (oper, &i, &op);
-         
-         if (stat == ERR) {
-            Byte[Nbytes++] = ERR;   /* May just be a forward reference in pass 1. Maintain code size */
-            Byte[Nbytes++] = ERR;
-            
-            if (PASS2)
-               nerd ("Undefined label in FCW directive");
-         }
-         else if (op <= ADDR(0xffff)) {
-            Byte[Nbytes++] = NUM(op & 0xff);
-            Byte[Nbytes++] = NUM(op / 256);
-         }
-         else {
-            nerd ("Word value out of range");
-            Byte[Nbytes++] = ERR;  /* Maintain code size by generating two dud bytes */
-            Byte[Nbytes++] = ERR;
-         }
-      } while (!(oper[i++] != ',' || Nbytes >= MAXBYTES));
-      
-      break;
-   case TEX:
-      Nbytes = strlen (oper) - 2;
-
-      if (PASS2) {
-         const char term = oper[0];   /* Save the quote */
-         for (i = 1; oper[i] != term && oper[i] != EOS; i++)
-            Byte[i-1] = oper[i];
-      }
-      break;
-   case END:
-      /* Do nothing */
-      break;
-   case RMB:
-      if (eval (oper, &op) == ERR)
-         for_ref ("RMB");
-      else
-         Addr += op;    /* Skip as many bytes as the RMB directive requests */
-      
-      if (PASS2) {
-         if (Blkptr != 0)     /* Flush out any remaining object code */
-            putblock ();
-
-         Blkaddr = Addr;
-      }
-      
-      break;
-   }
-}
-
-
-/* eval --- evaluate the string 'str' into an int */
+   const char *p = buf;
+   ssize_t put;
 
-int eval (str, nump)
-const char str[];
-address *nump;
-{
-   int i;
+   while (n > 0) {
+      if ((put = write (fd, p, n)) <= 0)
+         return (ERR);
 
-   i = 0;
-   if (evaluate (str, &i, nump) == ERR || str[i] != EOS)
-      return (ERR);
+      p += put;
+      n -= put;
+   }
 
    return (OK);
 }
 
 
-/* evaluate --- evaluate the string 'str' into an integer, updating i */
+/* put32 --- store a 32-bit length, most significant byte first */
 
-int evaluate (str, ip, nump)
-const char str[]; /* The string to be evaluated, */
-int *ip;          /* starting at position '*ip', */
-address *nump;    /* putting the resulting address here */
+void put32 (p, val)
+unsigned char *p;
+unsigned long val;
 {
-   int stat, stat1;
-   address val;
-
-   stat = OK;
-   stat1 = convert (str, ip, nump);
-
-   switch (str[*ip]) { /* Now deal with LABEL+1 and NBYTES*2 */
-   case ADD:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump += val;
-      break;
-   case SUBTRACT:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump -= val;
-      break;
-   case MULTIPLY:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump *= val;
-      break;
-   case DIVIDE:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump /= val;
-      break;
-   case LOGIC_AND:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump &= val;
-      break;
-   case LOGIC_OR:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump |= val;
-      break;
-   case LOGIC_XOR:
-      (*ip)++;
-      stat = convert (str, ip, &val);
-      *nump ^= val;
-      break;
-   }
-   
-   if (*nump > 0xffff) {
-      nerd ("Address out of range");
-      return (ERR);
-   }
+   p[0] = (val >> 24) & 0xff;
+   p[1] = (val >> 16) & 0xff;
+   p[2] = (val >> 8) & 0xff;
+   p[3] = val & 0xff;
+}
 
-   if (stat1 == ERR || stat == ERR)
-      return (ERR);
 
-   return (OK);
+/* get32 --- fetch a 32-bit length, most significant byte first */
+
+unsigned long get32 (p)
+const unsigned char *p;
+{
+   return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | p[3]);
 }
 
 
-/* convert --- convert one term of an expression to an address */
+/* add_job --- add a source file to the batch */
 
-int convert (str, ip, nump)
-const char str[]; /* the number to be converted, */
-int *ip;          /* starting at position 'i', */
-address *nump;    /* resulting address */
+void add_job (source, object, listing)
+const char *source;
+const char *object;
+const char *listing;
 {
-   const char prefix = str[*ip];  /* Remember high or low byte prefix - '>' or '<' */
-   int stat;     /* Error flag */
-   
-   stat = OK;        /* no errors so far... */
-
-   if (prefix == HIBYTE || prefix == LOBYTE)   /* skip Hi & LO prefixes */
-      (*ip)++;       
-
-   if (isalpha (str[*ip]) || (str[*ip] == '_'))
-      stat = sym (str, ip, nump);  /* look up labels & return status */
-   else if (isdigit (str[*ip]))
-      *nump = gctol (str, ip, 10);  /* Base 10 conversion */
-   else {
-      switch (str[*ip]) {
-      case HEX:         /* Base 16 conversion */
-         (*ip)++;
-         *nump = gctol (str, ip, 16);
-         break;
-      case BINARY:      /* Base 2 conversion */
-         (*ip)++;
-         *nump = gctol (str, ip, 2);
-         break;
-      case ASCII:       /* ASCII code constant */
-         (*ip)++;
-         if (str[*ip] == '^') {   /* Check for control chars ("^C) */
-            (*ip)++;
-            if (str[*ip] == EOS || str[*ip] == ASCII)
-               *nump = ADDR('^');                    /* Caret (^) */
-            else {
-               *nump = ADDR(str[*ip] & 0x1f);       /* Control char */
-               (*ip)++;
-            }
-         }
-         else {
-            *nump = ADDR(str[*ip]);
-            (*ip)++;
-         }
-         if (str[*ip] == ASCII)   /* skip the closing quote */
-            (*ip)++;
-         break;
-      case OCTAL:       /* Base 8 conversion */
-         (*ip)++;   
-         *nump = gctol (str, ip, 8);
-         break;
-      case PC:          /* Program counter - '.' */
-         (*ip)++;
-         *nump = Addr;
-         break;
-      default:
-         nerd ("Syntax error in expression");
-         break;
-      }
-   }
+   struct Job *j;
+
+   Job = grow_jobs ();
+   j = &Job[Njobs++];
 
-   if (prefix == HIBYTE)      /* Now see about the prefix... */
-      *nump /= 256;
-   else if (prefix == LOBYTE)
-      *nump &= 0xff;
+   j->Source  = strdup (source);
+   j->Object  = (object != NULL) ? strdup (object) : outname (source, (Hexfmt == BIN_IMAGE) ? ".bin" : ".hex");
+   j->Listing = (listing != NULL) ? strdup (listing) : outname (source, ".lst");
+   j->Errs    = 0;
+   j->Msgs    = NULL;
+   j->Msglen  = 0;
 
-   return (stat);
+   if (j->Source == NULL || j->Object == NULL || j->Listing == NULL) {
+      fputs ("as6502: out of memory\n", stderr);
+      exit (1);
+   }
 }
 
 
-/* sym --- locate a symbol's address if possible */
+/* read_manifest --- add files to the batch, one 'source [object [listing]]' per line */
 
-int sym (str, ip, nump)
-const char str [];
-int *ip;
-address *nump;
+void read_manifest (path)
+const char *path;
 {
-   int j;
-   char label[MAXLABEL];
+   FILE *fp;
+   char *lin;
+   size_t size;
+   char *f[3];
+   int n;
 
-   for (j = 0; isalpha(str[*ip]) || isdigit(str[*ip])
-               || str[*ip] == '_'; (*ip)++)
-      if (j < (MAXLABEL - 1))
-         label[j++] = str[*ip];
+   if (strcmp (path, "-") == 0)
+      fp = stdin;
+   else if ((fp = fopen (path, READ)) == NULL)
+      cant (path, YES);
 
-   label[j] = EOS;
-   *nump = FORWARD;    /* set value to $FFFF if not found */
+   lin = NULL;
+   size = 0;
 
-   for (j = 0; j < Nlabels; j++)
-      if (strcmp (label, Symbol[j].Label) == 0) {
-         *nump = Symbol[j].Address;
+   while (getline (&lin, &size, fp) != -1) {
+      f[0] = f[1] = f[2] = NULL;
 
-#ifdef DB
-   fprintf (stderr, "sym: label = '%s', value = %lx\n", label, *nump);
-#endif
+      for (n = 0; n < 3 && (f[n] = strtok (n == 0 ? lin : NULL, " \t\n")) != NULL; n++)
+         ;
 
-         if (PASS2)
-            Symbol[j].References++;
-            
-         return (OK);
-      }
+      if (f[0] != NULL && f[0][0] != COMMENT_SYM && f[0][0] != '#')
+         add_job (f[0], f[1], f[2]);
+   }
 
-   return (ERR);  /* return ERR if label not found */
+   free (lin);
+
+   if (fp != stdin)
+      fclose (fp);
 }
 
 
-/* nerd --- error message printer */
+/* outname --- make an output file name by changing the source file's extension */
 
-void nerd (str)
-const char str[];
+char *outname (source, ext)
+const char *source;
+const char *ext;
 {
-   fprintf (Errorfd, "%s at line %d\n", str, Nline);
-   fputs (Line, Errorfd);
+   const char *dot;
+   const char *slash;
+   char *name;
+   size_t len;
 
-   Errs++;        
-}
+   dot = strrchr (source, '.');
+   slash = strrchr (source, '/');
 
+   if (dot == NULL || (slash != NULL && dot < slash))
+      len = strlen (source);
+   else
+      len = dot - source;
 
-/* for_ref --- forward reference error */
+   name = malloc (len + strlen (ext) + 1);
+   if (name != NULL) {
+      memcpy (name, source, len);
+      strcpy (name + len, ext);
+   }
 
-void for_ref (str)
-const char str[];
-{
-   fprintf (Errorfd, "%s: can't forward reference, line %d\n", str, Nline);
-   Errs++;
+   return (name);
 }
 
 
-/* unused --- unused label warning */
+/* batch --- assemble all the files in the batch, returning the total number of errors */
 
-void unused (str)
-const char str[];
+int batch (nthreads)
+int nthreads;
 {
-   fprintf (Errorfd, "Warning: %s: unused label\n", str);
-}
+   pthread_t *tid;
+   struct Asm **as;
+   long n;
+   int i;
+   int errs;
+   int bad;
 
+   if (nthreads < 1)
+      nthreads = 1;
 
-/* set_up --- open files, initialise globals */
+   if (nthreads > Njobs)
+      nthreads = (Njobs > 0) ? Njobs : 1;
 
-void set_up (argc, argv)
-const int argc;
-const char *argv[];
-{
-   int i;
-   
-   if (argc > 1) {
-      Source = fopen (argv[1], READ);
-      if (Source == NULL)
-         cant (argv[1], YES);
+   tid = malloc (nthreads * sizeof (pthread_t));
+   as = malloc (nthreads * sizeof (struct Asm *));
+   if (tid == NULL || as == NULL) {
+      fputs ("as6502: out of memory\n", stderr);
+      exit (1);
    }
-   else
-      Source = stdin;
 
-   if (argc > 2) {
-      Object = fopen (argv[2], WRITE);
-      if (Object == NULL)
-         cant (argv[2], YES);
-   }
-   else
-      Object = stdout;
+   for (i = 0; i < nthreads; i++) {   /* Contexts are made before any thread starts */
+      as[i] = as_new ();
+      if (as[i] == NULL) {
+         fputs ("as6502: out of memory\n", stderr);
+         exit (1);
+      }
 
-   if (argc > 3) {
-      Listing = fopen (argv[3], WRITE);
-      if (Listing == NULL)
-         cant (argv[3], YES);
-   }
-   else
-      Listing = stdout;
-
-   Errorfd = stderr;
-
-   Nline   = 0;
-   Errs    = 0;
-   Nlabels = 0;               /* Number of labels */
-   
-   for (i = 0; i < MAXSYMBOLS; i++) {
-      Symbol[i].Label[0]   = EOS;
-      Symbol[i].Address    = FORWARD;
-      Symbol[i].References = 0;
+      configure (as[i]);
    }
 
-   for (i = 0; i < MAXBYTES; i++)
-      Byte[i] = ERR;
+   Nextjob = 0;
 
-   Nbytes  = 0;               /* Number of bytes for current instruction */
-   Addr    = ADDR(0);         /* Current assembly address */
-   Blkaddr = ADDR(0);         /* Address of first checksum block */
-   Blkptr  = 0;               /* Block pointer */
-   Hexfmt  = MOS_HEX;         /* Hex output file format */
-}
+   for (i = 1; i < nthreads; i++) {
+      if (pthread_create (&tid[i], NULL, worker, as[i]) != 0) {
+         fputs ("as6502: can't start thread\n", stderr);
+         exit (1);
+      }
+   }
 
+   worker (as[0]);      /* This thread does its share too */
 
-/* list_it --- do stuff for the listing */
+   for (i = 1; i < nthreads; i++)
+      pthread_join (tid[i], NULL);
 
-void list_it (cycles, label, mnem, mn, oper, comment)
-const char cycles[], label[], mnem[];
-const int mn;
-const char oper[], comment[];
-{
-   int i;
+   /* Messages come out in the order of the files, not the order of finishing */
 
-   if (mnem[0] != EOS) {
-      if (mn == EQU) {
-         address eq;
-         
-         i = 0;
+   errs = 0;
+   bad = 0;
 
-         if (sym (label, &i, &eq) == ERR)
-            nerd ("Internal error in EQU directive");
-            
-         fprintf (Listing, "%4d: %04lX ", Nline, eq);
+   for (n = 0; n < Njobs; n++) {
+      if (Job[n].Msglen != 0) {
+         fprintf (stderr, "%s:\n", Job[n].Source);
+         fwrite (Job[n].Msgs, sizeof (char), Job[n].Msglen, stderr);
       }
-      else
-         fprintf (Listing, "%4d: %04lX ", Nline, Addr);
-
-      for (i = 0; i < 5; i++) {    /* Why FIVE ?? */
-         if (i < Nbytes && Byte[i] != ERR)
-            fprintf (Listing, "%02X ", Byte[i]);
-         else
-            fprintf (Listing, "   ");
+
+      if (Job[n].Errs != 0) {
+         fprintf (stderr, "%s: %04d ERRORS\n", Job[n].Source, Job[n].Errs);
+         bad++;
       }
 
-      fprintf (Listing, "%-3.3s ", cycles);
-      
-      fprintf (Listing, "%-16.16s%-4.4s%-20.20s%s\n", label, mnem, oper, comment);
-   }
-   else if (label[0] != EOS) {
-      fprintf (Listing, "%4d: %04lX                    %-16.16s                        %s\n", Nline, Addr, label, comment);
-   }
-   else {
-      fprintf (Listing, "%4d:                         %s\n", Nline, comment);
+      errs += Job[n].Errs;
+      free (Job[n].Msgs);
    }
+
+   if (bad != 0)
+      fprintf (stderr, "%d of %ld files had errors\n", bad, Njobs);
+
+   for (i = 0; i < nthreads; i++)
+      as_free (as[i]);
+
+   free (as);
+   free (tid);
+
+   return (errs);
 }
 
 
-/* putbyte --- output a byte to the code file */
+/* worker --- take files from the batch until there are none left */
 
-void putbyte (byte)
-const int byte;
+void *worker (arg)
+void *arg;
 {
-   Block[Blkptr++] = byte;
+   struct Asm *as = arg;
+   long n;
 
-   if (Blkptr >= BYTES_PER_BLOCK)
-      putblock ();
+   for (;;) {
+      pthread_mutex_lock (&Joblock);
+      n = Nextjob++;
+      pthread_mutex_unlock (&Joblock);
+
+      if (n >= Njobs)
+         break;
+
+      do_job (as, &Job[n]);
+   }
+
+   return (NULL);
 }
 
 
-/* putblock --- puts a block of code onto the object file */
+/* do_job --- assemble one file of the batch, keeping its messages for later */
 
-void putblock ()
+void do_job (as, j)
+struct Asm *as;
+struct Job *j;
 {
+   FILE *source, *object, *listing;
+   FILE *msgs;
+   const struct Diag *d;
    int i;
-   int blklen;
-   unsigned int checksum;
 
-   if (Blkptr != 0) {   /* See if there's anything in the block */
-      blklen = Blkptr;
-      Blkptr = 0;
+   msgs = open_memstream (&j->Msgs, &j->Msglen);
+   if (msgs == NULL) {
+      fputs ("as6502: out of memory\n", stderr);
+      exit (1);
+   }
 
-      switch (Hexfmt) {
-      case MOS_HEX:
-         fprintf (Object, ";%02X%04lX", blklen, Blkaddr);
-         break;
-      case SREC_HEX:
-         fprintf (Object, "S1%02X%04lX", blklen, Blkaddr);
-         break;
-      case INTEL_HEX:
-         fprintf (Object, ":%02X%04lX00", blklen, Blkaddr);
-         break;
-      default:
-         break;
+   source = fopen (j->Source, READ);
+   object = listing = NULL;
+
+   if (source == NULL) {      /* Don't make output files for a missing source */
+      fprintf (msgs, "%s: can't open\n", j->Source);
+      j->Errs = 1;
+   }
+   else if ((object = fopen (j->Object, (Hexfmt == BIN_IMAGE) ? WRITEBIN : WRITE)) == NULL) {
+      fprintf (msgs, "%s: can't open\n", j->Object);
+      j->Errs = 1;
+   }
+   else if ((listing = fopen (j->Listing, WRITE)) == NULL) {
+      fprintf (msgs, "%s: can't open\n", j->Listing);
+      j->Errs = 1;
+   }
+   else {
+      as_source_name (as, j->Source);
+      j->Errs = as_file (as, source, object, listing, NULL);
+
+      for (i = 0; i < as_ndiags (as); i++) {
+         d = as_diag (as, i);
+         fprintf (msgs, "%s\n", d->Msg);
+         if (d->Text != NULL)
+            fprintf (msgs, "%s\n", d->Text);
       }
+   }
 
-      checksum = blklen;
-      checksum += Blkaddr & 0xff;
-      checksum += (Blkaddr >> 8) & 0xff;
+   if (source != NULL)
+      fclose (source);
 
-      for (i = 0; i < blklen; i++) {
-         fprintf (Object, "%02X", Block[i]);
-         checksum += Block[i];
-      }
+   if (object != NULL)
+      fclose (object);
 
-      fprintf (Object, "%04X\n", checksum);
-      
-      Nblocks++;
-   }
+   if (listing != NULL)
+      fclose (listing);
 
-   Blkaddr += ADDR(blklen);
+   fclose (msgs);
 }
 
 
-/* puteof --- puts EOF marker onto the object file */
+/* grow_jobs --- make sure there's room for another file in the batch */
 
-void puteof ()
+void *grow_jobs ()
 {
-   int blklen;
-   unsigned int checksum;
-
-   blklen = 0;
-
-   switch (Hexfmt) {
-   case MOS_HEX:
-      fprintf (Object, ";%02X%04lX", blklen, ADDR(Nblocks));
-      break;
-   case SREC_HEX:
-      fprintf (Object, "S9%02X%04lX", blklen, 0L);
-      break;
-   case INTEL_HEX:
-      fprintf (Object, ":%02X%04lX01", blklen, 0L);
-      break;
-   default:
-      break;
+   if (Njobs >= Maxjobs) {
+      Maxjobs = (Maxjobs == 0L) ? 64L : Maxjobs * 2L;
+      Job = realloc (Job, Maxjobs * sizeof (struct Job));
+      if (Job == NULL) {
+         fputs ("as6502: out of memory\n", stderr);
+         exit (1);
+      }
    }
 
-   checksum = blklen;
-   checksum += ADDR(Nblocks) & 0xff;
-   checksum += (ADDR(Nblocks) >> 8) & 0xff;
+   return (Job);
+}
+
 
-   fprintf (Object, "%04X\n", checksum);
+/* usage --- print a usage message and give up */
+
+void usage ()
+{
+   fputs ("Usage: as6502 [-1 | -R] [-c] [-s | -i | -b | -t] [-r reclen] [-f fill] [source [object [listing]]]\n", stderr);
+   fputs ("       as6502 [options] -j threads [-m manifest] source...\n", stderr);
+   fputs ("       as6502 [options] -S socket\n", stderr);
+   fputs ("Options also include -p defs, to pre-load the symbols from a file of definitions\n", stderr);
+   exit (1);
 }
 
 
@@ -1307,35 +932,7 @@ const int bomb;
 {
    fputs (path, stderr);
    fputs (": can't open\n", stderr);
-   
+
    if (bomb)
       exit (1);
 }
-
-address gctol (str, ip, base)
-const char str[];
-int *ip;
-const int base;
-{
-   const char *p, *newp;
-   address val;
-   
-   p = str + *ip;
-   
-   val = strtol (p, (char **)&newp, base);
-   
-   *ip += newp - p;
-   
-   return (val);
-}
-
-
-void strupr (char *s)
-{
-   while (*s) {
-      if (islower (*s))
-         *s = toupper (*s);
-         
-      s++;
-   }
-}
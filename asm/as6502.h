@@ -1,19 +1,28 @@
 /* Definitions for the 6502 assembler                                */
 /* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems   */
 
-#define MAXSYMBOLS    500
-#define MAXCOMMENT     80
+#define INITSYMBOLS   256        /* Symbol table grows from here */
 #define MAXLABEL       16
 #define MAXMNEM         5
 #define MAXCYCSTR       5
-#define MAXOPER        81
-#define MAXBLOCK       80
+#define MAXBLOCK      255        /* Longest object record */
 #define MAXBYTES      256
+#define MAXINSN         5        /* Longest instruction: a branch stretched round a JMP */
+#define MAXPREDEF      16        /* Definition files to pre-load */
+#define MAXNEST        16        /* Depth of nested INCLUDE files */
+#define MAXRELAX       16        /* Relaxation passes before giving up */
+#define MAXSOURCE (16L << 20)    /* Longest source a server will take */
+#define MAXPATH      4096        /* Longest source name a server will take */
 
-#define PASS1  (Pass == 1)
-#define PASS2  (Pass == 2)
+#define PASS1    (as->Pass & 1)    /* Defining symbols */
+#define PASS2    (as->Pass & 2)    /* Generating code */
+#define ONEPASS  (as->Pass == 3)   /* Both at once, patching forward references later */
+
+#define FIELD(len, width) ((len) < (width) ? (len) : (width))   /* Precision for listing */
 
 #define SKIPBL(lin, i) while (lin[i] == ' ' || lin[i] == '\t') i++
+#define ENDOPER(c)    ((c) == EOS || (c) == ' ' || (c) == NEWLINE)   /* Operands are not copied out of the line */
+#define OPERAND(lin, t) ((t)->Operlen != 0 ? (lin) + (t)->Oper : "")
 
 #define EOS         '\0'
 #define NEWLINE     '\n'
@@ -24,10 +33,9 @@
 #define YES            1
 #define NO             0
 
-#define MAXLINE      256
-
 #define READ         "r"
 #define WRITE        "w"
+#define WRITEBIN     "wb"
 
 #define COMMENT_SYM  ';'
 #define LABEL_SYM    ':'   /* Allow colon after a label because many assemblers require that */
@@ -53,6 +61,10 @@
 #define LOGIC_AND    '&'
 #define LOGIC_OR     '|'
 #define LOGIC_XOR    '^'
+#define GROUP        '('
+#define GROUP_END    ')'
+#define COMPLEMENT   '~'
+#define BINOPS       "<>!=*/%+-&^|"   /* Characters that start a binary operator */
 
 /* Addressing modes -- used to index array in the opcode table */
 
@@ -78,16 +90,104 @@
 #define EQU          -104
 #define END          -105
 #define TEX          -108
+#define INCLUDE      -109
+#define TIMED        -110
+#define ENDTIMED     -111
+#define DELAY        -112
 #define IS_DIRECTIVE(m) (m < 0)
 
+/* Mnemonics and directives are all three letters.  Pack them, case-insensitively,
+ * into 15 bits and hash that with a multiplier chosen to give no collisions. */
+#define MNEMKEY(s)   ((((s)[0] & 0x1f) << 10) | (((s)[1] & 0x1f) << 5) | ((s)[2] & 0x1f))
+#define MNEMSLOT(k)  ((int)((((k) * 12623979UL) & 0xffffffffUL) >> 24))
+#define MNEMSLOTS    256
+
 typedef long int address;
 #define ADDR(n)  ((address)(n))
 #define NUM(n)   ((int)(n))
 #define FORWARD     0xffff      /* Forward reference value */
-
-#define BYTES_PER_BLOCK  24
-
-#define MOS_HEX      1           /* MOS Technology Paper tape format */
-#define SREC_HEX     2           /* Motorola S-Record hex format */
-#define INTEL_HEX    3           /* Intel Hex format */
+#define BYTE_RANGE(v) ((v) >= -0x80 && (v) <= 0xff)   /* Signed or unsigned byte */
+#define HIGH(v)  NUM(((v) >> 8) & 0xff)                 /* High byte of a word, even if negative */
+
+#define BYTES_PER_BLOCK  24     /* Default object record length */
+#define HEXBUFSIZE   65536       /* Object text is built up here */
+#define MAXRECTEXT   (16 + (MAXBLOCK * 2))   /* Longest line of object text */
+
+#define DATA_REC     0           /* Object record types */
+#define EOF_REC      1
+
+#define HEXBYTE(p, b) (*(p)++ = Hexpair[b][0], *(p)++ = Hexpair[b][1])
+
+/* Postfix code for compiled expressions */
+
+#define X_CONST      1           /* Push Val */
+#define X_SYM        2           /* Push value of symbol Val */
+#define X_NAME       3           /* Push value of symbol not yet defined, called Name */
+#define X_PC         4           /* Push current address */
+#define X_NEG        5           /* Unary operators */
+#define X_NOT        6
+#define X_HI         7
+#define X_LO         8
+#define X_MUL        9           /* Binary operators */
+#define X_DIV       10
+#define X_MOD       11
+#define X_ADD       12
+#define X_SUB       13
+#define X_SHL       14
+#define X_SHR       15
+#define X_LT        16
+#define X_LE        17
+#define X_GT        18
+#define X_GE        19
+#define X_EQ        20
+#define X_NE        21
+#define X_AND       22
+#define X_XOR       23
+#define X_OR        24
+#define IS_UNARY(x)  ((x) >= X_NEG && (x) <= X_LO)
+#define XSTACK       32          /* Deepest expression */
+
+/* Kinds of forward reference fixup in one-pass mode */
+
+#define FIX_BYTE     1           /* Zero-page, immediate or indirect operand */
+#define FIX_WORD     2           /* Absolute operand */
+#define FIX_REL      3           /* Branch offset */
+#define FIX_FCB      4           /* Byte in FCB directive */
+#define FIX_FCW      5           /* Word in FCW directive */
+
+#define IMAGESIZE    65536L      /* Whole of the 6502's address space */
+
+/* What relaxation has decided about a line, kept from one pass to the next */
+
+#define H_ZP         1           /* Forward reference shrunk to zero-page */
+#define H_ABS        2           /* Shrunk once and had to grow: stays absolute */
+#define H_LONG       4           /* Branch rewritten as inverted branch and JMP */
+#define INVERT_BRANCH 0x20       /* Flips the condition of a branch opcode */
+#define JMP_ABS      0x4c
+#define JMP_IND      0x6c
+#define JSR_ABS      0x20
+#define RTS_INH      0x60
+#define RTI_INH      0x40
+#define BRK_INH      0x00
+
+/* Flags in the opcode table */
+
+#define F_PAGE       1           /* Indexed read takes a cycle more across a page */
+
+/* How control leaves an instruction, for timing */
+
+#define T_NEXT       0           /* Straight on */
+#define T_BRANCH     1           /* Either straight on or to the destination */
+#define T_CALL       2           /* To the destination and back */
+#define T_END        3           /* Never comes back: RTS, RTI, JMP or BRK */
+#define BUSY         2           /* Being timed: a call to it now is recursion */
+#define SAME_PAGE(a, b) (((a) & 0xff00) == ((b) & 0xff00))
+#define BRANCH_TAKEN(next, dest) (SAME_PAGE(next, dest) ? 3 : 4)   /* Cycles for a taken branch */
+
+/* Registers that DELAY may use to count round a loop */
+
+#define R_A          1
+#define R_X          2
+#define R_Y          4
+#define MAXCOUNT     256         /* Loading zero counts round 256 times */
 
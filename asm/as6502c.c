@@ -0,0 +1,231 @@
+/* as6502c --- send a source file to an as6502 server      2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Talks to 'as6502 -S socket'. Takes the same file arguments as
+ * as6502 itself, but the options are the server's.  The full path of
+ * the source goes too, so that the server can find its INCLUDE files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "as6502.h"
+
+#ifdef __STDC__
+int main (int argc, const char * *argv);
+int readall (int fd, void *buf, long n);
+int writeall (int fd, const void *buf, long n);
+void put32 (unsigned char *p, unsigned long val);
+unsigned long get32 (const unsigned char *p);
+void cant (const char *path, int bomb);
+#else
+#define const
+int main ();
+int readall ();
+int writeall ();
+void put32 ();
+unsigned long get32 ();
+void cant ();
+#endif   /* __STDC__ */
+
+int main (argc, argv)
+const int argc;
+const char *argv[];
+{
+   static char vers[] = "2.1";
+   struct sockaddr_un sa;
+   FILE *source, *object, *listing;
+   unsigned char hdr[16];
+   char *buf;
+   char *name;
+   long len, max, namelen;
+   unsigned long errs, objlen, lstlen, msglen;
+   size_t n;
+   int fd;
+
+   if (argc < 2 || argc > 5) {
+      fputs ("Usage: as6502c socket [source [object [listing]]]\n", stderr);
+      exit (1);
+   }
+
+   if (argc > 2) {
+      source = fopen (argv[2], READ);
+      if (source == NULL)
+         cant (argv[2], YES);
+   }
+   else
+      source = stdin;
+
+   name = NULL;
+   if (argc > 2 && (name = realpath (argv[2], NULL)) == NULL)
+      name = strdup (argv[2]);
+
+   namelen = (name == NULL) ? 0L : strlen (name);
+
+   /* Connect first: the source may be a pipe that takes its time */
+   memset (&sa, 0, sizeof (sa));
+   sa.sun_family = AF_UNIX;
+   strncpy (sa.sun_path, argv[1], sizeof (sa.sun_path) - 1);
+
+   if ((fd = socket (AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+       connect (fd, (struct sockaddr *)&sa, sizeof (sa)) < 0) {
+      perror (argv[1]);
+      exit (1);
+   }
+
+   /* Read the whole source */
+
+   max = BUFSIZ * 4L;
+   buf = malloc (max);
+   len = 0L;
+
+   while (buf != NULL && (n = fread (buf + len, sizeof (char), max - len, source)) > 0) {
+      len += n;
+
+      if (len == max)
+         buf = realloc (buf, max *= 2L);
+   }
+
+   if (buf == NULL) {
+      fputs ("as6502c: out of memory\n", stderr);
+      exit (1);
+   }
+
+   put32 (hdr, namelen);
+   put32 (hdr + 4, len);
+
+   if (writeall (fd, hdr, 8) != OK || writeall (fd, name, namelen) != OK ||
+       writeall (fd, buf, len) != OK || readall (fd, hdr, sizeof (hdr)) != OK) {
+      fprintf (stderr, "%s: server went away\n", argv[1]);
+      exit (1);
+   }
+
+   errs   = get32 (hdr);
+   objlen = get32 (hdr + 4);
+   lstlen = get32 (hdr + 8);
+   msglen = get32 (hdr + 12);
+
+   free (name);
+   free (buf);
+   buf = malloc (objlen + lstlen + msglen + 1);
+
+   if (buf == NULL || readall (fd, buf, objlen + lstlen + msglen) != OK) {
+      fprintf (stderr, "%s: short reply\n", argv[1]);
+      exit (1);
+   }
+
+   close (fd);
+
+   if (argc > 3) {
+      object = fopen (argv[3], WRITEBIN);
+      if (object == NULL)
+         cant (argv[3], YES);
+   }
+   else
+      object = stdout;
+
+   if (argc > 4) {
+      listing = fopen (argv[4], WRITE);
+      if (listing == NULL)
+         cant (argv[4], YES);
+   }
+   else
+      listing = stdout;
+
+   fwrite (buf, sizeof (char), objlen, object);
+   fwrite (buf + objlen, sizeof (char), lstlen, listing);
+   fwrite (buf + objlen + lstlen, sizeof (char), msglen, stderr);
+
+   fprintf (TTY, "%04lu ERRORS [6502 ASSEMBLER Rev.%s]\n", errs, vers);
+
+   if (errs == 0)
+      return (0);
+   else
+      return (1);
+}
+
+
+/* readall --- read exactly n bytes from a socket */
+
+int readall (fd, buf, n)
+int fd;
+void *buf;
+long n;
+{
+   char *p = buf;
+   ssize_t got;
+
+   while (n > 0) {
+      if ((got = read (fd, p, n)) <= 0)
+         return (ERR);
+
+      p += got;
+      n -= got;
+   }
+
+   return (OK);
+}
+
+
+/* writeall --- write exactly n bytes to a socket */
+
+int writeall (fd, buf, n)
+int fd;
+const void *buf;
+long n;
+{
+   const char *p = buf;
+   ssize_t put;
+
+   while (n > 0) {
+      if ((put = write (fd, p, n)) <= 0)
+         return (ERR);
+
+      p += put;
+      n -= put;
+   }
+
+   return (OK);
+}
+
+
+/* put32 --- store a 32-bit length, most significant byte first */
+
+void put32 (p, val)
+unsigned char *p;
+unsigned long val;
+{
+   p[0] = (val >> 24) & 0xff;
+   p[1] = (val >> 16) & 0xff;
+   p[2] = (val >> 8) & 0xff;
+   p[3] = val & 0xff;
+}
+
+
+/* get32 --- fetch a 32-bit length, most significant byte first */
+
+unsigned long get32 (p)
+const unsigned char *p;
+{
+   return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | ((unsigned long)p[2] << 8) | p[3]);
+}
+
+
+/* cant --- print a standard error message */
+
+void cant (path, bomb)
+const char *path;
+const int bomb;
+{
+   fputs (path, stderr);
+   fputs (": can't open\n", stderr);
+
+   if (bomb)
+      exit (1);
+}
@@ -0,0 +1,4278 @@
+/* libas6502 --- John's 6502 assembler, as a library       1983-06-16 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Modification:
+ * 1983-06-16 JRH Initial coding (in Ratfor)
+ * 1999-08-18 JRH Added hex format options
+ * 1999-08-20 JRH Fixed error-checking in 'convert'
+ * 1999-08-21 JRH Fixed error-checking in directives
+ * 1999-08-22 JRH Added check for current address beyond $FFFF
+ * 1999-08-22 JRH Fixed accumulator-mode syntax: ASL A
+ * 2000-01-28 JRH Added cycle counts
+ * 2000-02-01 JRH Changed behaviour of listing for EQU directives
+ * 2000-02-02 JRH Improved handling of erroneous input
+ * 2000-02-15 JRH Made lower-case A, X and Y registers legal
+ * 2000-02-17 JRH Made mnemonics and directives case-insensitive
+ * 2000-06-21 JRH Made assembler return non-zero exit status on error
+ * 2000-06-28 JRH Generate code when address bad, to maintain code size
+ * 2023-10-25 JRH Add EOF record to checksum hex output file
+ * 2023-10-25 JRH Protect against filling up symbol table and detect duplicate labels
+ * 2026-10-17 agent Hashed, dynamically-grown symbol table
+ * 2026-10-17 agent Perfect-hash mnemonic and directive lookup
+ * 2026-10-17 agent Optional single-pass assembly with forward reference fixups
+ * 2026-10-17 agent Keep pass 1 line records so that pass 2 need not re-parse
+ * 2026-10-17 agent Map the source into memory and tokenize it in place
+ * 2026-10-17 agent Added raw binary memory image output
+ * 2026-10-17 agent Finished S-Record and Intel Hex output, with variable record length
+ * 2026-10-17 agent Moved all the state into a context, split from the command line
+ * 2026-10-17 agent Symbols from definition files can be pre-loaded into a context
+ * 2026-10-17 agent Added INCLUDE directive, with a cache of tokenized files
+ * 2026-10-17 agent Expressions with precedence and parentheses, compiled once to postfix code
+ * 2026-10-17 agent Optional relaxation passes for zero-page forward references and long branches
+ * 2026-10-17 agent Static cycle counts for each routine and straight-line block
+ * 2026-10-17 agent TIMED and ENDTIMED directives, to check a worst-case cycle budget
+ * 2026-10-17 agent DELAY directive, to wait for an exact number of cycles
+ * 2026-10-17 agent Opcode table moved out to opcodes.c, for the simulator too
+ */
+ 
+/* #define DB */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "as6502.h"
+#include "opcodes.h"
+#include "libas6502.h"
+
+#define AREG(c) (((c) == 'A') || ((c) == 'a'))
+#define XREG(c) (((c) == 'X') || ((c) == 'x'))
+#define YREG(c) (((c) == 'Y') || ((c) == 'y'))
+
+struct Sym {
+   char    Label[MAXLABEL];   /* Label name      */
+   address Address;           /* Label address   */
+   int     References;        /* Reference count */
+};
+
+struct Toks {                    /* Fields of a source line, as offsets into the line */
+   int     Label, Lablen;
+   int     Mnem, Mnemlen;
+   int     Oper, Operlen;
+   int     Comment, Commlen;
+};
+
+struct Ins {                     /* One instruction of a compiled expression */
+   int     Op;                   /* X_CONST, X_SYM, X_ADD, etc. */
+   address Val;                  /* Constant, symbol number, or hash of Name */
+   const char *Name;             /* Undefined symbol, in the source text */
+};
+
+struct Xref {                    /* Compiled expression, kept with its line */
+   const char *Text;             /* Where it is in the source */
+   long    Prog;                 /* First instruction in Prog */
+   int     Nins;                 /* Number of instructions */
+   int     Len;                  /* Number of characters compiled */
+};
+
+struct Binop {                   /* A binary operator */
+   char    Sym[3];               /* As it appears in the source */
+   int     Prec;                 /* Precedence: higher binds tighter */
+   int     Op;                   /* Instruction */
+};
+
+struct Src {                     /* A source file, read into memory */
+   char    *Name;                /* File name */
+   const char *Text;             /* Its text, ending in a newline */
+   long    Len;                  /* Number of characters in Text */
+   size_t  Mapped;               /* Size of mapping, or 0 if Text is ours */
+   unsigned long Hash;           /* FNV-1a hash of Text */
+   int     Shared;               /* Text and tokens belong to another Src */
+   long    Nlines;               /* Number of lines tokenized, or 0 */
+   struct Toks *Toks;            /* Fields of each line */
+};
+
+struct Incl {                    /* One inclusion of a source file */
+   int     Src;                  /* Which file */
+   int     Parent;               /* Inclusion that included it, or ERR for the main source */
+   int     Nline;                /* Line number of INCLUDE in parent */
+};
+
+struct Rec {                     /* What pass 1 found out about a line */
+   const char *Line;             /* Text of line */
+   int     Nline;                /* Line number within its file */
+   int     Incl;                 /* Which inclusion of which file */
+   long    Xref;                 /* First compiled expression */
+   int     Nxrefs;               /* Number of compiled expressions */
+   struct Toks Toks;             /* Where the fields are */
+   int     Mn;                   /* Token from look_up() */
+   int     Mode;                 /* Addressing mode from operand() */
+   address Op;                   /* Operand value */
+   address Addr;                 /* Address of line */
+   int     Nbytes;               /* Number of bytes generated */
+   long    Code;                 /* Offset of bytes in Codebuf */
+   char    Cycles[MAXCYCSTR];    /* Cycle count for listing */
+   char    Redo;                 /* Must be assembled again in pass 2 */
+   char    Fwd;                  /* Line has a forward reference */
+   long    Diag;                 /* First message about the line in pass 1 */
+   int     Ndiags;               /* Number of them */
+};
+
+struct Tim {                     /* An instruction, for the timing summary */
+   address Addr;                 /* Address of instruction */
+   int     Mn;                   /* Token from look_up() */
+   int     Nbytes;               /* Number of bytes generated */
+   long    Cycles;               /* Exact cycles, for DELAY */
+   unsigned char Code[MAXINSN];  /* The bytes themselves */
+   const char *Label;            /* Label on it, or on the lines before */
+   int     Lablen;
+   char    Brk;                  /* Follows data, ORG or RMB */
+   char    Open;                 /* Worst case leaves out a loop or a call */
+   char    Done;                 /* For the last in a run: NO, BUSY or YES */
+   long    Last;                 /* Last instruction that can follow straight on */
+   long    Best, Worst;          /* Cycles from here to the end of the routine */
+};
+
+struct Dly {                     /* An instruction generated by DELAY, for the listing */
+   address Addr;                 /* Where it is */
+   const char *Mnem;
+   char    Oper[8];              /* Operand, in hex */
+   int     Byte;                 /* Index of its first byte in Byte */
+   int     Nbytes;
+   char    Cycles[MAXCYCSTR];
+};
+
+struct Counter {                 /* A register that can count round a delay loop */
+   int     Reg;                  /* R_X, etc. */
+   int     Setbytes, Setcyc;     /* Loading the count (and SEC, for A) */
+   int     Decbytes, Deccyc;     /* Counting down */
+   int     Maxcount;             /* Most times round */
+};
+
+struct Timed {                   /* Code between TIMED and ENDTIMED */
+   long    First;                /* First instruction, in Tim */
+   long    End;                  /* Just after the last instruction */
+   long    Budget;               /* Most cycles it may take */
+   int     Nline;                /* Where the TIMED directive is */
+   int     Incl;
+   const char *Line;
+};
+
+struct Fix {                     /* Forward reference in single-pass mode */
+   int     Kind;                 /* FIX_BYTE, FIX_REL, etc. */
+   int     Index;                /* Index of byte in line */
+   long    Offset;               /* Offset of byte in Objbuf */
+   long    Lstoff;               /* Offset of byte in listing, or -1 */
+   long    Cycoff;               /* Offset of cycle count in listing, or -1 */
+   long    Tim;                  /* Entry in the timing summary, if it's an instruction */
+   address Addr;                 /* Address of instruction */
+   int     Nline;                /* Line number */
+   int     Incl;                 /* Which file */
+   const char *Line;             /* Source line */
+   const char *Oper;             /* Operand */
+   int     Start;                /* Index of expression in operand */
+   long    Xref, Xend;           /* Compiled expressions of the line */
+   long    Diag;                 /* First message about the line */
+};
+
+struct Deferred {                /* Block of object code held back in single-pass mode */
+   address Addr;                 /* Load address of block */
+   long    Offset;               /* Offset of block in Objbuf */
+   int     Len;                  /* Number of bytes */
+};
+
+struct Asm {                     /* Everything about one assembly */
+   int     Errs,                 /* Error counter */
+           Pass,                 /* Pass 1 or 2, or 3 for single-pass */
+           Onepass,              /* Assemble in a single pass */
+           Forward,              /* Current line has a forward reference */
+           Opstart,              /* Index of expression in current operand */
+           Mode,                 /* Addressing mode of current instruction */
+           Keepabs,              /* Don't shrink to zero-page: sized as absolute in pass 1 */
+           Relax,                /* Iterate pass 1 until the addresses settle */
+           Unguessed,            /* Forward reference with no value from the last pass */
+           Longbranch,           /* Current branch is inverted, round a JMP */
+           Hintchanged,          /* Relaxation changed its mind about a line */
+           Nline,                /* Line number */
+           Nlabels,              /* Number of labels */
+           Maxlabels,            /* Allocated size of symbol table */
+           Hashsize,             /* Number of slots in hash index (power of two) */
+           Lastsym,              /* Symbol defined on current line */
+           Hexfmt,               /* Type of hex file */
+           Trim,                 /* Binary image runs from lowest to highest address used */
+           Fill,                 /* Binary image byte for gaps left by ORG and RMB */
+           Reclen,               /* Bytes per object record */
+           Nbytes;               /* Number of bytes for current instruction */
+   address Addr;                 /* Current assembly address */
+   address Op;                   /* Operand of current instruction */
+   address Lowaddr, Highaddr;    /* Range of addresses in memory image */
+
+   FILE    *Source,              /* Source code fp */
+           *Object,              /* Object code fp */
+           *Listing,             /* Listing fp */ 
+           *Errorfd;             /* Error list fp, or NULL */
+
+   struct Sym *Symbol;           /* The symbol table, in order of definition */
+   int     *Symhash;             /* Open-addressed hash index into Symbol */
+
+   const char *Curlin;           /* Current line, for error messages */
+   int     Curincl;              /* Current file, for error messages */
+   char    *Name;                /* Name of main source, or NULL */
+
+   struct Src *Src;              /* Source files, main source first */
+   long    Nsrcs,                /* Number of source files */
+           Maxsrcs;              /* Allocated size of Src */
+   struct Incl *Incl;            /* Inclusions, main source first */
+   long    Nincls,               /* Number of inclusions */
+           Maxincls;             /* Allocated size of Incl */
+
+   struct Sym *Guess;            /* Symbols from the last relaxation pass */
+   int     *Guesshash;           /* Hash index for Guess */
+   int     Nguesses,             /* Number of symbols in Guess */
+           Guesshashsize;
+   unsigned char *Hint;          /* H_ZP, H_LONG, etc. for each line */
+   long    Nhints,               /* Number of lines with hints */
+           Maxhints,             /* Allocated size of Hint */
+           Recno;                /* Record number of current line */
+
+   struct Ins *Prog;             /* Compiled expressions */
+   long    Nprog,                /* Number of instructions */
+           Maxprog;              /* Allocated size of Prog */
+   struct Xref *Xref;            /* Compiled expressions, in order of lines */
+   long    Nxrefs,               /* Number of compiled expressions */
+           Maxxrefs,             /* Allocated size of Xref */
+           Linexref,             /* First compiled expression of current line */
+           Xnext,                /* Compiled expressions that may be run again */
+           Xend;
+   int     Xkeep;                /* Keep newly compiled expressions */
+
+   struct Rec *Rec;              /* One record per line */
+   long    Nrecs,                /* Number of records */
+           Maxrecs;              /* Allocated size of Rec */
+   const char *Textbuf;          /* Text of the whole source */
+   long    Textlen;              /* Number of characters in Textbuf */
+   char    *Textcopy;            /* Our own copy of the source, if not mapped */
+   long    Maxtext;              /* Allocated size of Textcopy */
+   size_t  Mapped;               /* Size of source mapping, or 0 */
+   unsigned char *Codebuf;       /* Code generated by pass 1 */
+   long    Codelen,              /* Number of bytes in Codebuf */
+           Maxcode;              /* Allocated size of Codebuf */
+
+   int     Byte[MAXBYTES],       /* Bytes of current instruction */
+           Block[MAXBLOCK],      /* Checksum block for 'save' */
+           Blkptr,               /* Pointer to next space in Block */
+           Nblocks;              /* Number of blocks of checksum data */
+   address Blkaddr;              /* Start address of block */
+
+   struct Fix *Fixup;            /* Fixups awaiting resolution */
+   long    Nfixups,              /* Number of fixups */
+           Maxfixups,            /* Allocated size of Fixup */
+           Linefix;              /* First fixup on current line */
+
+   struct Deferred *Defblk;      /* Blocks not yet written */
+   long    Ndefblks,             /* Number of deferred blocks */
+           Maxdefblks;           /* Allocated size of Defblk */
+   unsigned char *Objbuf;        /* Object code bytes in order of generation */
+   long    Objlen,               /* Number of bytes in Objbuf */
+           Maxobj;               /* Allocated size of Objbuf */
+   FILE    *Lstfd;               /* Real listing file in single-pass mode */
+   char    *Lstbuf;              /* Listing text in single-pass mode */
+   size_t  Lstlen;               /* Length of listing text */
+   unsigned char *Image;         /* 64K memory image */
+
+   int     Timing;               /* Print a timing summary */
+   struct Tim *Tim;              /* Instructions, in source order */
+   long    Ntims,                /* Number of instructions in Tim */
+           Maxtims;              /* Allocated size of Tim */
+   struct Tim **Byaddr;          /* Tim, sorted by address */
+   const char *Timlab;           /* Label waiting for the next instruction */
+   int     Timlablen;
+   int     Timbrk;               /* Next instruction doesn't follow on */
+   struct Timed *Timed;          /* Cycle budgets */
+   long    Ntimed,               /* Number of budgets */
+           Maxtimed;             /* Allocated size of Timed */
+   int     Intimed;              /* Between TIMED and ENDTIMED */
+   struct Dly Dly[MAXBYTES];     /* Instructions generated by DELAY */
+   int     Ndly;
+   long    Dlycycles;            /* Cycles they take */
+   char    Hexbuf[HEXBUFSIZE];   /* Object file text waiting to be written */
+   int     Hexlen;               /* Number of characters in Hexbuf */
+
+   char    *Objtext;             /* Object file text from as_buffer() */
+   size_t  Objsize;
+   char    *Lsttext;             /* Listing text from as_buffer() */
+   size_t  Lstsize;
+
+   struct Sym *Presym;           /* Pre-loaded symbols, copied in for each assembly */
+   int     *Prehash;             /* Hash index for Presym */
+   int     Npresyms,             /* Number of pre-loaded symbols */
+           Prehashsize;          /* Size of Prehash */
+
+   struct Diag *Diag;            /* Error and warning messages */
+   long    Ndiags,               /* Number of messages */
+           Maxdiags,             /* Allocated size of Diag */
+           Linediag,             /* First message about current line */
+           Echo,                 /* Pass 1 messages that pass 2 would repeat */
+           Echoend,
+           Nerds;                /* Errors raised, counting repeats */
+};
+
+char    Hexpair[256][2];         /* Two hex digits for each byte value */
+pthread_once_t Inited = PTHREAD_ONCE_INIT;   /* Tables above are filled in once */
+
+struct {
+   char dir[MAXMNEM];
+   int token;
+} Dirtab[] = {
+   {"ORG", ORG},  /* ORG and LOC are synonyms */
+   {"LOC", ORG},
+   {"FCB", FCB},  /* FCB and BYT are synonyms */
+   {"BYT", FCB},
+   {"FCW", FCW},  /* FCW and WRD are synonyms */
+   {"WRD", FCW},
+   {"RMB", RMB},
+   {"TEX", TEX},
+   {"EQU", EQU},
+   {"END", END}   /* END does nothing */
+};
+
+struct {
+   char dir[9];
+   int len;
+   int token;
+} Longdir[] = {      /* Directives that aren't three letters */
+   {"INCLUDE",  7, INCLUDE},
+   {"TIMED",    5, TIMED},
+   {"ENDTIMED", 8, ENDTIMED},
+   {"DELAY",    5, DELAY}
+};
+
+struct Counter Counter[] = {
+   {R_X, 2, 2, 1, 2, MAXCOUNT},      /* LDX #n ... DEX */
+   {R_Y, 2, 2, 1, 2, MAXCOUNT},      /* LDY #n ... DEY */
+   {R_A, 3, 4, 2, 2, MAXCOUNT - 1}   /* LDA #n, SEC ... SBC #1; from zero it would borrow */
+};
+
+struct Binop Binop[] = {      /* Longest first, so that '<<' isn't taken for '<' */
+   {"<<", 7, X_SHL},
+   {">>", 7, X_SHR},
+   {"<=", 6, X_LE},
+   {">=", 6, X_GE},
+   {"<>", 5, X_NE},
+   {"!=", 5, X_NE},
+   {"==", 5, X_EQ},
+   {"*",  9, X_MUL},
+   {"/",  9, X_DIV},
+   {"%",  9, X_MOD},
+   {"+",  8, X_ADD},
+   {"-",  8, X_SUB},
+   {"<",  6, X_LT},
+   {">",  6, X_GT},
+   {"=",  5, X_EQ},
+   {"&",  4, X_AND},
+   {"^",  3, X_XOR},
+   {"|",  2, X_OR}
+};
+
+unsigned int Mnemkey[MNEMSLOTS];   /* Packed mnemonic in each hash slot */
+int          Mnemtok[MNEMSLOTS];   /* Opcode index or directive token */
+
+#ifdef __STDC__
+void reset (struct Asm *as);
+void preload (struct Asm *as);
+void restart (struct Asm *as);
+void relax (struct Asm *as);
+void keep_guesses (struct Asm *as);
+int find_guess (struct Asm *as, const char *label, unsigned int hash);
+unsigned char *hint (struct Asm *as);
+int run (struct Asm *as);
+void read_source (struct Asm *as);
+const char *read_text (FILE *fp, long *lenp, size_t *mappedp, char **copyp, long *maxp);
+void tokenize (const char *lin, struct Toks *t);
+void define_label (struct Asm *as, const char *lin, const struct Toks *t);
+void pass1 (struct Asm *as);
+void source_lines (struct Asm *as, int incl);
+void include (struct Asm *as, const char *name, int len);
+int read_include (struct Asm *as, const char *path);
+void tokenize_file (struct Src *src);
+unsigned long hash_text (const char *text, long len);
+void where (struct Asm *as, char *buf, int size);
+void pass2 (struct Asm *as);
+void keep_line (struct Asm *as, const char *lin, const struct Toks *t, address addr, int mn, const char *cycles, int redo);
+int assemble (struct Asm *as, int mn, const char *oper, char *cycles);
+void instruction (struct Asm *as, int mn, const char *oper, char *cycles);
+int operand (struct Asm *as, const char *oper, int *modep, address *opp);
+int valid_symbol (struct Asm *as, const char *label);
+int add_symbol (struct Asm *as, const char *label, address addr);
+int find_symbol (struct Asm *as, const char *label, unsigned int hash);
+unsigned int hash_symbol (const char *label);
+void grow_symbols (struct Asm *as);
+void one_pass (struct Asm *as);
+void add_fixup (struct Asm *as, int kind, int k, const char *oper, int start);
+void resolve_fixups (struct Asm *as);
+void write_deferred (struct Asm *as);
+void *grow (void *p, long *maxp, long n, size_t size);
+void symbols (struct Asm *as);
+void time_line (struct Asm *as, const char *lin, const struct Toks *t, int mn);
+int cycles_for (int mn, const int *bytes, int nbytes, address addr, long *bestp, long *worstp, address *destp);
+void timing (struct Asm *as);
+int tim_cycles (struct Asm *as, long n, long *bestp, long *worstp, address *destp);
+void time_run (struct Asm *as, long n, int depth);
+long find_tim (struct Asm *as, address addr);
+int by_addr (const void *a, const void *b);
+void check_timed (struct Asm *as);
+void delay (struct Asm *as, const char *oper);
+int pad_bytes (long m);
+long loop_cycles (const struct Counter *c, long k, int pad, address at);
+int dly_chain (struct Asm *as, const struct Counter *c, int pad, long n, address at, int gen);
+void dly_count (struct Asm *as, const struct Counter *c, long k, int pad);
+void dly_pad (struct Asm *as, long m);
+void dly_load (struct Asm *as, const struct Counter *c, long k);
+void dly_loop (struct Asm *as, const struct Counter *c, address top);
+void dly_ins (struct Asm *as, const char *mnem, int cyc, int nbytes, int b1, int b2, int b3);
+void list_delay (struct Asm *as);
+void branch_cycles (char *cycles, address next, address dest);
+int look_up (const char *mnem, int len);
+void init_look_up (void);
+void init_tables (void);
+int opcode_for (struct Asm *as, int mn, int *modep, address *opp, char *cycles);
+void directive (struct Asm *as, int dir, const char *oper);
+int eval (struct Asm *as, const char *str, address *nump);
+int evaluate (struct Asm *as, const char *str, int *ip, address *nump);
+int compile (struct Asm *as, const char *str, int *ip, int prec, int *depthp);
+int term (struct Asm *as, const char *str, int *ip, int *depthp);
+int execute (struct Asm *as, struct Ins *ins, int n, address *nump);
+void emit (struct Asm *as, int op, address val, const char *name);
+int sym (struct Asm *as, const char *str, int *ip, address *nump);
+void nerd (struct Asm *as, const char *str);
+void for_ref (struct Asm *as, const char *str);
+void unused (struct Asm *as, const char *str);
+void diag (struct Asm *as, int warning, const char *msg, const char *lin);
+int repeated (struct Asm *as, const char *msg);
+void list_it (struct Asm *as, const char *cycles, const char *lin, const struct Toks *t, int mn);
+void putbyte (struct Asm *as, int byte);
+void putblock (struct Asm *as);
+void puteof (struct Asm *as);
+void putrecord (struct Asm *as, int type, address addr, const int *data, int len);
+address gctol (const char *str, int *ip, int base);
+#else
+#define const
+void reset ();
+void preload ();
+void restart ();
+void relax ();
+void keep_guesses ();
+int find_guess ();
+unsigned char *hint ();
+int run ();
+void read_source ();
+const char *read_text ();
+void tokenize ();
+void define_label ();
+void pass1 ();
+void source_lines ();
+void include ();
+int read_include ();
+void tokenize_file ();
+unsigned long hash_text ();
+void where ();
+void pass2 ();
+void keep_line ();
+int assemble ();
+void instruction ();
+int operand ();
+int valid_symbol ();
+int add_symbol ();
+int find_symbol ();
+unsigned int hash_symbol ();
+void grow_symbols ();
+void one_pass ();
+void add_fixup ();
+void resolve_fixups ();
+void write_deferred ();
+void *grow ();
+void symbols ();
+void time_line ();
+int cycles_for ();
+void timing ();
+int tim_cycles ();
+void time_run ();
+long find_tim ();
+int by_addr ();
+void check_timed ();
+void delay ();
+int pad_bytes ();
+long loop_cycles ();
+int dly_chain ();
+void dly_count ();
+void dly_pad ();
+void dly_load ();
+void dly_loop ();
+void dly_ins ();
+void list_delay ();
+void branch_cycles ();
+int look_up ();
+void init_look_up ();
+void init_tables ();
+int opcode_for ();
+void directive ();
+int eval ();
+int evaluate ();
+int compile ();
+int term ();
+int execute ();
+void emit ();
+int sym ();
+void nerd ();
+void for_ref ();
+void unused ();
+void diag ();
+int repeated ();
+void list_it ();
+void putbyte ();
+void putblock ();
+void puteof ();
+void putrecord ();
+address gctol ();
+#endif   /* __STDC__ */
+
+/* init_tables --- fill in the tables shared by every context */
+
+void init_tables ()
+{
+   int i;
+
+   for (i = 0; i < 256; i++) {
+      Hexpair[i][0] = "0123456789ABCDEF"[i >> 4];
+      Hexpair[i][1] = "0123456789ABCDEF"[i & 0xf];
+   }
+
+   init_look_up ();
+}
+
+
+/* as_new --- make a new assembler context */
+
+struct Asm *as_new ()
+{
+   struct Asm *as;
+
+   pthread_once (&Inited, init_tables);
+
+   as = calloc (1, sizeof (struct Asm));
+   if (as == NULL)
+      return (NULL);
+
+   as->Image = malloc (IMAGESIZE);
+   if (as->Image == NULL) {
+      free (as);
+      return (NULL);
+   }
+
+   as->Onepass = NO;
+   as->Hexfmt  = MOS_HEX;        /* Hex output file format */
+   as->Trim    = NO;
+   as->Fill    = 0xff;           /* Same as unprogrammed EPROM */
+   as->Reclen  = BYTES_PER_BLOCK;
+
+   grow_symbols (as);            /* Allocate initial symbol table */
+   reset (as);
+
+   return (as);
+}
+
+
+/* as_free --- throw away an assembler context */
+
+void as_free (as)
+struct Asm *as;
+{
+   reset (as);
+   free (as->Symbol);
+   free (as->Symhash);
+   free (as->Rec);
+   free (as->Textcopy);
+   free (as->Codebuf);
+   free (as->Fixup);
+   free (as->Defblk);
+   free (as->Objbuf);
+   free (as->Image);
+   free (as->Diag);
+   free (as->Presym);
+   free (as->Prehash);
+   free (as->Src);
+   free (as->Incl);
+   free (as->Prog);
+   free (as->Xref);
+   free (as->Guess);
+   free (as->Guesshash);
+   free (as->Hint);
+   free (as->Tim);
+   free (as->Timed);
+   free (as->Name);
+   free (as);
+}
+
+
+/* as_option --- set one of the assembler's options */
+
+int as_option (as, opt, val)
+struct Asm *as;
+const int opt;
+const int val;
+{
+   switch (opt) {
+   case OPT_ONEPASS:
+      as->Onepass = val;   /* Single pass, fixing up forward references */
+      break;
+   case OPT_FORMAT:
+      if (val < MOS_HEX || val > BIN_IMAGE)
+         return (ERR);
+
+      as->Hexfmt = val;
+      break;
+   case OPT_TRIM:
+      as->Trim = val;      /* Binary image, lowest to highest address used */
+      break;
+   case OPT_FILL:
+      as->Fill = val & 0xff;
+      break;
+   case OPT_RECLEN:
+      if (val < 1 || val > MAXBLOCK)
+         return (ERR);
+
+      as->Reclen = val;
+      break;
+   case OPT_RELAX:
+      as->Relax = val;     /* Takes two passes or more, even with OPT_ONEPASS */
+      break;
+   case OPT_TIMING:
+      as->Timing = val;
+      break;
+   default:
+      return (ERR);
+   }
+
+   return (OK);
+}
+
+
+/* as_source_name --- name of the main source, for diagnostics and finding INCLUDE files */
+
+void as_source_name (as, name)
+struct Asm *as;
+const char *name;
+{
+   free (as->Name);
+   as->Name = name == NULL ? NULL : strdup (name);
+}
+
+
+/* as_file --- assemble from one file to others, returning the number of errors */
+
+int as_file (as, source, object, listing, errors)
+struct Asm *as;
+FILE *source;
+FILE *object;
+FILE *listing;
+FILE *errors;
+{
+   reset (as);
+
+   as->Source  = source;
+   as->Object  = object;
+   as->Listing = listing;
+   as->Errorfd = errors;
+
+   read_source (as);
+
+   return (run (as));
+}
+
+
+/* as_buffer --- assemble from memory to memory, returning the number of errors */
+
+int as_buffer (as, text, len)
+struct Asm *as;
+const char *text;
+const long len;
+{
+   reset (as);
+
+   if (len > 0L && text[len - 1] != NEWLINE) {  /* Every line ends with a newline */
+      as->Textcopy = grow (as->Textcopy, &as->Maxtext, len + 1, sizeof (char));
+      memcpy (as->Textcopy, text, len);
+      as->Textcopy[len] = NEWLINE;
+      as->Textbuf = as->Textcopy;
+      as->Textlen = len + 1;
+   }
+   else {
+      as->Textbuf = text;
+      as->Textlen = len;
+   }
+
+   as->Object  = open_memstream (&as->Objtext, &as->Objsize);
+   as->Listing = open_memstream (&as->Lsttext, &as->Lstsize);
+   as->Errorfd = NULL;
+
+   if (as->Object == NULL || as->Listing == NULL) {
+      fputs ("as_buffer: out of memory\n", stderr);
+      exit (1);
+   }
+
+   run (as);
+
+   fclose (as->Object);    /* Leaves the text in Objtext and Lsttext */
+   fclose (as->Listing);
+   as->Object = as->Listing = NULL;
+
+   return (as->Errs);
+}
+
+
+/* as_image --- the 64K memory image, and the range of addresses used */
+
+const unsigned char *as_image (as, lowp, highp)
+struct Asm *as;
+long *lowp;
+long *highp;
+{
+   *lowp = as->Lowaddr;
+   *highp = as->Highaddr;    /* Less than *lowp if there's no code */
+
+   return (as->Image);
+}
+
+
+/* as_object --- object file text from as_buffer() */
+
+const char *as_object (as, lenp)
+struct Asm *as;
+size_t *lenp;
+{
+   *lenp = as->Objsize;
+
+   return (as->Objtext);
+}
+
+
+/* as_listing --- listing text from as_buffer() */
+
+const char *as_listing (as, lenp)
+struct Asm *as;
+size_t *lenp;
+{
+   *lenp = as->Lstsize;
+
+   return (as->Lsttext);
+}
+
+
+/* as_ndiags --- number of error and warning messages */
+
+int as_ndiags (as)
+struct Asm *as;
+{
+   return (as->Ndiags);
+}
+
+
+/* as_diag --- one of the error and warning messages */
+
+const struct Diag *as_diag (as, n)
+struct Asm *as;
+const int n;
+{
+   if (n < 0 || n >= as->Ndiags)
+      return (NULL);
+
+   return (&as->Diag[n]);
+}
+
+
+/* as_predefine --- assemble a file of definitions, keeping its symbols for every later assembly */
+
+int as_predefine (as, text, len)
+struct Asm *as;
+const char *text;
+const long len;
+{
+   as_buffer (as, text, len);
+
+   if (as->Errs == 0) {
+      as->Presym = realloc (as->Presym, as->Nlabels * sizeof (struct Sym) + 1);
+      as->Prehash = realloc (as->Prehash, as->Hashsize * sizeof (int));
+      if (as->Presym == NULL || as->Prehash == NULL) {
+         fputs ("as_predefine: out of memory\n", stderr);
+         exit (1);
+      }
+
+      memcpy (as->Presym, as->Symbol, as->Nlabels * sizeof (struct Sym));
+      memcpy (as->Prehash, as->Symhash, as->Hashsize * sizeof (int));
+      as->Npresyms = as->Nlabels;
+      as->Prehashsize = as->Hashsize;
+   }
+
+   return (as->Errs);
+}
+
+
+/* preload --- fill the symbol table with the pre-loaded symbols */
+
+void preload (as)
+struct Asm *as;
+{
+   int i, j;
+
+   as->Nlabels = as->Npresyms;
+
+   if (as->Npresyms == 0) {
+      for (i = 0; i < as->Hashsize; i++)
+         as->Symhash[i] = ERR;
+
+      return;
+   }
+
+   /* Symbol table never shrinks, so there's room */
+   memcpy (as->Symbol, as->Presym, as->Npresyms * sizeof (struct Sym));
+
+   if (as->Hashsize == as->Prehashsize)
+      memcpy (as->Symhash, as->Prehash, as->Hashsize * sizeof (int));
+   else {      /* Table has grown since, so hash them again */
+      for (i = 0; i < as->Hashsize; i++)
+         as->Symhash[i] = ERR;
+
+      for (i = 0; i < as->Nlabels; i++) {
+         for (j = hash_symbol (as->Symbol[i].Label) & (as->Hashsize - 1); as->Symhash[j] != ERR; j = (j + 1) & (as->Hashsize - 1))
+            ;
+
+         as->Symhash[j] = i;
+      }
+   }
+}
+
+
+/* reset --- get ready for a new assembly, keeping the memory we already have */
+
+void reset (as)
+struct Asm *as;
+{
+   int i;
+
+   if (as->Mapped != 0) {
+      munmap ((void *)as->Textbuf, as->Mapped);
+      as->Mapped = 0;
+   }
+
+   for (i = 1; i < as->Nsrcs; i++) {   /* INCLUDE files */
+      if (!as->Src[i].Shared) {
+         if (as->Src[i].Mapped != 0)
+            munmap ((void *)as->Src[i].Text, as->Src[i].Mapped);
+         else
+            free ((void *)as->Src[i].Text);
+
+         free (as->Src[i].Toks);
+      }
+
+      free (as->Src[i].Name);
+   }
+
+   restart (as);
+
+   free (as->Objtext);
+   free (as->Lsttext);
+   as->Objtext = as->Lsttext = NULL;
+   as->Objsize = as->Lstsize = 0;
+
+   for (i = 0; i < MAXBYTES; i++)
+      as->Byte[i] = ERR;
+
+   memset (as->Image, as->Fill, IMAGESIZE);
+   as->Lowaddr  = IMAGESIZE;     /* Nothing in the image yet */
+   as->Highaddr = ADDR(-1);
+
+   as->Textbuf  = NULL;
+   as->Textlen  = 0L;
+   as->Nsrcs    = 0L;
+   as->Nincls   = 0L;
+   as->Nguesses = 0;
+   as->Nhints   = 0L;
+   as->Ntims    = 0L;
+   as->Timlab   = NULL;
+   as->Timbrk   = YES;
+   as->Ntimed   = 0L;
+   as->Intimed  = NO;
+   as->Nfixups  = 0L;
+   as->Ndefblks = 0L;
+   as->Objlen   = 0L;
+   as->Hexlen   = 0;
+   as->Pass     = 0;
+   as->Nbytes   = 0;             /* Number of bytes for current instruction */
+   as->Blkaddr  = ADDR(0);       /* Address of first checksum block */
+   as->Blkptr   = 0;             /* Block pointer */
+   as->Nblocks  = 0;
+}
+
+
+/* restart --- forget everything that pass 1 found out, ready to do it again */
+
+void restart (as)
+struct Asm *as;
+{
+   int i;
+
+   for (i = 0; i < as->Ndiags; i++) {
+      free (as->Diag[i].Msg);
+      free (as->Diag[i].Text);
+      free (as->Diag[i].File);
+   }
+
+   preload (as);        /* Start with the pre-loaded symbols, if any */
+
+   as->Curlin   = "";
+   as->Curincl  = 0;
+   as->Nprog    = 0L;
+   as->Nxrefs   = 0L;
+   as->Xnext    = 0L;
+   as->Xend     = 0L;
+   as->Xkeep    = NO;
+   as->Ndiags   = 0L;
+   as->Echo     = 0L;
+   as->Echoend  = 0L;
+   as->Nerds    = 0L;
+   as->Nrecs    = 0L;
+   as->Codelen  = 0L;
+   as->Forward  = NO;
+   as->Keepabs  = NO;
+   as->Hintchanged = NO;
+   as->Nline    = 0;
+   as->Errs     = 0;
+   as->Lastsym  = ERR;           /* No symbol defined yet */
+   as->Addr     = ADDR(0);       /* Current assembly address */
+}
+
+
+/* run --- assemble the source that's in Textbuf */
+
+int run (as)
+struct Asm *as;
+{
+   struct Src *src;
+
+   /* The main source is the first file, tokenized a line at a time */
+   as->Src = grow (as->Src, &as->Maxsrcs, 0L, sizeof (struct Src));
+   src = &as->Src[0];
+   src->Name = as->Name;
+   src->Text = as->Textbuf;
+   src->Len = as->Textlen;
+   src->Mapped = 0;
+   src->Hash = 0UL;
+   src->Shared = YES;      /* Textbuf is not ours to free */
+   src->Nlines = 0L;
+   src->Toks = NULL;
+   as->Nsrcs = 1L;
+
+   as->Incl = grow (as->Incl, &as->Maxincls, 0L, sizeof (struct Incl));
+   as->Incl[0].Src = 0;
+   as->Incl[0].Parent = ERR;
+   as->Incl[0].Nline = 0;
+   as->Nincls = 1L;
+
+   if (as->Relax) {
+      relax (as);
+      pass2 (as);
+   }
+   else if (as->Onepass)
+      one_pass (as);
+   else {
+      pass1 (as);
+      pass2 (as);
+   }
+
+   if (as->Blkptr != 0)
+      putblock (as);   /* Put out the last block of hex. */
+
+   if (ONEPASS) {
+      resolve_fixups (as);   /* Patch forward references */
+      write_deferred (as);   /* Now write object code and listing */
+   }
+
+   check_timed (as);     /* Now that every byte is known */
+
+   puteof (as);  /* Write EOF marker */
+   
+   symbols (as);
+
+   if (as->Timing)
+      timing (as);
+
+   return (as->Errs);
+}
+
+
+/* read_source --- read the whole of the source file into memory */
+
+void read_source (as)
+struct Asm *as;
+{
+   as->Textbuf = read_text (as->Source, &as->Textlen, &as->Mapped, &as->Textcopy, &as->Maxtext);
+}
+
+
+/* read_text --- map a file into memory, or read it into a buffer that can grow */
+
+const char *read_text (fp, lenp, mappedp, copyp, maxp)
+FILE *fp;
+long *lenp;
+size_t *mappedp;
+char **copyp;
+long *maxp;
+{
+   struct stat st;
+   void *p;
+   size_t n;
+   long len;
+
+   *mappedp = 0;
+
+   if (fstat (fileno (fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (fp), 0);
+      if (p != MAP_FAILED) {
+         if (((const char *)p)[st.st_size - 1] == NEWLINE) {
+            *lenp = st.st_size;
+            *mappedp = st.st_size;
+            return (p);
+         }
+
+         munmap (p, st.st_size);   /* Can't add a newline to the last line */
+      }
+   }
+
+   /* Pipe, terminal, or a file without a final newline: read it the slow way */
+   len = 0L;
+
+   do {
+      *copyp = grow (*copyp, maxp, len + BUFSIZ, sizeof (char));
+      n = fread (*copyp + len, sizeof (char), *maxp - len - 2, fp);
+      len += n;
+   } while (n > 0);
+
+   if (len > 0L && (*copyp)[len - 1] != NEWLINE)
+      (*copyp)[len++] = NEWLINE;   /* Every line ends with a newline */
+
+   (*copyp)[len] = EOS;
+   *lenp = len;
+
+   return (*copyp);
+}
+
+
+/* pass1 --- define the labels and keep a record of each line */
+
+void pass1 (as)
+struct Asm *as;
+{
+   as->Pass = 1;
+
+   source_lines (as, 0);
+}
+
+
+/* relax --- repeat pass 1, with each forward reference taking its value from the
+ * pass before, until no label moves.  Then do it once more for real. */
+
+void relax (as)
+struct Asm *as;
+{
+   FILE *errorfd;
+   int converged;
+   int n, i;
+
+   errorfd = as->Errorfd;     /* Keep quiet until the last time round */
+   as->Errorfd = NULL;
+   converged = NO;
+
+   for (n = 0; n < MAXRELAX && !converged; n++) {
+      restart (as);
+      as->Nincls = 1L;        /* Just the main source */
+      pass1 (as);
+
+      converged = !as->Hintchanged && as->Nguesses == as->Nlabels;
+
+      for (i = 0; converged && i < as->Nlabels; i++)
+         if (as->Symbol[i].Address != as->Guess[i].Address)
+            converged = NO;
+
+      keep_guesses (as);
+   }
+
+   if (!converged) {    /* Oscillating: size everything the usual way */
+      as->Nguesses = 0;
+      as->Nhints = 0L;
+   }
+
+   as->Errorfd = errorfd;
+   restart (as);
+   as->Nincls = 1L;
+   pass1 (as);
+}
+
+
+/* keep_guesses --- remember this pass's symbols for the next */
+
+void keep_guesses (as)
+struct Asm *as;
+{
+   if (as->Nlabels == 0) {
+      as->Nguesses = 0;
+      return;
+   }
+
+   as->Guess = realloc (as->Guess, as->Nlabels * sizeof (struct Sym));
+   as->Guesshash = realloc (as->Guesshash, as->Hashsize * sizeof (int));
+   if (as->Guess == NULL || as->Guesshash == NULL) {
+      fputs ("Relaxation: out of memory\n", stderr);
+      exit (1);
+   }
+
+   memcpy (as->Guess, as->Symbol, as->Nlabels * sizeof (struct Sym));
+   memcpy (as->Guesshash, as->Symhash, as->Hashsize * sizeof (int));
+   as->Nguesses = as->Nlabels;
+   as->Guesshashsize = as->Hashsize;
+}
+
+
+/* find_guess --- look up a forward reference in the last pass's symbols */
+
+int find_guess (as, label, hash)
+struct Asm *as;
+const char label[];
+const unsigned int hash;
+{
+   int i, n;
+
+   if (as->Nguesses == 0)
+      return (ERR);
+
+   for (i = hash & (as->Guesshashsize - 1); (n = as->Guesshash[i]) != ERR; i = (i + 1) & (as->Guesshashsize - 1))
+      if (strcmp (label, as->Guess[n].Label) == 0)
+         return (n);
+
+   return (ERR);
+}
+
+
+/* hint --- what relaxation has decided about the current line */
+
+unsigned char *hint (as)
+struct Asm *as;
+{
+   if (as->Recno >= as->Nhints) {
+      as->Hint = grow (as->Hint, &as->Maxhints, as->Recno, sizeof (unsigned char));
+      memset (as->Hint + as->Nhints, 0, as->Recno + 1 - as->Nhints);
+      as->Nhints = as->Recno + 1;
+   }
+
+   return (&as->Hint[as->Recno]);
+}
+
+
+/* source_lines --- assemble each line of one inclusion of a source file */
+
+void source_lines (as, incl)
+struct Asm *as;
+const int incl;
+{
+   char cycles[MAXCYCSTR];
+   struct Toks t;
+   const struct Toks *toks;
+   const struct Src *src;
+   const char *lin, *next, *end;
+   long n;
+   int i;
+   int mn;
+   int errs;
+   int redo;
+   address here;
+
+   src = &as->Src[as->Incl[incl].Src];
+   end = src->Text + src->Len;
+   as->Xkeep = YES;        /* Each expression is compiled once, here */
+   toks = src->Toks;       /* NULL for the main source */
+   n = 0L;
+
+   as->Curincl = incl;
+   as->Nline = 0;
+
+   for (lin = src->Text; lin < end; lin = next) {
+      next = (const char *)memchr (lin, NEWLINE, end - lin) + 1;
+      as->Curlin = lin;
+      as->Nline++;
+      as->Nbytes = 0;
+      cycles[0] = EOS;
+      mn = ERR;
+      as->Forward = NO;
+      as->Mode = ERR;
+      as->Lastsym = ERR;
+      as->Linefix = as->Nfixups;
+      as->Linexref = as->Nxrefs;
+      as->Recno = as->Nrecs;
+#ifdef DB
+      fprintf (stderr, "%4d: %.*s", as->Nline, (int)(next - lin), lin);
+#endif   /* DB */
+
+      if (toks != NULL)       /* Tokenized already */
+         t = toks[n++];
+      else
+         tokenize (lin, &t);
+
+      if (t.Lablen != 0)      /* Fill in the Symbol Table */
+         define_label (as, lin, &t);
+
+      errs = as->Errs;
+      as->Linediag = as->Ndiags;
+      here = as->Addr;      /* ORG and RMB will change Addr */
+
+      if (t.Mnemlen != 0) {      /* Ignore comment lines */
+         mn = assemble (as, look_up (lin + t.Mnem, t.Mnemlen), OPERAND(lin, &t), cycles);
+         if (mn == ERR)
+            nerd (as, "Unfroodish mnemonic");
+      }
+
+      if (ONEPASS) {
+         if (mn != ERR) {
+            for (i = 0; i < as->Nbytes; i++)
+               putbyte (as, as->Byte[i]);
+         }
+
+         list_it (as, cycles, lin, &t, mn);
+         redo = (as->Nfixups != as->Linefix);
+
+         if (as->Timing || as->Intimed)
+            time_line (as, lin, &t, mn);
+      }
+      else {
+         /* Anything that might come out differently in pass 2 must be done again */
+         redo = as->Forward || as->Errs != errs || as->Mode == RELATIVE || mn == ORG || mn == RMB ||
+                mn == TIMED || mn == ENDTIMED || mn == DELAY;
+         keep_line (as, lin, &t, here, mn, cycles, redo);
+      }
+
+      if (!redo && as->Nxrefs != as->Linexref) {   /* Its expressions won't be run again */
+         as->Nprog = as->Xref[as->Linexref].Prog;
+         as->Nxrefs = as->Linexref;
+      }
+
+      as->Addr += ADDR(as->Nbytes);
+
+      if (mn == INCLUDE) {
+         include (as, lin + t.Oper, t.Operlen);
+         as->Curincl = incl;     /* Back to this file; Src may have moved */
+         end = as->Src[as->Incl[incl].Src].Text + as->Src[as->Incl[incl].Src].Len;
+      }
+   }
+}
+
+
+/* include --- assemble the lines of an INCLUDE file */
+
+void include (as, name, len)
+struct Asm *as;
+const char *name;
+int len;
+{
+   char path[FILENAME_MAX];
+   const char *slash;
+   const char *parent;
+   struct Incl *in;
+   int depth;
+   int i;
+   int s;
+   int nline;
+
+   if (len >= 2 && (name[0] == '"' || name[0] == '\'') && name[len - 1] == name[0]) {
+      name++;     /* Strip the quotes */
+      len -= 2;
+   }
+
+   if (len == 0) {
+      nerd (as, "Missing INCLUDE file name");
+      return;
+   }
+
+   for (depth = 0, i = as->Curincl; i != ERR; i = as->Incl[i].Parent)
+      depth++;
+
+   if (depth > MAXNEST) {
+      nerd (as, "INCLUDE files nested too deeply");
+      return;
+   }
+
+   /* Names are relative to the directory of the file doing the including */
+   parent = as->Src[as->Incl[as->Curincl].Src].Name;
+
+   if (name[0] != '/' && parent != NULL && (slash = strrchr (parent, '/')) != NULL)
+      snprintf (path, sizeof (path), "%.*s%.*s", (int)(slash - parent + 1), parent, len, name);
+   else
+      snprintf (path, sizeof (path), "%.*s", len, name);
+
+   if ((s = read_include (as, path)) == ERR) {
+      nerd (as, "Can't open INCLUDE file");
+      return;
+   }
+
+   as->Incl = grow (as->Incl, &as->Maxincls, as->Nincls, sizeof (struct Incl));
+   in = &as->Incl[as->Nincls];
+   in->Src = s;
+   in->Parent = as->Curincl;
+   in->Nline = as->Nline;
+
+   nline = as->Nline;
+   source_lines (as, as->Nincls++);
+   as->Nline = nline;
+}
+
+
+/* read_include --- find a source file in the cache, or read and tokenize it */
+
+int read_include (as, path)
+struct Asm *as;
+const char *path;
+{
+   struct Src *src;
+   FILE *fp;
+   char *copy;
+   long max;
+   int i;
+
+   for (i = 1; i < as->Nsrcs; i++)     /* Same name: no need even to read it */
+      if (strcmp (as->Src[i].Name, path) == 0)
+         return (i);
+
+   if ((fp = fopen (path, READ)) == NULL)
+      return (ERR);
+
+   as->Src = grow (as->Src, &as->Maxsrcs, as->Nsrcs, sizeof (struct Src));
+   src = &as->Src[as->Nsrcs];
+
+   copy = NULL;
+   max = 0L;
+   src->Text = read_text (fp, &src->Len, &src->Mapped, &copy, &max);
+   fclose (fp);
+
+   src->Name = strdup (path);
+   src->Hash = hash_text (src->Text, src->Len);
+   src->Shared = NO;
+   src->Nlines = 0L;
+   src->Toks = NULL;
+
+   if (src->Mapped != 0)
+      free (copy);
+
+   /* Same text under another name? Then use the tokens we already have */
+   for (i = 1; i < as->Nsrcs; i++) {
+      if (!as->Src[i].Shared && as->Src[i].Hash == src->Hash && as->Src[i].Len == src->Len &&
+          memcmp (as->Src[i].Text, src->Text, src->Len) == 0) {
+         if (src->Mapped != 0)
+            munmap ((void *)src->Text, src->Mapped);
+         else
+            free ((void *)src->Text);
+
+         src->Text = as->Src[i].Text;
+         src->Mapped = 0;
+         src->Shared = YES;
+         src->Nlines = as->Src[i].Nlines;
+         src->Toks = as->Src[i].Toks;
+
+         return (as->Nsrcs++);
+      }
+   }
+
+   tokenize_file (src);
+
+   return (as->Nsrcs++);
+}
+
+
+/* tokenize_file --- find the fields of every line of a file, once and for all */
+
+void tokenize_file (src)
+struct Src *src;
+{
+   const char *lin;
+   const char *const end = src->Text + src->Len;
+   long n, max;
+
+   n = max = 0L;
+
+   for (lin = src->Text; lin < end; lin = (const char *)memchr (lin, NEWLINE, end - lin) + 1) {
+      src->Toks = grow (src->Toks, &max, n, sizeof (struct Toks));
+      tokenize (lin, &src->Toks[n++]);
+   }
+
+   src->Nlines = n;
+}
+
+
+/* hash_text --- FNV-1a hash of a whole file */
+
+unsigned long hash_text (text, len)
+const char *text;
+long len;
+{
+   unsigned long h;
+
+   for (h = 2166136261UL; len > 0; len--, text++)
+      h = ((h ^ (unsigned char)*text) * 16777619UL) & 0xffffffffUL;
+
+   return (h);
+}
+
+
+/* keep_line --- make a record of the current line for pass 2 */
+
+void keep_line (as, lin, t, addr, mn, cycles, redo)
+struct Asm *as;
+const char *lin;
+const struct Toks *t;
+const address addr;
+const int mn;
+const char cycles[];
+const int redo;
+{
+   struct Rec *r;
+   int i;
+
+   as->Rec = grow (as->Rec, &as->Maxrecs, as->Nrecs, sizeof (struct Rec));
+   r = &as->Rec[as->Nrecs++];
+
+   r->Line   = lin;
+   r->Nline  = as->Nline;
+   r->Incl   = as->Curincl;
+   r->Xref   = as->Linexref;
+   r->Nxrefs = redo ? NUM(as->Nxrefs - as->Linexref) : 0;
+   r->Toks   = *t;
+   r->Mn     = mn;
+   r->Mode   = as->Mode;
+   r->Op     = as->Op;
+   r->Addr   = addr;
+   r->Nbytes = as->Nbytes;
+   r->Redo   = redo;
+   r->Fwd    = as->Forward;
+   r->Diag   = as->Linediag;
+   r->Ndiags = NUM(as->Ndiags - as->Linediag);
+   strcpy (r->Cycles, cycles);
+
+   r->Code = as->Codelen;
+
+   if (!redo) {      /* Code is final already */
+      as->Codebuf = grow (as->Codebuf, &as->Maxcode, as->Codelen + as->Nbytes, sizeof (unsigned char));
+
+      for (i = 0; i < as->Nbytes; i++)
+         as->Codebuf[as->Codelen++] = as->Byte[i];
+   }
+}
+
+
+/* pass2 --- generate code and listing from the pass 1 records */
+
+void pass2 (as)
+struct Asm *as;
+{
+   char cycles[MAXCYCSTR];
+   struct Rec *r;
+   const char *lin;
+   long n;
+   int i;
+   int mn;
+
+   as->Nblocks = 0;         /* Reset hex block counter */
+   as->Pass = 2;            /* Second pass */
+   as->Xkeep = NO;
+   as->Addr  = ADDR(0);     /* reset current address pointer */
+
+   for (n = 0; n < as->Nrecs; n++) {
+      r = &as->Rec[n];
+      lin = as->Curlin = r->Line;
+      as->Nline = r->Nline;
+      as->Curincl = r->Incl;
+      as->Xnext = r->Xref;
+      as->Xend = r->Xref + r->Nxrefs;
+      as->Forward = NO;
+
+      if (r->Addr != as->Addr) {
+         nerd (as, "Internal error: address differs from pass 1");
+         as->Addr = r->Addr;
+      }
+
+      if (r->Redo) {
+         as->Nbytes = 0;
+         cycles[0] = EOS;
+         mn = ERR;
+         as->Keepabs = r->Fwd && r->Nbytes == 3;    /* Keep the size chosen in pass 1 */
+         as->Recno = n;
+         as->Echo = r->Diag;        /* Don't say it all twice */
+         as->Echoend = r->Diag + r->Ndiags;
+
+         if (r->Toks.Mnemlen != 0)     /* Ignore comments */
+            mn = assemble (as, r->Mn, OPERAND(lin, &r->Toks), cycles);
+
+         as->Keepabs = NO;
+         as->Echo = as->Echoend = 0L;
+
+         if (r->Ndiags > 0 && as->Addr != r->Addr) {   /* ORG or RMB that failed in pass 1 */
+            as->Addr = r->Addr;     /* Go on as pass 1 did, and report it just the once */
+            as->Blkaddr = as->Addr;
+         }
+
+         if (as->Nbytes != r->Nbytes) {
+            nerd (as, "Internal error: size differs from pass 1");
+            as->Nbytes = r->Nbytes;
+         }
+      }
+      else {
+         mn = r->Mn;
+         as->Nbytes = r->Nbytes;
+         strcpy (cycles, r->Cycles);
+
+         for (i = 0; i < as->Nbytes; i++)
+            as->Byte[i] = as->Codebuf[r->Code + i];
+      }
+
+      if (mn != ERR) {
+         for (i = 0; i < as->Nbytes; i++)
+            putbyte (as, as->Byte[i]);
+      }
+
+      list_it (as, cycles, lin, &r->Toks, mn);
+
+      if (as->Timing || as->Intimed)
+         time_line (as, lin, &r->Toks, mn);
+
+      as->Addr += ADDR(as->Nbytes);
+   }
+}
+
+
+/* one_pass --- read the source once, recording forward references for later */
+
+void one_pass (as)
+struct Asm *as;
+{
+   as->Pass = 3;
+
+   as->Lstfd = as->Listing;     /* Listing is held in memory until it can be patched */
+   as->Listing = open_memstream (&as->Lstbuf, &as->Lstlen);
+   if (as->Listing == NULL) {
+      fputs ("Listing: out of memory\n", stderr);
+      exit (1);
+   }
+
+   source_lines (as, 0);
+}
+
+
+/* tokenize --- find the fields of a source line, without copying them */
+
+void tokenize (lin, t)
+const char lin[];
+struct Toks *t;
+{
+   int i;
+
+   t->Label = t->Mnem = t->Oper = t->Comment = 0;
+   t->Lablen = t->Mnemlen = t->Operlen = t->Commlen = 0;
+
+   if (lin[0] == NEWLINE)     /* Blank line */
+      return;
+   else if (lin[0] == COMMENT_SYM) {   /* Entire line is a comment */
+      for (i = 0; lin[i] != NEWLINE; i++)
+         ;
+
+      t->Commlen = i;
+      return;
+   }
+
+   for (i = 0; (lin[i] != ' ') && (lin[i] != LABEL_SYM) && (lin[i] != NEWLINE); i++)
+      ;
+
+   t->Lablen = i;
+   
+   if (lin[i] == LABEL_SYM)   /* Skip the colon if there was one */
+      i++;
+   
+   SKIPBL(lin, i);   /* Skip blanks between label and mnemonic */
+
+   if (lin[i] != COMMENT_SYM) {
+      t->Mnem = i;
+      for ( ; lin[i] != ' ' && lin[i] != NEWLINE; i++)
+         ;
+
+      t->Mnemlen = i - t->Mnem;
+   }
+
+   while (lin[i] == ' ')  /* Skip blanks between mnemonic and operand */
+      i++;
+
+   if (lin[i] != COMMENT_SYM && lin[i] != NEWLINE) {
+      t->Oper = i;
+      if (lin[i] == '"' || lin[i] == '\'') {   /* Allow for quoted operands */
+         const char quote = lin[i];    /* terminating character */
+
+         for (i++; lin[i] != quote && lin[i] != NEWLINE; i++)
+            ;
+
+         for ( ; lin[i] != ' ' && lin[i] != NEWLINE; i++)   /* Closing quote, maybe more */
+            ;
+
+         t->Operlen = i - t->Oper;
+         SKIPBL(lin, i);
+      }
+      else {   /* Normal operand - not quoted */
+         for ( ; lin[i] != ' ' && lin[i] != NEWLINE; i++)
+            ;
+
+         t->Operlen = i - t->Oper;
+
+         while (lin[i] == ' ')
+            i++;
+      }
+   }
+   else
+      t->Oper = i;   /* Empty operand */
+
+   t->Comment = i;
+   for ( ; lin[i] != NEWLINE; i++)
+      ;
+
+   t->Commlen = i - t->Comment;
+}
+
+
+/* define_label --- put the label on the current line into the symbol table */
+
+void define_label (as, lin, t)
+struct Asm *as;
+const char lin[];
+const struct Toks *t;
+{
+   char label[MAXLABEL];
+   const int len = FIELD(t->Lablen, MAXLABEL - 1);   /* Truncate excessively long labels */
+
+   memcpy (label, lin + t->Label, len);
+   label[len] = EOS;
+
+   if (t->Lablen != len) {
+      char msg[128];
+
+      snprintf (msg, sizeof (msg), "Warning: %s: label truncated at %d characters", label, MAXLABEL - 1);
+      diag (as, YES, msg, NULL);
+   }
+
+   if (valid_symbol (as, label) == OK)
+      if (add_symbol (as, label, as->Addr) == ERR)
+         nerd (as, "Duplicate label");
+}
+
+
+/* assemble --- do a line of assembly */
+
+int assemble (as, mn, oper, cycles)
+struct Asm *as;
+const int mn;
+const char oper[];
+char cycles[];
+{
+   if (as->Addr > 0xffffL)
+      nerd (as, "Current address beyond $FFFF");
+
+   if (mn == ERR)       /* Ignore illegal mnemonics */
+      return (mn);
+
+   if (IS_DIRECTIVE(mn)) { /* Sort out directives */
+      directive (as, mn, oper);
+      cycles[0] = EOS;
+   }
+   else
+      instruction (as, mn, oper, cycles);
+      
+   return (mn);
+}
+
+
+/* instruction --- handle instructions */
+
+void instruction (as, mn, oper, cycles)
+struct Asm *as;
+const int mn;
+const char oper[];
+char cycles[];
+{
+   int mode;
+   address op;
+
+   as->Unguessed = NO;
+   as->Longbranch = NO;
+
+   if (operand (as, oper, &mode, &op) != ERR) {
+      if (as->Forward && as->Unguessed)
+         op = FORWARD;     /* Size as absolute until we know better */
+
+      as->Byte[0] = opcode_for (as, mn, &mode, &op, cycles);  /* Work out opcode */
+      if (as->Byte[0] == ERR)
+         nerd (as, "Illegal instruction/address mode");
+
+      as->Mode = mode;
+      as->Op = op;
+
+      switch (mode) {
+      case INHERENT:
+         as->Nbytes = 1;
+         break;         /* No address bytes */
+      case RELATIVE:
+         if (as->Longbranch) {      /* Bxx *+5 with the condition inverted, then JMP */
+            as->Byte[0] ^= INVERT_BRANCH;
+            as->Byte[1] = 3;
+            as->Byte[2] = JMP_ABS;
+            as->Byte[3] = NUM(op & 0xff);
+            as->Byte[4] = HIGH(op);
+            as->Nbytes = 5;
+            break;
+         }
+
+         as->Byte[1] = NUM(op & 0xff);
+         as->Nbytes = 2;
+
+         if (ONEPASS && as->Forward)
+            add_fixup (as, FIX_REL, 1, oper, as->Opstart);
+         break;
+      case IMMEDIATE:
+      case Z_PAGE:
+      case Z_INDEX_X:
+      case Z_INDEX_Y:
+      case INDIRECT_X:
+      case INDIRECT_Y:
+         if (!BYTE_RANGE(op)) {
+            if (!as->Forward)    /* Don't know the value yet */
+               nerd (as, "operand too big");
+
+            as->Byte[1] = 0xff;
+         }
+         else
+            as->Byte[1] = NUM(op & 0xff);
+
+         as->Nbytes = 2;
+
+         if (ONEPASS && as->Forward)
+            add_fixup (as, FIX_BYTE, 1, oper, as->Opstart);
+         break;
+      case ABSOLUTE:
+      case INDEX_X:
+      case INDEX_Y:
+      case INDIRECT:
+         as->Byte[1] = NUM(op & 0xff);
+         as->Byte[2] = HIGH(op);
+         as->Nbytes = 3;
+
+         if (ONEPASS && as->Forward)
+            add_fixup (as, FIX_WORD, 1, oper, as->Opstart);
+         break;
+      default:
+         fprintf (stderr, "%d: bad mode\n", mode);
+         /* Falls through */
+      case ERR:
+         as->Nbytes = 0;
+         cycles[0] = EOS;
+         break;
+      }
+   }
+}
+
+
+/* operand --- sort out the operand and address mode */
+
+int operand (as, oper, modep, opp)
+struct Asm *as;
+const char oper[];
+int *modep;
+address *opp;
+{
+   int mode;
+   int i;
+   int stat;
+   long nerds;
+
+   mode = ERR;          /* Guilty until proven innocent... */
+   stat = ERR;
+   nerds = as->Nerds;
+
+   if (ENDOPER(oper[0]) || (AREG(oper[0]) && ENDOPER(oper[1]))) {
+      mode = INHERENT;
+      stat = OK;
+      *modep = mode;
+      return (OK);
+   }
+   else if (oper[0] == IMM_SYM) {
+      mode = IMMEDIATE;
+      i = as->Opstart = 1;  /* Skip the '#'... */
+      stat = evaluate (as, oper, &i, opp);
+   }
+   else if (oper[0] == INDIRECT_SYM) {
+      i = as->Opstart = 1;
+      stat = evaluate (as, oper, &i, opp);
+      if (oper[i] == INDEX_SYM && XREG(oper[i+1]) &&
+          oper[i+2] == INDIRECT_END && ENDOPER(oper[i+3])) {
+         i += 3;
+         mode = INDIRECT_X;      /* LDA (PTR,X) */
+      }
+      else if (oper[i] == INDIRECT_END && oper[i+1] == INDEX_SYM &&
+               YREG(oper[i+2]) && ENDOPER(oper[i+3])) {
+         i += 3;
+         mode = INDIRECT_Y;      /* LDA (PTR),Y */
+      }                   
+      else if (oper[i] == INDIRECT_END && ENDOPER(oper[i+1])) {
+         i++;   
+         mode = INDIRECT;        /* JMP (PTR) */
+      }
+      else
+         mode = ERR;
+   }
+   else {
+      i = as->Opstart = 0;
+      stat = evaluate (as, oper, &i, opp);
+      if (oper[i] == INDEX_SYM) {
+         if (XREG(oper[i+1]) && ENDOPER(oper[i+2])) {
+            i += 2;
+            mode = INDEX_X;   /* LDA TAB,X */
+         }
+         else if (YREG(oper[i+1]) && ENDOPER(oper[i+2])) {
+            i += 2;
+            mode = INDEX_Y;   /* LDA TAB,Y */
+         }
+         else
+            mode = ERR;
+      }
+      else
+         mode = ABSOLUTE;     /* LDA ABS */
+   }
+   
+#ifdef DB
+   fprintf (stderr, "stat = %d, mode = %d, i = %d\n", stat, mode, i);
+#endif
+
+   *modep = mode;
+
+   if (mode == ERR || !ENDOPER(oper[i])) {   /* Look for extra characters at end of line */
+      if (PASS1)
+         nerd (as, "Bad syntax in operand");
+
+      return (ERR);  /* No code in either pass, so that the sizes agree */
+   }
+
+   if ((stat == ERR) && PASS2 && !(ONEPASS && as->Forward)) {
+      if (as->Nerds == nerds)    /* Not out of range, say */
+         nerd (as, "Undefined label");
+      *opp = (address)0xffff;    /* Dummy address */
+      return (OK); /* Allow code generation anyway */
+   }
+
+   return (OK);
+}
+
+
+/*  valid_symbol --- test a label for invalid characters */
+
+int valid_symbol (as, label)
+struct Asm *as;
+const char label[];
+{
+   int i;
+   
+   if (isdigit (label[0])) {
+      nerd (as, "Label names must not begin with a digit");
+      return (ERR);
+   }
+   
+   for (i = 0; label[i] != EOS; i++) {
+      if (!(isalpha (label[i]) || isdigit (label[i]) || (label[i] == '_'))) {
+         nerd (as, "Invalid character(s) in label name");
+         return (ERR);
+      }
+   }
+   
+   if (AREG(label[0]) && (label[1] == EOS)) {
+      nerd (as, "Labels may not be named 'A' or 'a'");
+      return (ERR);
+   }
+   
+   return (OK);
+}
+
+
+/* add_symbol --- add a symbol to the symbol table */
+
+int add_symbol (as, label, addr)
+struct Asm *as;
+const char label[];
+const address addr;
+{
+   unsigned int h;
+   int i;
+   
+#ifdef DB
+   fprintf (stderr, "add_symbol: label = '%s'\n", label);
+#endif
+   
+   h = hash_symbol (label);
+
+   if (find_symbol (as, label, h) != ERR) {
+      as->Lastsym = ERR;
+      return (ERR);
+   }
+
+   if (as->Nlabels >= as->Maxlabels || (as->Nlabels * 2) >= as->Hashsize) {
+      grow_symbols (as);
+      h = hash_symbol (label);   /* Hash size may have changed */
+   }
+
+   for (i = h & (as->Hashsize - 1); as->Symhash[i] != ERR; i = (i + 1) & (as->Hashsize - 1))
+      ;
+      
+   strcpy (as->Symbol[as->Nlabels].Label, label);
+   as->Symbol[as->Nlabels].Address = addr;
+   as->Symbol[as->Nlabels].References = 0;
+   as->Symhash[i] = as->Nlabels;
+   as->Lastsym = as->Nlabels;
+
+   as->Nlabels++;
+   
+   return (OK);
+}
+
+
+/* find_symbol --- return index of a symbol in the symbol table, or ERR */
+
+int find_symbol (as, label, hash)
+struct Asm *as;
+const char label[];
+const unsigned int hash;
+{
+   int i, n;
+
+   for (i = hash & (as->Hashsize - 1); (n = as->Symhash[i]) != ERR; i = (i + 1) & (as->Hashsize - 1))
+      if (strcmp (label, as->Symbol[n].Label) == 0)
+         return (n);
+
+   return (ERR);
+}
+
+
+/* hash_symbol --- FNV-1a hash of a label name */
+
+unsigned int hash_symbol (label)
+const char label[];
+{
+   unsigned int h;
+
+   for (h = 2166136261u; *label != EOS; label++)
+      h = (h ^ (unsigned char)*label) * 16777619u;
+
+   return (h);
+}
+
+
+/* grow_symbols --- double the size of the symbol table and rebuild the hash index */
+
+void grow_symbols (as)
+struct Asm *as;
+{
+   int i, j;
+
+   if (as->Nlabels >= as->Maxlabels) {
+      as->Maxlabels = (as->Maxlabels == 0) ? INITSYMBOLS : as->Maxlabels * 2;
+      as->Symbol = realloc (as->Symbol, as->Maxlabels * sizeof (struct Sym));
+      if (as->Symbol == NULL) {
+         fputs ("Symbol table: out of memory\n", stderr);
+         exit (1);
+      }
+   }
+
+   if ((as->Nlabels * 2) >= as->Hashsize || as->Symhash == NULL) {
+      as->Hashsize = (as->Hashsize == 0) ? (INITSYMBOLS * 2) : as->Hashsize * 2;
+      free (as->Symhash);
+      as->Symhash = malloc (as->Hashsize * sizeof (int));
+      if (as->Symhash == NULL) {
+         fputs ("Symbol table: out of memory\n", stderr);
+         exit (1);
+      }
+
+      for (i = 0; i < as->Hashsize; i++)
+         as->Symhash[i] = ERR;
+
+      for (i = 0; i < as->Nlabels; i++) {
+         for (j = hash_symbol (as->Symbol[i].Label) & (as->Hashsize - 1); as->Symhash[j] != ERR; j = (j + 1) & (as->Hashsize - 1))
+            ;
+
+         as->Symhash[j] = i;
+      }
+   }
+}
+
+
+/* symbols --- print the symbol table */
+
+void symbols (as)
+struct Asm *as;
+{
+   int i;
+
+   fprintf (as->Listing, "\nSymbol Table\n\n");
+
+   for (i = 0; i < as->Nlabels; i++) {
+      if (as->Symbol[i].References == 0 && i >= as->Npresyms)
+         unused (as, as->Symbol[i].Label);
+         
+      fprintf (as->Listing, "%-15.15s %04lX  ", as->Symbol[i].Label, as->Symbol[i].Address & 0xffff);
+      if ((i % 4) == 3)
+         putc (NEWLINE, as->Listing);
+   }
+
+   fprintf (as->Listing, "\n\n%d labels used\n", as->Nlabels);
+}
+
+
+/* time_line --- note an instruction for the timing summary */
+
+void time_line (as, lin, t, mn)
+struct Asm *as;
+const char lin[];
+const struct Toks *t;
+const int mn;
+{
+   struct Tim *tp;
+   int i;
+
+   if (mn == EQU || mn == INCLUDE || mn == END || mn == TIMED || mn == ENDTIMED)
+      return;
+
+   if (t->Lablen != 0 && as->Timlab == NULL) {    /* First label names the routine */
+      as->Timlab = lin + t->Label;
+      as->Timlablen = FIELD(t->Lablen, MAXLABEL - 1);
+   }
+
+   if (mn == ERR || as->Nbytes == 0) {
+      if (t->Mnemlen != 0) {      /* ORG, RMB, or an error */
+         as->Timlab = NULL;
+         as->Timbrk = YES;
+      }
+
+      return;
+   }
+
+   if (IS_DIRECTIVE(mn) && mn != DELAY) {    /* Data: not code that runs on */
+      as->Timlab = NULL;
+      as->Timbrk = YES;
+      return;
+   }
+
+   as->Tim = grow (as->Tim, &as->Maxtims, as->Ntims, sizeof (struct Tim));
+   tp = &as->Tim[as->Ntims++];
+   tp->Addr = as->Addr;
+   tp->Mn = mn;
+   tp->Nbytes = as->Nbytes;
+   tp->Cycles = as->Dlycycles;
+   tp->Label = as->Timlab;
+   tp->Lablen = as->Timlablen;
+   tp->Brk = as->Timbrk;
+   tp->Open = NO;
+   tp->Done = NO;
+
+   for (i = 0; i < FIELD(tp->Nbytes, MAXINSN); i++)
+      tp->Code[i] = NUM(as->Byte[i] & 0xff);
+
+   as->Timlab = NULL;
+   as->Timbrk = NO;
+}
+
+
+/* cycles_for --- fewest and most cycles for an instruction, and where it goes next.
+ * For a branch, the fewest is when it is not taken and the most when it is. */
+
+int cycles_for (mn, bytes, nbytes, addr, bestp, worstp, destp)
+const int mn;
+const int bytes[];
+const int nbytes;
+const address addr;
+long *bestp, *worstp;
+address *destp;
+{
+   address next, base;
+   int mode, op;
+
+   op = (nbytes == 5) ? bytes[0] ^ INVERT_BRANCH : bytes[0];   /* Stretched, its condition inverted */
+
+   for (mode = 0; mode < MAXMODES; mode++)
+      if (Opcodes[mn].obj[mode] == op)
+         break;
+
+   if (mode == MAXMODES)
+      return (ERR);
+
+   next = addr + ADDR(2);
+   base = (nbytes > 2) ? (bytes[1] | (bytes[2] << 8)) : bytes[1];
+   *destp = base;
+   *bestp = *worstp = Opcodes[mn].cyc[mode];
+
+   switch (mode) {
+   case RELATIVE:
+      if (nbytes == 5) {      /* Inverted branch round a JMP */
+         *destp = bytes[3] | (bytes[4] << 8);
+         *bestp = BRANCH_TAKEN(next, next + ADDR(3));
+         *worstp = 2 + 3;
+      }
+      else {
+         *destp = (next + (address)(signed char)bytes[1]) & 0xffff;
+         *worstp = BRANCH_TAKEN(next, *destp);
+      }
+      return (T_BRANCH);
+   case INDEX_X:
+   case INDEX_Y:
+      if ((Opcodes[mn].flags & F_PAGE) && (base & 0xff) != 0)
+         (*worstp)++;      /* Some index would cross into the next page */
+      break;
+   case INDIRECT_Y:
+      if (Opcodes[mn].flags & F_PAGE)
+         (*worstp)++;      /* Pointer isn't known until it runs */
+      break;
+   }
+
+   switch (bytes[0]) {
+   case JSR_ABS:
+      return (T_CALL);
+   case JMP_ABS:
+   case JMP_IND:
+   case RTS_INH:
+   case RTI_INH:
+   case BRK_INH:
+      return (T_END);
+   }
+
+   return (T_NEXT);
+}
+
+
+/* timing --- print cycle counts for each routine and straight-line block */
+
+void timing (as)
+struct Asm *as;
+{
+   struct Tim *tp;
+   address dest;
+   long best, worst;
+   long sumbest, sumworst;
+   long n, first, last;
+   int kind;
+
+   if (as->Ntims == 0)
+      return;
+
+   /* Each run of instructions that can follow straight on ends at an RTS,
+    * RTI, JMP or BRK, or just before data, ORG or RMB */
+   for (n = as->Ntims - 1, last = n; n >= 0; n--) {
+      tp = &as->Tim[n];
+      kind = tim_cycles (as, n, &best, &worst, &dest);
+
+      if (n == as->Ntims - 1 || kind == T_END || kind == ERR || as->Tim[n + 1].Brk ||
+          as->Tim[n + 1].Addr != tp->Addr + ADDR(tp->Nbytes))
+         last = n;
+
+      tp->Last = last;
+   }
+
+   as->Byaddr = malloc (as->Ntims * sizeof (struct Tim *));
+   if (as->Byaddr == NULL) {
+      fputs ("Timing: out of memory\n", stderr);
+      exit (1);
+   }
+
+   for (n = 0; n < as->Ntims; n++)
+      as->Byaddr[n] = &as->Tim[n];
+
+   qsort (as->Byaddr, as->Ntims, sizeof (struct Tim *), by_addr);
+
+   for (n = 0; n < as->Ntims; n++)
+      time_run (as, n, 0);
+
+   fprintf (as->Listing, "\nTiming\n\n");
+   fprintf (as->Listing, "Routine         From  To      Best  Worst\n");
+
+   for (n = 0; n < as->Ntims; n++) {
+      tp = &as->Tim[n];
+      if (tp->Label != NULL)
+         fprintf (as->Listing, "%-15.*s %04lX  %04lX %6ld %6ld%s\n",
+                  tp->Lablen, tp->Label, tp->Addr, as->Tim[tp->Last].Addr,
+                  tp->Best, tp->Worst, tp->Open ? "+" : "");
+   }
+
+   /* Straight-line blocks end at any branch, jump or return, and before a label */
+   fprintf (as->Listing, "\nBlock           From  To      Best  Worst\n");
+
+   sumbest = sumworst = 0L;
+
+   for (n = 0, first = 0; n < as->Ntims; n++) {
+      tp = &as->Tim[n];
+      kind = tim_cycles (as, n, &best, &worst, &dest);
+      sumbest += best;
+      sumworst += worst;
+
+      if (n == tp->Last || kind == T_BRANCH || as->Tim[n + 1].Label != NULL) {
+         fprintf (as->Listing, "%-15.*s %04lX  %04lX %6ld %6ld\n",
+                  as->Tim[first].Label ? as->Tim[first].Lablen : 0,
+                  as->Tim[first].Label ? as->Tim[first].Label : "",
+                  as->Tim[first].Addr, tp->Addr, sumbest, sumworst);
+         sumbest = sumworst = 0L;
+         first = n + 1;
+      }
+   }
+
+   fprintf (as->Listing, "\n+ means a loop, or a call that can't be timed, isn't counted\n");
+
+   free (as->Byaddr);
+   as->Byaddr = NULL;
+}
+
+
+/* tim_cycles --- cycles for an instruction in the timing summary */
+
+int tim_cycles (as, n, bestp, worstp, destp)
+struct Asm *as;
+const long n;
+long *bestp, *worstp;
+address *destp;
+{
+   const struct Tim *tp = &as->Tim[n];
+   int bytes[MAXINSN];
+   int i;
+
+   *bestp = *worstp = 0L;
+   *destp = ERR;
+
+   if (tp->Mn == DELAY) {     /* Takes exactly as long as it was asked to */
+      *bestp = *worstp = tp->Cycles;
+      return (T_NEXT);
+   }
+
+   for (i = 0; i < FIELD(tp->Nbytes, MAXINSN); i++)
+      bytes[i] = tp->Code[i];
+
+   return (cycles_for (tp->Mn, bytes, tp->Nbytes, tp->Addr, bestp, worstp, destp));
+}
+
+
+/* time_run --- work out the cycles to the end of the run that holds instruction n,
+ * from the last instruction backwards, timing any subroutines first */
+
+void time_run (as, n, depth)
+struct Asm *as;
+const long n;
+const int depth;
+{
+   struct Tim *tp, *np;
+   address dest;
+   long best, worst;
+   long nbest, nworst, tbest, tworst;
+   long last, i, j;
+   int nopen, topen;
+   int kind;
+
+   last = as->Tim[n].Last;
+   if (as->Tim[last].Done != NO)
+      return;
+
+   as->Tim[last].Done = BUSY;
+
+   for (i = last; i >= 0 && as->Tim[i].Last == last; i--) {
+      tp = &as->Tim[i];
+      np = (i < last) ? &as->Tim[i + 1] : NULL;
+      kind = tim_cycles (as, i, &best, &worst, &dest);
+
+      tp->Best = best;
+      tp->Worst = worst;
+      tp->Open = NO;
+
+      if (kind == T_CALL) {
+         j = find_tim (as, dest);
+         if (j != ERR && depth < MAXNEST)
+            time_run (as, j, depth + 1);
+
+         if (j != ERR && as->Tim[as->Tim[j].Last].Done == YES) {
+            tp->Best += as->Tim[j].Best;
+            tp->Worst += as->Tim[j].Worst;
+            tp->Open = as->Tim[j].Open;
+         }
+         else
+            tp->Open = YES;      /* Outside the program, or recursive */
+      }
+
+      if (kind == T_BRANCH) {      /* Not taken is 'best' cycles, taken is 'worst' */
+         nbest = best + (np ? np->Best : 0L);
+         nworst = best + (np ? np->Worst : 0L);
+         nopen = (np == NULL) || np->Open;
+         j = find_tim (as, dest);
+
+         if (dest <= tp->Addr) {      /* Back round a loop: count it once */
+            tbest = nbest;
+            tworst = nworst;
+            topen = YES;
+         }
+         else if (j != ERR && j > i && j <= last) {
+            tbest = worst + as->Tim[j].Best;
+            tworst = worst + as->Tim[j].Worst;
+            topen = as->Tim[j].Open;
+         }
+         else {                       /* Leaves the routine */
+            tbest = tworst = worst;
+            topen = YES;
+         }
+
+         tp->Best = (nbest < tbest) ? nbest : tbest;
+         tp->Worst = (nworst > tworst) ? nworst : tworst;
+         tp->Open = nopen || topen;
+      }
+      else if (kind != T_END && np != NULL) {
+         tp->Best += np->Best;
+         tp->Worst += np->Worst;
+         tp->Open |= np->Open;
+      }
+      else if (kind != T_END)
+         tp->Open = YES;     /* Runs off the end into data */
+   }
+
+   as->Tim[last].Done = YES;
+}
+
+
+/* find_tim --- find the instruction at an address, or ERR */
+
+long find_tim (as, addr)
+struct Asm *as;
+const address addr;
+{
+   long lo, hi, mid;
+
+   lo = 0;
+   hi = as->Ntims - 1;
+
+   while (lo <= hi) {
+      mid = (lo + hi) / 2;
+      if (as->Byaddr[mid]->Addr < addr)
+         lo = mid + 1;
+      else if (as->Byaddr[mid]->Addr > addr)
+         hi = mid - 1;
+      else
+         return (as->Byaddr[mid] - as->Tim);
+   }
+
+   return (ERR);
+}
+
+
+/* by_addr --- compare two instructions' addresses, for qsort */
+
+int by_addr (a, b)
+const void *a;
+const void *b;
+{
+   const struct Tim *ta = *(struct Tim * const *)a;
+   const struct Tim *tb = *(struct Tim * const *)b;
+
+   if (ta->Addr != tb->Addr)
+      return ((ta->Addr < tb->Addr) ? -1 : 1);
+
+   return ((ta < tb) ? -1 : (ta > tb));    /* Earliest first, if code overlaps */
+}
+
+
+/* check_timed --- complain about code that can take longer than its TIMED budget */
+
+void check_timed (as)
+struct Asm *as;
+{
+   char msg[128];
+   struct Timed *tp;
+   address dest;
+   long best, worst;
+   long total;
+   long n, i;
+
+   for (n = 0; n < as->Ntimed; n++) {
+      tp = &as->Timed[n];
+      as->Nline = tp->Nline;
+      as->Curincl = tp->Incl;
+      as->Curlin = tp->Line;
+
+      if (tp->End == ERR) {
+         nerd (as, "TIMED without ENDTIMED");
+         continue;
+      }
+
+      /* Straight through, each instruction at its slowest */
+      for (i = tp->First, total = 0L; i < tp->End; i++) {
+         tim_cycles (as, i, &best, &worst, &dest);
+         total += worst;
+      }
+
+      if (total > tp->Budget) {
+         snprintf (msg, sizeof (msg), "TIMED code takes up to %ld cycles, over budget by %ld",
+                   total, total - tp->Budget);
+         nerd (as, msg);
+      }
+   }
+
+   as->Intimed = NO;
+}
+
+
+/* delay --- generate the shortest code that takes exactly n cycles: NOPs, a JMP to the
+ * next instruction for an odd cycle, and a count down in one or two registers
+ * if the operand allows any, e.g. 'DELAY 1000,XY'.  Too long for that, it counts
+ * round several loops in turn, saving A and the flags on the stack if it has no register. */
+
+void delay (as, oper)
+struct Asm *as;
+const char oper[];
+{
+   const struct Counter *c, *o, *best1, *best2;
+   address n, top, outer;
+   long k, j, cyc, inner, m, bestk, bestj, bestm;
+   int regs, bytes, bestbytes, pad, bestpad;
+   int chained, saved;
+   int i, r;
+
+   as->Ndly = 0;
+   as->Dlycycles = 0L;
+   i = 0;
+
+   if (evaluate (as, oper, &i, &n) == ERR) {
+      if (as->Forward)
+         for_ref (as, "DELAY");    /* The code can't be sized without it */
+      return;
+   }
+
+   for (regs = 0; oper[i] == ','; ) {
+      for (i++; isalpha (oper[i]); i++) {
+         switch (toupper (oper[i])) {
+         case 'A':
+            regs |= R_A;
+            break;
+         case 'X':
+            regs |= R_X;
+            break;
+         case 'Y':
+            regs |= R_Y;
+            break;
+         default:
+            if (PASS2)
+               nerd (as, "DELAY may only use A, X and Y");
+            return;
+         }
+      }
+   }
+
+   if (!ENDOPER(oper[i])) {
+      if (PASS2)
+         nerd (as, "Bad syntax in DELAY");
+      return;
+   }
+
+   /* Try NOPs alone, then each register counting once round, then two nested */
+   bestbytes = pad_bytes (n);
+   bestm = n;
+   best1 = best2 = NULL;
+   bestk = bestj = 0L;
+   bestpad = 0;
+   chained = saved = NO;
+
+   for (r = 0; r < (sizeof (Counter) / sizeof (Counter[0])); r++) {
+      c = &Counter[r];
+      if (!(regs & c->Reg))
+         continue;
+
+      for (k = 1; k <= c->Maxcount; k++) {
+         cyc = loop_cycles (c, k, 0, as->Addr + ADDR(c->Setbytes));
+         if (cyc > n)
+            break;
+
+         bytes = c->Setbytes + c->Decbytes + 2 + pad_bytes (n - cyc);
+         if (pad_bytes (n - cyc) != ERR && (bestbytes == ERR || bytes < bestbytes)) {
+            bestbytes = bytes;
+            best1 = c;
+            best2 = NULL;
+            bestk = k;
+            bestm = n - cyc;
+         }
+      }
+   }
+
+   for (r = 0; r < (sizeof (Counter) / sizeof (Counter[0])); r++) {
+      o = &Counter[r];      /* Outer loop */
+      if (!(regs & o->Reg))
+         continue;
+
+      for (i = 0; i < (sizeof (Counter) / sizeof (Counter[0])); i++) {
+         c = &Counter[i];   /* Inner loop */
+         if (c == o || !(regs & c->Reg))
+            continue;
+
+         for (k = 1; k <= c->Maxcount; k++) {
+            inner = loop_cycles (c, k, 0, as->Addr + ADDR(o->Setbytes + c->Setbytes)) + o->Deccyc;
+
+            for (j = 1; j <= o->Maxcount; j++) {
+               /* Outer count is like a loop whose count down takes as long as the inner loop */
+               cyc = o->Setcyc + j * inner + (j - 1) * BRANCH_TAKEN(as->Addr + o->Setbytes,
+                        as->Addr + o->Setbytes + c->Setbytes + c->Decbytes + 2 + o->Decbytes + 2) + 2;
+               if (cyc > n)
+                  break;
+
+               m = n - cyc;
+               bytes = o->Setbytes + c->Setbytes + c->Decbytes + o->Decbytes + 4 + pad_bytes (m);
+               if (pad_bytes (m) != ERR && (bestbytes == ERR || bytes < bestbytes)) {
+                  bestbytes = bytes;
+                  best1 = o;
+                  best2 = c;
+                  bestj = j;
+                  bestk = k;
+                  bestm = m;
+               }
+            }
+         }
+      }
+   }
+
+   /* Loops in turn on one register, with NOPs in them to make each go further */
+   for (r = 0; r < (sizeof (Counter) / sizeof (Counter[0])); r++) {
+      c = &Counter[r];
+      if (!(regs & c->Reg))
+         continue;
+
+      for (pad = 0; pad < MAXBYTES / 2; pad++) {
+         bytes = dly_chain (as, c, pad, n, as->Addr, NO);
+         if (bytes != ERR && (bestbytes == ERR || bytes < bestbytes)) {
+            bestbytes = bytes;
+            best1 = c;
+            best2 = NULL;
+            bestpad = pad;
+            chained = YES;
+         }
+      }
+   }
+
+   /* No register to spare: borrow A, with PHP and PHA before and PLA and PLP after */
+   if (regs == 0 && (bestbytes == ERR || bestbytes > MAXBYTES) && n > 3 + 3 + 4 + 4) {
+      for (c = Counter; c->Reg != R_A; c++)
+         ;
+
+      for (pad = 0; pad < MAXBYTES / 2; pad++) {
+         bytes = dly_chain (as, c, pad, n - (3 + 3 + 4 + 4), as->Addr + ADDR(2), NO);
+         if (bytes != ERR && (bestbytes == ERR || bytes + 4 < bestbytes)) {
+            bestbytes = bytes + 4;
+            best1 = c;
+            bestpad = pad;
+            chained = saved = YES;
+         }
+      }
+   }
+
+   if (bestbytes == ERR || bestbytes > MAXBYTES) {
+      if (PASS2)
+         nerd (as, (n < 0) ? "Negative DELAY" : (n == 1) ? "Can't DELAY for one cycle" : "DELAY too long");
+      return;
+   }
+
+   if (saved) {
+      dly_ins (as, "PHP", 3, 1, 0x08, 0, 0);
+      dly_ins (as, "PHA", 3, 1, 0x48, 0, 0);
+      dly_chain (as, best1, bestpad, n - (3 + 3 + 4 + 4), as->Addr + ADDR(as->Nbytes), YES);
+      dly_ins (as, "PLA", 4, 1, 0x68, 0, 0);
+      dly_ins (as, "PLP", 4, 1, 0x28, 0, 0);
+      bestm = 0L;
+   }
+   else if (chained) {
+      dly_chain (as, best1, bestpad, n, as->Addr, YES);
+      bestm = 0L;
+   }
+   else if (best2 != NULL) {    /* Nested loops */
+      dly_load (as, best1, bestj);
+      outer = as->Addr + ADDR(as->Nbytes);
+      dly_load (as, best2, bestk);
+      top = as->Addr + ADDR(as->Nbytes);
+      dly_loop (as, best2, top);
+      dly_loop (as, best1, outer);
+   }
+   else if (best1 != NULL) {
+      dly_load (as, best1, bestk);
+      top = as->Addr + ADDR(as->Nbytes);
+      dly_loop (as, best1, top);
+   }
+
+   dly_pad (as, bestm);
+
+   as->Dlycycles = n;
+}
+
+
+/* dly_chain --- bytes of code for n cycles, starting at 'at', from loops in turn on
+ * one register with 'pad' NOPs in each, then NOPs; generate it too, if 'gen' */
+
+int dly_chain (as, c, pad, n, at, gen)
+struct Asm *as;
+const struct Counter *c;
+const int pad;
+long n;
+address at;
+const int gen;
+{
+   const int loopbytes = c->Setbytes + pad + c->Decbytes + 2;
+   const long least = c->Setcyc + c->Deccyc + 2 * pad + 2;    /* Once round */
+   long k, cyc, full;
+   int bytes;
+
+   if (pad + c->Decbytes + 2 > 128)     /* Too far to branch back */
+      return (ERR);
+
+   for (bytes = 0; bytes <= MAXBYTES; bytes += loopbytes) {
+      full = loop_cycles (c, c->Maxcount, pad, at + ADDR(c->Setbytes));
+      if (n < full + least + 2)     /* Leave enough for the last loop */
+         break;
+
+      if (gen)
+         dly_count (as, c, c->Maxcount, pad);
+
+      n -= full;
+      at += ADDR(loopbytes);
+   }
+
+   for (k = c->Maxcount; k > 0; k--) {      /* Last loop: the rest, less what NOPs can make up */
+      cyc = loop_cycles (c, k, pad, at + ADDR(c->Setbytes));
+      if (cyc <= n && n - cyc != 1)
+         break;
+   }
+
+   if (k > 0) {
+      if (gen)
+         dly_count (as, c, k, pad);
+
+      n -= cyc;
+      bytes += loopbytes;
+   }
+
+   if (pad_bytes (n) == ERR || bytes + pad_bytes (n) > MAXBYTES)
+      return (ERR);
+
+   if (gen)
+      dly_pad (as, n);
+
+   return (bytes + pad_bytes (n));
+}
+
+
+/* dly_count --- a loop that counts down from k, with 'pad' NOPs in it */
+
+void dly_count (as, c, k, pad)
+struct Asm *as;
+const struct Counter *c;
+const long k;
+const int pad;
+{
+   address top;
+   int i;
+
+   dly_load (as, c, k);
+   top = as->Addr + ADDR(as->Nbytes);
+
+   for (i = 0; i < pad; i++)
+      dly_ins (as, "NOP", 2, 1, 0xea, 0, 0);
+
+   dly_loop (as, c, top);
+}
+
+
+/* dly_pad --- NOPs to take m cycles, with a JMP to the next instruction if m is odd */
+
+void dly_pad (as, m)
+struct Asm *as;
+long m;
+{
+   for ( ; m > 0; m -= 2) {
+      if (m & 1) {     /* Odd: three cycles from a JMP to the next instruction */
+         const address next = as->Addr + ADDR(as->Nbytes + 3);
+
+         dly_ins (as, "JMP", 3, 3, JMP_ABS, NUM(next & 0xff), HIGH(next));
+         m--;
+      }
+      else
+         dly_ins (as, "NOP", 2, 1, 0xea, 0, 0);
+   }
+}
+
+
+/* pad_bytes --- bytes of NOPs, with a JMP if need be, to take m cycles, or ERR */
+
+int pad_bytes (m)
+const long m;
+{
+   if (m < 0 || m == 1)
+      return (ERR);
+
+   if (m & 1)
+      return (3 + (m - 3) / 2);    /* JMP, then NOPs */
+
+   return (m / 2);
+}
+
+
+/* loop_cycles --- cycles to count down from k, with 'pad' NOPs in the loop starting at 'at' */
+
+long loop_cycles (c, k, pad, at)
+const struct Counter *c;
+const long k;
+const int pad;
+const address at;
+{
+   const address next = at + ADDR(pad + c->Decbytes + 2);
+
+   return (c->Setcyc + k * (c->Deccyc + 2 * pad) + (k - 1) * BRANCH_TAKEN(next, at) + 2);
+}
+
+
+/* dly_load --- load the count for a delay loop; 256 is zero */
+
+void dly_load (as, c, k)
+struct Asm *as;
+const struct Counter *c;
+const long k;
+{
+   switch (c->Reg) {
+   case R_X:
+      dly_ins (as, "LDX", 2, 2, 0xa2, NUM(k & 0xff), 0);
+      break;
+   case R_Y:
+      dly_ins (as, "LDY", 2, 2, 0xa0, NUM(k & 0xff), 0);
+      break;
+   case R_A:
+      dly_ins (as, "LDA", 2, 2, 0xa9, NUM(k & 0xff), 0);
+      dly_ins (as, "SEC", 2, 1, 0x38, 0, 0);    /* Carry stays set as it counts down */
+      break;
+   }
+}
+
+
+/* dly_loop --- count down, and go back to 'top' until the count is zero */
+
+void dly_loop (as, c, top)
+struct Asm *as;
+const struct Counter *c;
+const address top;
+{
+   switch (c->Reg) {
+   case R_X:
+      dly_ins (as, "DEX", 2, 1, 0xca, 0, 0);
+      break;
+   case R_Y:
+      dly_ins (as, "DEY", 2, 1, 0x88, 0, 0);
+      break;
+   case R_A:
+      dly_ins (as, "SBC", 2, 2, 0xe9, 1, 0);
+      break;
+   }
+
+   dly_ins (as, "BNE", 2, 2, 0xd0, NUM((top - (as->Addr + ADDR(as->Nbytes + 2))) & 0xff), 0);
+   branch_cycles (as->Dly[as->Ndly - 1].Cycles, as->Addr + ADDR(as->Nbytes), top);
+}
+
+
+/* dly_ins --- add an instruction to the code generated by DELAY */
+
+void dly_ins (as, mnem, cyc, nbytes, b1, b2, b3)
+struct Asm *as;
+const char *mnem;
+const int cyc;
+const int nbytes;
+const int b1, b2, b3;
+{
+   struct Dly *d;
+
+   if (as->Nbytes + nbytes > MAXBYTES || as->Ndly >= MAXBYTES)
+      return;
+
+   d = &as->Dly[as->Ndly++];
+   d->Addr = as->Addr + ADDR(as->Nbytes);
+   d->Mnem = mnem;
+   d->Byte = as->Nbytes;
+   d->Nbytes = nbytes;
+   d->Oper[0] = EOS;
+   snprintf (d->Cycles, MAXCYCSTR, " %1d ", cyc);
+
+   as->Byte[as->Nbytes++] = b1;
+   if (nbytes > 1)
+      as->Byte[as->Nbytes++] = b2;
+   if (nbytes > 2)
+      as->Byte[as->Nbytes++] = b3;
+
+   if (nbytes == 3)
+      snprintf (d->Oper, sizeof (d->Oper), "$%02X%02X", b3, b2);
+   else if (b1 == 0xd0)
+      snprintf (d->Oper, sizeof (d->Oper), "$%04lX", (d->Addr + ADDR(2) + (address)(signed char)b2) & 0xffff);
+   else if (nbytes == 2)
+      snprintf (d->Oper, sizeof (d->Oper), "#$%02X", b2);
+}
+
+
+/* branch_cycles --- cycles for the listing of a branch from 'next', the address after it,
+ * to 'dest': two not taken, and one more taken, or two across a page */
+
+void branch_cycles (cycles, next, dest)
+char cycles[];
+const address next;
+const address dest;
+{
+   snprintf (cycles, MAXCYCSTR, "2/%d", BRANCH_TAKEN(next, dest));
+}
+
+
+/* list_delay --- list the code generated by DELAY, one instruction to a line */
+
+void list_delay (as)
+struct Asm *as;
+{
+   const struct Dly *d;
+   int i, n;
+
+   for (n = 0; n < as->Ndly; n++) {
+      d = &as->Dly[n];
+      fprintf (as->Listing, "      %04lX ", d->Addr);
+
+      for (i = 0; i < 5; i++) {
+         if (i < d->Nbytes)
+            fprintf (as->Listing, "%02X ", as->Byte[d->Byte + i]);
+         else
+            fprintf (as->Listing, "   ");
+      }
+
+      fprintf (as->Listing, "%-3.3s                 %-4s%s\n", d->Cycles, d->Mnem, d->Oper);
+   }
+
+   fprintf (as->Listing, "%26s%ld cycles\n", "", as->Dlycycles);
+}
+
+
+/* look_up --- look up a mnemonic in the list of opcodes */
+
+int look_up (mnem, len)
+const char mnem[];
+const int len;
+{
+   unsigned int key;
+   int slot;
+
+   if (len != 3) {
+      for (slot = 0; slot < (sizeof (Longdir) / sizeof (Longdir[0])); slot++)
+         if (len == Longdir[slot].len && strncasecmp (mnem, Longdir[slot].dir, len) == 0)
+            return (Longdir[slot].token);
+
+      return (ERR);
+   }
+
+   if (!(len == 3 && isalpha (mnem[0]) && isalpha (mnem[1]) && isalpha (mnem[2])))
+      return (ERR);     /* All mnemonics and directives are three letters */
+
+   key = MNEMKEY(mnem);
+   slot = MNEMSLOT(key);
+
+   if (Mnemkey[slot] != key)
+      return (ERR);
+
+   return (Mnemtok[slot]);
+}
+
+
+/* init_look_up --- fill in the perfect hash table of mnemonics and directives */
+
+void init_look_up ()
+{
+   int i, slot;
+
+   for (i = 0; i < MNEMSLOTS; i++) {
+      Mnemkey[i] = 0;      /* No valid mnemonic has a key of zero */
+      Mnemtok[i] = ERR;
+   }
+
+   for (i = 0; i < Nopcodes; i++) {
+      slot = MNEMSLOT(MNEMKEY(Opcodes[i].mnem));
+      if (Mnemkey[slot] != 0) {
+         fprintf (stderr, "%s: internal error: mnemonic hash collision\n", Opcodes[i].mnem);
+         exit (1);
+      }
+
+      Mnemkey[slot] = MNEMKEY(Opcodes[i].mnem);
+      Mnemtok[slot] = i;
+   }
+
+   for (i = 0; i < (sizeof (Dirtab) / sizeof (Dirtab[0])); i++) {
+      slot = MNEMSLOT(MNEMKEY(Dirtab[i].dir));
+      if (Mnemkey[slot] != 0) {
+         fprintf (stderr, "%s: internal error: directive hash collision\n", Dirtab[i].dir);
+         exit (1);
+      }
+
+      Mnemkey[slot] = MNEMKEY(Dirtab[i].dir);
+      Mnemtok[slot] = Dirtab[i].token;
+   }
+}
+
+
+/* opcode_for --- find the opcode for a given mnemonic */
+
+int opcode_for (as, mn, modep, opp, cycles)
+struct Asm *as;
+const int mn;
+int *modep;
+address *opp;
+char cycles[];
+{
+#ifdef DB
+   fprintf (stderr, "opcode_for: mn = %d (%s), mode = %d\n", mn, Opcodes[mn].mnem, *modep);
+#endif
+
+   unsigned char *h;
+
+   h = NULL;
+   if (as->Relax && PASS1 && as->Forward && !as->Unguessed &&
+       (*modep == ABSOLUTE || *modep == INDEX_X || *modep == INDEX_Y) &&
+       Opcodes[mn].obj[*modep + Z_OFFSET] != ERR) {
+      h = hint (as);      /* Forward reference that might be shrunk */
+
+      if (*opp < 256 && *opp >= 0 && !(*h & H_ABS))
+         *h |= H_ZP;
+      else if (*h & H_ZP) {    /* Grew again: never shrink it after this */
+         *h = (*h & ~H_ZP) | H_ABS;
+         as->Hintchanged = YES;
+      }
+   }
+
+   if ((*modep == ABSOLUTE || *modep == INDEX_X || *modep == INDEX_Y) &&
+         (*opp < 256 && *opp >=0) && !as->Keepabs && (h == NULL || !(*h & H_ABS)))   /* Zero page ? */
+      if (Opcodes[mn].obj[*modep + Z_OFFSET] != ERR)
+         *modep += Z_OFFSET;
+   
+   if (*modep == ABSOLUTE && Opcodes[mn].obj[*modep] == ERR) { 
+      const address a1 = as->Addr + ADDR(2);    /* Calculate relative addressing */
+      const address a2 = *opp;
+      address rel = a2 - a1;
+
+      if (as->Relax && !ONEPASS && Opcodes[mn].obj[RELATIVE] != ERR) {
+         h = hint (as);
+
+         if (PASS1 && !(*h & H_LONG) && !as->Unguessed && (rel > 127 || rel < -128)) {
+            *h |= H_LONG;    /* Out of range: stretch it, for good */
+            as->Hintchanged = YES;
+         }
+
+         if (*h & H_LONG) {
+            as->Longbranch = YES;
+            *modep = RELATIVE;
+            strcpy (cycles, "3/5");    /* Fall through, or branch by way of the JMP */
+
+            return (Opcodes[mn].obj[RELATIVE]);
+         }
+      }
+      
+      if (PASS2 && !as->Forward && (rel > 127 || rel < -128)) {
+         nerd (as, "Branch too far");
+         rel = 0;
+      }
+
+      if (rel < 0)    /* sort out two's complement */
+         rel += 256;
+
+      *modep = RELATIVE;
+      *opp = rel;
+
+      branch_cycles (cycles, a1, a2);
+   }
+   else
+      snprintf (cycles, MAXCYCSTR, " %1d ", Opcodes[mn].cyc[*modep]);
+
+   return (Opcodes[mn].obj[*modep]);
+}
+
+
+/* directive --- handle directives */
+
+void directive (as, dir, oper)
+struct Asm *as;
+const int dir;
+const char oper[];
+{
+   int i, stat;
+   address op;
+
+   as->Nbytes = 0;
+   i = 0;
+   switch (dir) {
+   case ORG:
+      if (eval (as, oper, &op) == ERR)
+         for_ref (as, "ORG");
+      else
+         as->Addr = op;
+
+      if (PASS2) {
+         if (as->Blkptr != 0)     /* Flush out any remaining object code */
+            putblock (as);
+
+         as->Blkaddr = as->Addr;
+      }
+      break;
+   case EQU:
+      if (PASS1) {   /* Ignore EQU second time around */
+         if (eval (as, oper, &op) == ERR)
+            for_ref (as, "EQU");
+         else if (as->Lastsym != ERR)
+            as->Symbol[as->Lastsym].Address = op;
+      }
+      break;
+   case FCB:
+      do {
+         as->Opstart = i;
+         stat = evaluate (as, oper, &i, &op);
+         
+         if (stat == ERR && ONEPASS && as->Forward) {
+            add_fixup (as, FIX_FCB, as->Nbytes, oper, as->Opstart);
+            as->Byte[as->Nbytes++] = 0;     /* Patched later */
+         }
+         else if (stat == ERR) {
+            as->Byte[as->Nbytes++] = ERR;   /* May just be a forward reference in pass 1. Maintain code size */
+            
+            if (PASS2)
+               nerd (as, "Undefined label in FCB directive");
+         }
+         else if (BYTE_RANGE(op)) {
+            as->Byte[as->Nbytes++] = NUM(op & 0xff);
+         }
+         else {
+            nerd (as, "Byte value out of range");
+            as->Byte[as->Nbytes++] = ERR;  /* Maintain code size by generating one dud byte */
+         }
+      } while (oper[i++] == ',' && as->Nbytes < MAXBYTES);
+
+      if (oper[i - 1] == ',')
+         nerd (as, "Too many bytes in one line");
+      
+      break;
+   case FCW:
+      do {
+         as->Opstart = i;
+         stat = evaluate (as, oper, &i, &op);
+         
+         if (stat == ERR && ONEPASS && as->Forward) {
+            add_fixup (as, FIX_FCW, as->Nbytes, oper, as->Opstart);
+            as->Byte[as->Nbytes++] = 0;     /* Patched later */
+            as->Byte[as->Nbytes++] = 0;
+         }
+         else if (stat == ERR) {
+            as->Byte[as->Nbytes++] = ERR;   /* May just be a forward reference in pass 1. Maintain code size */
+            as->Byte[as->Nbytes++] = ERR;
+            
+            if (PASS2)
+               nerd (as, "Undefined label in FCW directive");
+         }
+         else if (op <= ADDR(0xffff)) {
+            as->Byte[as->Nbytes++] = NUM(op & 0xff);
+            as->Byte[as->Nbytes++] = HIGH(op);
+         }
+         else {
+            nerd (as, "Word value out of range");
+            as->Byte[as->Nbytes++] = ERR;  /* Maintain code size by generating two dud bytes */
+            as->Byte[as->Nbytes++] = ERR;
+         }
+      } while (oper[i++] == ',' && as->Nbytes < MAXBYTES);
+
+      if (oper[i - 1] == ',')
+         nerd (as, "Too many bytes in one line");
+      
+      break;
+   case TEX:
+      {
+         const char term = oper[0];   /* Save the quote */
+
+         if (term == EOS || term == NEWLINE) {
+            nerd (as, "Missing string in TEX directive");
+            break;
+         }
+
+         for (i = 1; oper[i] != term && oper[i] != NEWLINE && oper[i] != EOS; i++)
+            ;
+
+         if (oper[i] != term) {
+            nerd (as, "Unterminated string in TEX directive");
+            break;
+         }
+
+         for (i = 1; oper[i] != term; i++) {
+            if (as->Nbytes >= MAXBYTES) {
+               nerd (as, "Too many bytes in TEX directive");
+               break;
+            }
+
+            as->Byte[as->Nbytes++] = oper[i];
+         }
+      }
+      break;
+   case END:
+      /* Do nothing */
+      break;
+   case INCLUDE:
+      /* Done by source_lines, once this line has been listed */
+      break;
+   case TIMED:
+      if (eval (as, oper, &op) == ERR)
+         for_ref (as, "TIMED");
+      else if (as->Intimed)
+         nerd (as, "TIMED inside TIMED");
+      else if (PASS2) {     /* Counted once the code is final */
+         as->Timed = grow (as->Timed, &as->Maxtimed, as->Ntimed, sizeof (struct Timed));
+         as->Timed[as->Ntimed].First = as->Ntims;
+         as->Timed[as->Ntimed].End = ERR;
+         as->Timed[as->Ntimed].Budget = op;
+         as->Timed[as->Ntimed].Nline = as->Nline;
+         as->Timed[as->Ntimed].Incl = as->Curincl;
+         as->Timed[as->Ntimed].Line = as->Curlin;
+         as->Ntimed++;
+         as->Intimed = YES;
+      }
+      break;
+   case DELAY:
+      delay (as, oper);
+      break;
+   case ENDTIMED:
+      if (PASS2) {
+         if (!as->Intimed)
+            nerd (as, "ENDTIMED without TIMED");
+         else
+            as->Timed[as->Ntimed - 1].End = as->Ntims;
+
+         as->Intimed = NO;
+      }
+      break;
+   case RMB:
+      if (eval (as, oper, &op) == ERR)
+         for_ref (as, "RMB");
+      else
+         as->Addr += op;    /* Skip as many bytes as the RMB directive requests */
+      
+      if (PASS2) {
+         if (as->Blkptr != 0)     /* Flush out any remaining object code */
+            putblock (as);
+
+         as->Blkaddr = as->Addr;
+      }
+      
+      break;
+   }
+}
+
+
+/* eval --- evaluate the string 'str' into an int */
+
+int eval (as, str, nump)
+struct Asm *as;
+const char str[];
+address *nump;
+{
+   int i;
+
+   i = 0;
+   if (evaluate (as, str, &i, nump) == ERR || !ENDOPER(str[i]))
+      return (ERR);
+
+   return (OK);
+}
+
+
+/* evaluate --- evaluate the string 'str' into an integer, updating i */
+
+int evaluate (as, str, ip, nump)
+struct Asm *as;
+const char str[]; /* The string to be evaluated, */
+int *ip;          /* starting at position '*ip', */
+address *nump;    /* putting the resulting address here */
+{
+   struct Xref *x;
+   int stat;
+   int fwd;
+   int errs;
+   int depth;
+   int i;
+   long first;
+   long k;
+
+   fwd = as->Forward;    /* Range-check only this expression */
+   as->Forward = NO;
+
+   for (k = as->Xnext; k < as->Xend; k++)     /* Compiled already? */
+      if (as->Xref[k].Text == str + *ip)
+         break;
+
+   if (k < as->Xend) {     /* Just run it again */
+      x = &as->Xref[k];
+      as->Xnext = k + 1;
+      *ip += x->Len;
+      stat = execute (as, as->Prog + x->Prog, x->Nins, nump);
+   }
+   else {
+      errs = as->Errs;
+      first = as->Nprog;
+      depth = 0;
+      i = *ip;
+
+      compile (as, str, ip, 0, &depth);
+
+      if (depth > XSTACK) {
+         nerd (as, "Expression too complicated");
+         as->Nprog = first;
+         emit (as, X_CONST, ADDR(0), NULL);
+      }
+
+      stat = execute (as, as->Prog + first, NUM(as->Nprog - first), nump);
+
+      if (as->Xkeep && as->Errs == errs) {   /* Keep it, unless there's a syntax error to report again */
+         as->Xref = grow (as->Xref, &as->Maxxrefs, as->Nxrefs, sizeof (struct Xref));
+         x = &as->Xref[as->Nxrefs++];
+         x->Text = str + i;
+         x->Prog = first;
+         x->Nins = NUM(as->Nprog - first);
+         x->Len = *ip - i;
+      }
+      else
+         as->Nprog = first;
+   }
+
+   if ((*nump > 0xffff || *nump < -0x8000) && !as->Forward) {
+      nerd (as, "Address out of range");
+      as->Forward |= fwd;
+      return (ERR);
+   }
+
+   as->Forward |= fwd;
+
+   return (stat);
+}
+
+
+/* compile --- compile an expression into postfix code, with operators of at least 'prec' */
+
+int compile (as, str, ip, prec, depthp)
+struct Asm *as;
+const char str[];
+int *ip;
+const int prec;
+int *depthp;      /* Stack needed to run the code so far */
+{
+   int i;
+   int len;
+   int n;
+   struct Binop *b;
+
+   if (term (as, str, ip, depthp) == ERR)
+      return (ERR);
+
+   for (;;) {
+      b = NULL;
+
+      if (str[*ip] == EOS || strchr (BINOPS, str[*ip]) == NULL)
+         return (OK);      /* Usual way out: end of operand, or a comma */
+
+      for (i = 0; i < sizeof (Binop) / sizeof (Binop[0]); i++) {
+         len = (Binop[i].Sym[1] == EOS) ? 1 : 2;
+         if (str[*ip] == Binop[i].Sym[0] && (len == 1 || str[*ip + 1] == Binop[i].Sym[1])) {
+            b = &Binop[i];
+            break;
+         }
+      }
+
+      if (b == NULL || b->Prec < prec)
+         return (OK);
+
+      *ip += len;
+
+      if (compile (as, str, ip, b->Prec + 1, depthp) == ERR)    /* Left-associative */
+         return (ERR);
+
+      n = as->Nprog;
+
+      /* Both operands constant? Then so is the result, unless it's a division by zero */
+      if (as->Prog[n - 1].Op == X_CONST && as->Prog[n - 2].Op == X_CONST &&
+          !((b->Op == X_DIV || b->Op == X_MOD) && as->Prog[n - 1].Val == 0)) {
+         emit (as, b->Op, ADDR(0), NULL);
+         execute (as, as->Prog + n - 2, 3, &as->Prog[n - 2].Val);
+         as->Nprog = n - 1;
+      }
+      else
+         emit (as, b->Op, ADDR(0), NULL);
+
+      (*depthp)--;
+   }
+}
+
+
+/* term --- compile one term of an expression, with its unary operators */
+
+int term (as, str, ip, depthp)
+struct Asm *as;
+const char str[];
+int *ip;
+int *depthp;
+{
+   int op;
+   int j;
+   int start;
+   char label[MAXLABEL];
+   address val;
+
+   switch (str[*ip]) {
+   case SUBTRACT:
+      op = X_NEG;
+      break;
+   case COMPLEMENT:
+      op = X_NOT;
+      break;
+   case HIBYTE:
+      op = X_HI;
+      break;
+   case LOBYTE:
+      op = X_LO;
+      break;
+   case ADD:
+      op = ERR;
+      break;
+   default:
+      op = OK;
+      break;
+   }
+
+   if (op != OK) {      /* Unary operator */
+      (*ip)++;
+
+      if (++(*depthp) > XSTACK || term (as, str, ip, depthp) == ERR)
+         return (ERR);
+
+      (*depthp)--;      /* Only counted to limit the recursion */
+
+      if (op != ERR) {
+         emit (as, op, ADDR(0), NULL);
+
+         if (as->Prog[as->Nprog - 2].Op == X_CONST) {
+            execute (as, as->Prog + as->Nprog - 2, 2, &as->Prog[as->Nprog - 2].Val);
+            as->Nprog--;
+         }
+      }
+
+      return (OK);
+   }
+
+   if (++(*depthp) > XSTACK)     /* Too deep to run, or even to compile */
+      return (ERR);
+
+   if (str[*ip] == GROUP) {
+      (*ip)++;
+
+      if (compile (as, str, ip, 0, depthp) == ERR)
+         return (ERR);
+
+      (*depthp)--;      /* The value replaces the group */
+
+      if (str[*ip] == GROUP_END)
+         (*ip)++;
+      else
+         nerd (as, "Missing ')' in expression");
+
+      return (OK);
+   }
+
+   if (isalpha (str[*ip]) || (str[*ip] == '_')) {
+      start = *ip;
+
+      for (j = 0; isalpha (str[*ip]) || isdigit (str[*ip]) || str[*ip] == '_'; (*ip)++)
+         if (j < (MAXLABEL - 1))
+            label[j++] = str[*ip];
+
+      label[j] = EOS;
+      val = hash_symbol (label);
+
+      if ((j = find_symbol (as, label, NUM(val))) != ERR)
+         emit (as, X_SYM, ADDR(j), NULL);      /* Defined already */
+      else     /* Look for it again each time the code is run */
+         emit (as, X_NAME, val, str + start);
+
+      return (OK);
+   }
+
+   if (str[*ip] == PC) {
+      (*ip)++;
+      emit (as, X_PC, ADDR(0), NULL);
+      return (OK);
+   }
+
+   if (isdigit (str[*ip]))
+      val = gctol (str, ip, 10);  /* Base 10 conversion */
+   else {
+      switch (str[*ip]) {
+      case HEX:         /* Base 16 conversion */
+         (*ip)++;
+         val = gctol (str, ip, 16);
+         break;
+      case BINARY:      /* Base 2 conversion */
+         (*ip)++;
+         val = gctol (str, ip, 2);
+         break;
+      case ASCII:       /* ASCII code constant */
+         (*ip)++;
+         if (str[*ip] == '^') {   /* Check for control chars ("^C) */
+            (*ip)++;
+            if (str[*ip] == EOS || str[*ip] == NEWLINE || str[*ip] == ASCII)
+               val = ADDR('^');                    /* Caret (^) */
+            else {
+               val = ADDR(str[*ip] & 0x1f);       /* Control char */
+               (*ip)++;
+            }
+         }
+         else {
+            val = ADDR(str[*ip]);
+            if (str[*ip] != NEWLINE)   /* Don't run off the end of the line */
+               (*ip)++;
+         }
+         if (str[*ip] == ASCII)   /* skip the closing quote */
+            (*ip)++;
+         break;
+      case OCTAL:       /* Base 8 conversion */
+         (*ip)++;   
+         val = gctol (str, ip, 8);
+         break;
+      default:
+         nerd (as, "Syntax error in expression");
+         val = ADDR(0);
+         break;
+      }
+   }
+
+   emit (as, X_CONST, val, NULL);
+
+   return (OK);
+}
+
+
+/* emit --- add an instruction to the compiled code */
+
+void emit (as, op, val, name)
+struct Asm *as;
+const int op;
+const address val;
+const char *name;
+{
+   as->Prog = grow (as->Prog, &as->Maxprog, as->Nprog, sizeof (struct Ins));
+   as->Prog[as->Nprog].Op = op;
+   as->Prog[as->Nprog].Val = val;
+   as->Prog[as->Nprog].Name = name;
+   as->Nprog++;
+}
+
+
+/* execute --- run the postfix code for an expression */
+
+int execute (as, ins, n, nump)
+struct Asm *as;
+struct Ins *ins;
+const int n;
+address *nump;
+{
+   address stack[XSTACK];
+   address a, b;
+   char label[MAXLABEL];
+   int sp;
+   int stat;
+   int i, j;
+
+   sp = 0;
+   stat = OK;
+
+   for (i = 0; i < n; i++, ins++) {
+      switch (ins->Op) {
+      case X_CONST:
+         stack[sp++] = ins->Val;
+         continue;
+      case X_SYM:
+         as->Symbol[ins->Val].References++;
+         stack[sp++] = as->Symbol[ins->Val].Address;
+         continue;
+      case X_NAME:
+         for (j = 0; isalnum (ins->Name[j]) || ins->Name[j] == '_'; j++)
+            if (j < (MAXLABEL - 1))
+               label[j] = ins->Name[j];
+
+         label[j < (MAXLABEL - 1) ? j : (MAXLABEL - 1)] = EOS;
+
+         if ((j = find_symbol (as, label, NUM(ins->Val))) == ERR) {
+            as->Forward = YES;
+            stat = ERR;
+
+            if (PASS1 && (j = find_guess (as, label, NUM(ins->Val))) != ERR)
+               stack[sp++] = as->Guess[j].Address;    /* Where it was last time */
+            else {
+               as->Unguessed = YES;
+               stack[sp++] = FORWARD;   /* Value is $FFFF if not found */
+            }
+         }
+         else {
+            ins->Op = X_SYM;     /* Defined now, so no need to look for it again */
+            ins->Val = j;
+            as->Symbol[j].References++;
+            stack[sp++] = as->Symbol[j].Address;
+         }
+         continue;
+      case X_PC:
+         stack[sp++] = as->Addr;
+         continue;
+      }
+
+      if (IS_UNARY(ins->Op)) {
+         a = stack[sp - 1];
+
+         switch (ins->Op) {
+         case X_NEG:
+            a = -a;
+            break;
+         case X_NOT:
+            a = ~a & 0xffff;
+            break;
+         case X_HI:
+            a /= 256;
+            break;
+         case X_LO:
+            a &= 0xff;
+            break;
+         }
+
+         stack[sp - 1] = a;
+         continue;
+      }
+
+      b = stack[--sp];
+      a = stack[sp - 1];
+
+      switch (ins->Op) {
+      case X_MUL:
+         a *= b;
+         break;
+      case X_DIV:
+      case X_MOD:
+         if (b == 0) {
+            nerd (as, "Division by zero");
+            a = 0;
+         }
+         else if (ins->Op == X_DIV)
+            a /= b;
+         else
+            a %= b;
+         break;
+      case X_ADD:
+         a += b;
+         break;
+      case X_SUB:
+         a -= b;
+         break;
+      case X_SHL:
+         a = (b < 0 || b > 31) ? 0 : a << b;
+         break;
+      case X_SHR:
+         a = (b < 0 || b > 31) ? 0 : a >> b;
+         break;
+      case X_LT:
+         a = (a < b);
+         break;
+      case X_LE:
+         a = (a <= b);
+         break;
+      case X_GT:
+         a = (a > b);
+         break;
+      case X_GE:
+         a = (a >= b);
+         break;
+      case X_EQ:
+         a = (a == b);
+         break;
+      case X_NE:
+         a = (a != b);
+         break;
+      case X_AND:
+         a &= b;
+         break;
+      case X_XOR:
+         a ^= b;
+         break;
+      case X_OR:
+         a |= b;
+         break;
+      }
+
+      stack[sp - 1] = a;
+   }
+
+   *nump = stack[0];
+
+   return (stat);
+}
+
+
+/* sym --- locate a symbol's address if possible */
+
+int sym (as, str, ip, nump)
+struct Asm *as;
+const char str [];
+int *ip;
+address *nump;
+{
+   int j;
+   char label[MAXLABEL];
+
+   for (j = 0; isalpha(str[*ip]) || isdigit(str[*ip])
+               || str[*ip] == '_'; (*ip)++)
+      if (j < (MAXLABEL - 1))
+         label[j++] = str[*ip];
+
+   label[j] = EOS;
+   *nump = FORWARD;    /* set value to $FFFF if not found */
+
+   j = find_symbol (as, label, hash_symbol (label));
+   
+   if (j == ERR) {
+      as->Forward = YES;
+      return (ERR);  /* return ERR if label not found */
+   }
+
+   *nump = as->Symbol[j].Address;
+
+#ifdef DB
+   fprintf (stderr, "sym: label = '%s', value = %lx\n", label, *nump);
+#endif
+
+   as->Symbol[j].References++;
+            
+   return (OK);
+}
+
+
+/* nerd --- error message printer */
+
+void nerd (as, str)
+struct Asm *as;
+const char str[];
+{
+   char msg[128 + MAXNEST * 64];
+
+   snprintf (msg, sizeof (msg), "%s at line %d", str, as->Nline);
+   where (as, msg, sizeof (msg));
+   as->Nerds++;
+
+   if (repeated (as, msg))
+      return;
+
+   diag (as, NO, msg, as->Curlin);
+
+   as->Errs++;        
+}
+
+
+/* for_ref --- forward reference error */
+
+void for_ref (as, str)
+struct Asm *as;
+const char str[];
+{
+   char msg[128 + MAXNEST * 64];
+
+   snprintf (msg, sizeof (msg), "%s: can't forward reference, line %d", str, as->Nline);
+   where (as, msg, sizeof (msg));
+   as->Nerds++;
+
+   if (repeated (as, msg))
+      return;
+
+   diag (as, NO, msg, NULL);
+
+   as->Errs++;
+}
+
+
+/* repeated --- see if pass 1 said the same about this line already */
+
+int repeated (as, msg)
+struct Asm *as;
+const char msg[];
+{
+   long i;
+
+   for (i = as->Echo; i < as->Echoend; i++) {
+      if (strcmp (as->Diag[i].Msg, msg) == 0) {
+         as->Echo = i + 1;
+         return (YES);
+      }
+   }
+
+   return (NO);
+}
+
+
+/* where --- add the chain of INCLUDE files to a message about the current line */
+
+void where (as, buf, size)
+struct Asm *as;
+char *buf;
+const int size;
+{
+   int i;
+   int len;
+   const char *name;
+
+   len = strlen (buf);
+
+   for (i = as->Curincl; i > 0 && len < size; i = as->Incl[i].Parent) {
+      len += snprintf (buf + len, size - len, " of %s", as->Src[as->Incl[i].Src].Name);
+
+      if (len < size)
+         len += snprintf (buf + len, size - len, ", included from line %d", as->Incl[i].Nline);
+   }
+
+   name = as->Src[0].Name;
+   if (as->Curincl > 0 && name != NULL && len < size)
+      snprintf (buf + len, size - len, " of %s", name);
+}
+
+
+/* unused --- unused label warning */
+
+void unused (as, str)
+struct Asm *as;
+const char str[];
+{
+   char msg[128];
+
+   snprintf (msg, sizeof (msg), "Warning: %s: unused label", str);
+   diag (as, YES, msg, NULL);
+}
+
+
+/* diag --- keep an error or warning message, and print it if there's an error file */
+
+void diag (as, warning, msg, lin)
+struct Asm *as;
+const int warning;
+const char msg[];
+const char *lin;
+{
+   struct Diag *d;
+   int len;
+
+   as->Diag = grow (as->Diag, &as->Maxdiags, as->Ndiags, sizeof (struct Diag));
+   d = &as->Diag[as->Ndiags++];
+
+   d->Line = as->Nline;
+   d->File = NULL;
+
+   if (as->Nincls > 0 && as->Curincl > 0)
+      d->File = strdup (as->Src[as->Incl[as->Curincl].Src].Name);
+   d->Warning = warning;
+   d->Msg = strdup (msg);
+   d->Text = NULL;
+
+   if (lin != NULL) {
+      len = strcspn (lin, "\n");
+      d->Text = malloc (len + 1);
+      if (d->Text != NULL) {
+         memcpy (d->Text, lin, len);
+         d->Text[len] = EOS;
+      }
+   }
+
+   if (d->Msg == NULL || (lin != NULL && d->Text == NULL)) {
+      fputs ("Messages: out of memory\n", stderr);
+      exit (1);
+   }
+
+   if (as->Errorfd != NULL) {
+      fprintf (as->Errorfd, "%s\n", d->Msg);
+      if (d->Text != NULL)
+         fprintf (as->Errorfd, "%s\n", d->Text);
+   }
+}
+
+
+/* list_it --- do stuff for the listing */
+
+void list_it (as, cycles, lin, t, mn)
+struct Asm *as;
+const char cycles[];
+const char lin[];
+const struct Toks *t;
+const int mn;
+{
+   int i;
+   int w;
+   long j;
+
+   if (t->Mnemlen != 0) {
+      if (mn == EQU) {
+         address eq;
+         
+         i = 0;
+
+         if (sym (as, lin + t->Label, &i, &eq) == ERR)
+            nerd (as, "Internal error in EQU directive");
+            
+         fprintf (as->Listing, "%4d: %04lX ", as->Nline, eq & 0xffff);
+      }
+      else
+         fprintf (as->Listing, "%4d: %04lX ", as->Nline, as->Addr);
+
+      for (i = 0; i < 5; i++) {    /* Why FIVE ?? */
+         if (ONEPASS)
+            for (j = as->Linefix; j < as->Nfixups; j++)
+               if (as->Fixup[j].Index == i)   /* Remember where to patch the listing */
+                  as->Fixup[j].Lstoff = ftell (as->Listing);
+
+         if (i < as->Nbytes && as->Byte[i] != ERR && mn != DELAY)   /* DELAY lists its own */
+            fprintf (as->Listing, "%02X ", as->Byte[i]);
+         else
+            fprintf (as->Listing, "   ");
+      }
+
+      if (ONEPASS)
+         for (j = as->Linefix; j < as->Nfixups; j++)
+            if (as->Fixup[j].Kind == FIX_REL)
+               as->Fixup[j].Cycoff = ftell (as->Listing);
+
+      fprintf (as->Listing, "%-3.3s ", cycles);
+      
+      w = (mn == INCLUDE || mn == TIMED || mn == ENDTIMED || mn == DELAY) ? 8 : 4;     /* Long mnemonic, shorter operand */
+
+      fprintf (as->Listing, "%-16.*s%-*.*s%-*.*s%.*s\n",
+               FIELD(t->Lablen, MAXLABEL - 1), lin + t->Label,
+               w, FIELD(t->Mnemlen, w), lin + t->Mnem,
+               24 - w, FIELD(t->Operlen, 24 - w), lin + t->Oper,
+               t->Commlen, lin + t->Comment);
+
+      if (mn == DELAY)
+         list_delay (as);
+   }
+   else if (t->Lablen != 0) {
+      fprintf (as->Listing, "%4d: %04lX                    %-16.*s                        %.*s\n", as->Nline, as->Addr,
+               FIELD(t->Lablen, MAXLABEL - 1), lin + t->Label, t->Commlen, lin + t->Comment);
+   }
+   else {
+      fprintf (as->Listing, "%4d:                         %.*s\n", as->Nline, t->Commlen, lin + t->Comment);
+   }
+}
+
+
+/* putbyte --- output a byte to the code file */
+
+void putbyte (as, byte)
+struct Asm *as;
+const int byte;
+{
+   as->Block[as->Blkptr++] = byte & 0xff;   /* Dud bytes (ERR) come out as $FF */
+
+   if (as->Blkptr >= as->Reclen)
+      putblock (as);
+}
+
+
+/* putblock --- puts a block of code onto the object file */
+
+void putblock (as)
+struct Asm *as;
+{
+   int i;
+   int blklen;
+
+   blklen = 0;
+
+   if (as->Blkptr != 0 && ONEPASS) {    /* Hold back until forward references are patched */
+      blklen = as->Blkptr;
+      as->Blkptr = 0;
+
+      as->Defblk = grow (as->Defblk, &as->Maxdefblks, as->Ndefblks, sizeof (struct Deferred));
+      as->Defblk[as->Ndefblks].Addr = as->Blkaddr;
+      as->Defblk[as->Ndefblks].Offset = as->Objlen;
+      as->Defblk[as->Ndefblks].Len = blklen;
+      as->Ndefblks++;
+
+      as->Objbuf = grow (as->Objbuf, &as->Maxobj, as->Objlen + blklen, sizeof (unsigned char));
+
+      for (i = 0; i < blklen; i++)
+         as->Objbuf[as->Objlen++] = as->Block[i];
+   }
+   else if (as->Blkptr != 0) {   /* See if there's anything in the block */
+      blklen = as->Blkptr;
+      as->Blkptr = 0;
+
+      for (i = 0; i < blklen; i++)     /* Memory image is always kept */
+         as->Image[(as->Blkaddr + i) & 0xffff] = as->Block[i];
+
+      if (as->Blkaddr < as->Lowaddr)
+         as->Lowaddr = as->Blkaddr;
+
+      if (as->Blkaddr + blklen - 1 > as->Highaddr)
+         as->Highaddr = as->Blkaddr + blklen - 1;
+
+      if (as->Hexfmt != BIN_IMAGE)
+         putrecord (as, DATA_REC, as->Blkaddr, as->Block, blklen);
+      
+      as->Nblocks++;
+   }
+
+   as->Blkaddr += ADDR(blklen);
+}
+
+
+/* puteof --- puts EOF marker onto the object file */
+
+void puteof (as)
+struct Asm *as;
+{
+   if (as->Hexfmt == BIN_IMAGE) {    /* Whole image in one go */
+      if (!as->Trim)
+         fwrite (as->Image, sizeof (unsigned char), IMAGESIZE, as->Object);
+      else if (as->Highaddr >= as->Lowaddr && as->Lowaddr <= 0xffffL) {
+         if (as->Highaddr > 0xffffL)
+            as->Highaddr = 0xffffL;
+
+         fwrite (as->Image + as->Lowaddr, sizeof (unsigned char), as->Highaddr - as->Lowaddr + 1, as->Object);
+      }
+
+      return;
+   }
+
+   if (as->Hexfmt == MOS_HEX)
+      putrecord (as, EOF_REC, ADDR(as->Nblocks), as->Block, 0);   /* MOS counts the records */
+   else
+      putrecord (as, EOF_REC, ADDR(0), as->Block, 0);
+
+   fwrite (as->Hexbuf, sizeof (char), as->Hexlen, as->Object);
+   as->Hexlen = 0;
+}
+
+
+/* putrecord --- encode one record of the object file into Hexbuf */
+
+void putrecord (as, type, addr, data, len)
+struct Asm *as;
+const int type;
+const address addr;
+const int data[];
+const int len;
+{
+   char *p;
+   unsigned int sum;
+   int count;
+   int i;
+
+   if (as->Hexlen + MAXRECTEXT > HEXBUFSIZE) {   /* Make room for the longest record */
+      fwrite (as->Hexbuf, sizeof (char), as->Hexlen, as->Object);
+      as->Hexlen = 0;
+   }
+
+   p = as->Hexbuf + as->Hexlen;
+   count = len;
+
+   switch (as->Hexfmt) {
+   case MOS_HEX:
+      *p++ = ';';
+      break;
+   case SREC_HEX:
+      *p++ = 'S';
+      *p++ = (type == EOF_REC) ? '9' : '1';
+      count = len + 3;     /* Count includes address and checksum */
+      break;
+   case INTEL_HEX:
+      *p++ = ':';
+      break;
+   }
+
+   HEXBYTE(p, count);
+   HEXBYTE(p, (addr >> 8) & 0xff);
+   HEXBYTE(p, addr & 0xff);
+
+   sum = count + ((addr >> 8) & 0xff) + (addr & 0xff);
+
+   if (as->Hexfmt == INTEL_HEX) {
+      HEXBYTE(p, type);
+      sum += type;
+   }
+
+   for (i = 0; i < len; i++) {
+      HEXBYTE(p, data[i]);
+      sum += data[i];
+   }
+
+   switch (as->Hexfmt) {
+   case MOS_HEX:        /* 16-bit sum */
+      HEXBYTE(p, (sum >> 8) & 0xff);
+      HEXBYTE(p, sum & 0xff);
+      break;
+   case SREC_HEX:       /* One's complement of 8-bit sum */
+      HEXBYTE(p, ~sum & 0xff);
+      break;
+   case INTEL_HEX:      /* Two's complement of 8-bit sum */
+      HEXBYTE(p, -sum & 0xff);
+      break;
+   }
+
+   *p++ = NEWLINE;
+   as->Hexlen = p - as->Hexbuf;
+}
+
+
+/* add_fixup --- record a forward reference to be patched at the end */
+
+void add_fixup (as, kind, k, oper, start)
+struct Asm *as;
+const int kind;
+const int k;
+const char oper[];
+const int start;
+{
+   struct Fix *f;
+
+   as->Fixup = grow (as->Fixup, &as->Maxfixups, as->Nfixups, sizeof (struct Fix));
+   f = &as->Fixup[as->Nfixups++];
+
+   f->Kind   = kind;
+   f->Index  = k;
+   f->Offset = as->Objlen + as->Blkptr + k;   /* Where the byte will land in Objbuf */
+   f->Lstoff = -1L;
+   f->Cycoff = -1L;
+   f->Tim    = as->Ntims;     /* Next to be noted by time_line() */
+   f->Addr   = as->Addr;
+   f->Nline  = as->Nline;
+   f->Incl   = as->Curincl;
+   f->Line   = as->Curlin;    /* Source stays mapped until we finish */
+   f->Oper   = oper;
+   f->Start  = start;
+   f->Xref   = as->Linexref;
+   f->Xend   = as->Nxrefs;   /* Including this one, if it compiled */
+   f->Diag   = as->Linediag;
+}
+
+
+/* resolve_fixups --- evaluate forward references and patch the code */
+
+void resolve_fixups (as)
+struct Asm *as;
+{
+   int n, i;
+   int lo, hi;
+   int dud;
+   address op;
+   const address here = as->Addr;
+   const long ndiags = as->Ndiags;
+   long nerds;
+   struct Fix *f;
+   char digits[3];
+   char cycles[MAXCYCSTR];
+
+   fflush (as->Listing);    /* Bring Lstbuf up to date */
+   as->Pass = 2;            /* Undefined labels are now errors */
+   as->Xkeep = NO;
+
+   for (n = 0; n < as->Nfixups; n++) {
+      f = &as->Fixup[n];
+      as->Addr = f->Addr;
+      as->Nline = f->Nline;
+      as->Curincl = f->Incl;
+      as->Curlin = f->Line;
+      as->Xnext = f->Xref;
+      as->Xend = f->Xend;
+      as->Echo = f->Diag;        /* Said already when the line was read */
+      as->Echoend = ndiags;
+
+      i = f->Start;
+      as->Forward = NO;
+      lo = 0xff;
+      hi = 0xff;
+      dud = NO;
+      nerds = as->Nerds;
+
+      if (evaluate (as, f->Oper, &i, &op) == ERR) {
+         if (as->Forward)
+            dud = (f->Kind == FIX_FCB || f->Kind == FIX_FCW);
+
+         if (as->Forward && as->Nerds == nerds) {
+            switch (f->Kind) {
+            case FIX_FCB:
+               nerd (as, "Undefined label in FCB directive");
+               break;
+            case FIX_FCW:
+               nerd (as, "Undefined label in FCW directive");
+               break;
+            default:
+               nerd (as, "Undefined label");
+               break;
+            }
+         }
+      }
+      else {
+         switch (f->Kind) {
+         case FIX_REL:
+            op -= as->Addr + ADDR(2);
+            if (op > 127 || op < -128) {
+               nerd (as, "Branch too far");
+               op = 0;
+            }
+
+            lo = NUM(op & 0xff);
+
+            if (f->Cycoff >= 0L) {
+               branch_cycles (cycles, as->Addr + ADDR(2), op + as->Addr + ADDR(2));
+               memcpy (as->Lstbuf + f->Cycoff, cycles, 3);
+            }
+            break;
+         case FIX_BYTE:
+            if (!BYTE_RANGE(op))
+               nerd (as, "operand too big");
+            else
+               lo = NUM(op & 0xff);
+            break;
+         case FIX_FCB:
+            if (!BYTE_RANGE(op)) {
+               nerd (as, "Byte value out of range");
+               dud = YES;
+            }
+            else
+               lo = NUM(op & 0xff);
+            break;
+         case FIX_WORD:
+         case FIX_FCW:
+            lo = NUM(op & 0xff);
+            hi = HIGH(op);
+            break;
+         }
+      }
+
+      as->Objbuf[f->Offset] = lo;
+
+      if (f->Tim < as->Ntims && as->Tim[f->Tim].Addr == f->Addr && f->Index < FIELD(as->Tim[f->Tim].Nbytes, MAXINSN)) {
+         as->Tim[f->Tim].Code[f->Index] = lo;     /* Keep the timing summary up to date */
+         if (f->Kind == FIX_WORD && f->Index + 1 < FIELD(as->Tim[f->Tim].Nbytes, MAXINSN))
+            as->Tim[f->Tim].Code[f->Index + 1] = hi;
+      }
+
+      if (dud)    /* Dud bytes are left blank in the listing */
+         strcpy (digits, "  ");
+      else
+         snprintf (digits, sizeof (digits), "%02X", lo);
+
+      if (f->Lstoff >= 0L)
+         memcpy (as->Lstbuf + f->Lstoff, digits, 2);
+
+      if (f->Kind == FIX_WORD || f->Kind == FIX_FCW) {
+         as->Objbuf[f->Offset + 1] = hi;
+
+         if (!dud)
+            snprintf (digits, sizeof (digits), "%02X", hi);
+
+         if (f->Lstoff >= 0L && f->Index < 4)
+            memcpy (as->Lstbuf + f->Lstoff + 3, digits, 2);
+      }
+   }
+
+   as->Nfixups = 0;
+   as->Echo = as->Echoend = 0L;
+   as->Addr = here;
+}
+
+
+/* write_deferred --- write out the object code and listing held back in single-pass mode */
+
+void write_deferred (as)
+struct Asm *as;
+{
+   int n, i;
+
+   for (n = 0; n < as->Ndefblks; n++) {
+      for (i = 0; i < as->Defblk[n].Len; i++)
+         as->Block[i] = as->Objbuf[as->Defblk[n].Offset + i];
+
+      as->Blkaddr = as->Defblk[n].Addr;
+      as->Blkptr = as->Defblk[n].Len;
+      putblock (as);
+   }
+
+   as->Ndefblks = 0;
+   as->Objlen = 0L;
+
+   fclose (as->Listing);
+   as->Listing = as->Lstfd;
+   fwrite (as->Lstbuf, 1, as->Lstlen, as->Listing);
+   free (as->Lstbuf);
+}
+
+
+/* grow --- make sure there's room for element 'n' in a dynamic array */
+
+void *grow (p, maxp, n, size)
+void *p;
+long *maxp;
+const long n;
+const size_t size;
+{
+   if (n >= *maxp) {
+      while (n >= *maxp)
+         *maxp = (*maxp == 0L) ? 64L : *maxp * 2L;
+
+      p = realloc (p, *maxp * size);
+      if (p == NULL) {
+         fputs ("Out of memory\n", stderr);
+         exit (1);
+      }
+   }
+
+   return (p);
+}
+
+
+address gctol (str, ip, base)
+const char str[];
+int *ip;
+const int base;
+{
+   const char *p, *newp;
+   address val;
+   
+   p = str + *ip;
+
+   if (isspace (*p))    /* Don't let strtol wander onto the next line */
+      return (ADDR(0));
+   
+   val = strtol (p, (char **)&newp, base);
+   
+   *ip += newp - p;
+   
+   return (val);
+}
@@ -0,0 +1,57 @@
+/* Interface to libas6502, the 6502 assembler as a library           */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems   */
+
+#include <stdio.h>
+
+#define MOS_HEX      1           /* MOS Technology Paper tape format */
+#define SREC_HEX     2           /* Motorola S-Record hex format */
+#define INTEL_HEX    3           /* Intel Hex format */
+#define BIN_IMAGE    4           /* Raw binary memory image */
+
+/* Options for as_option() */
+
+#define OPT_ONEPASS  1           /* Non-zero to assemble in a single pass */
+#define OPT_FORMAT   2           /* Object format, MOS_HEX, etc. */
+#define OPT_TRIM     3           /* Non-zero to trim binary image to the addresses used */
+#define OPT_FILL     4           /* Byte for gaps in the binary image */
+#define OPT_RECLEN   5           /* Bytes per object record, 1 to 255 */
+#define OPT_RELAX    6           /* Shrink forward references to zero-page and stretch long branches */
+#define OPT_TIMING   7           /* Non-zero for a summary of cycle counts after the symbol table */
+
+struct Asm;                      /* Assembler context: no global state */
+
+struct Diag {                    /* Error or warning message */
+   int     Line;                 /* Source line number, or 0 */
+   char    *File;                /* Name of INCLUDE file, or NULL for the main source */
+   int     Warning;              /* Non-zero for warnings, zero for errors */
+   char    *Msg;                 /* The message, as printed */
+   char    *Text;                /* Source line in error, or NULL */
+};
+
+#ifdef __STDC__
+struct Asm *as_new (void);
+void as_free (struct Asm *as);
+int as_option (struct Asm *as, int opt, int val);
+void as_source_name (struct Asm *as, const char *name);
+int as_file (struct Asm *as, FILE *source, FILE *object, FILE *listing, FILE *errors);
+int as_buffer (struct Asm *as, const char *text, long len);
+int as_predefine (struct Asm *as, const char *text, long len);
+const unsigned char *as_image (struct Asm *as, long *lowp, long *highp);
+const char *as_object (struct Asm *as, size_t *lenp);
+const char *as_listing (struct Asm *as, size_t *lenp);
+int as_ndiags (struct Asm *as);
+const struct Diag *as_diag (struct Asm *as, int n);
+#else
+struct Asm *as_new ();
+void as_free ();
+int as_option ();
+void as_source_name ();
+int as_file ();
+int as_buffer ();
+int as_predefine ();
+const unsigned char *as_image ();
+const char *as_object ();
+const char *as_listing ();
+int as_ndiags ();
+const struct Diag *as_diag ();
+#endif   /* __STDC__ */
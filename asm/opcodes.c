@@ -0,0 +1,184 @@
+/* opcodes --- the 6502 instruction set                     1983-06-16 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Modification:
+ * 2026-10-17 agent Split from the assembler, to share with the simulator
+ */
+
+#include "as6502.h"
+#include "opcodes.h"
+
+/* inh, imm, abs, abs,X, abs,Y, zpage, zpage,X, zpage,Y, ind,X, ind,Y, rel, ind */
+
+struct Opcode Opcodes[] = {
+   {"ADC", 1,
+   { ERR, 0x69, 0x6D, 0x7D, 0x79, 0x65, 0x75,  ERR, 0x61, 0x71,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"AND", 1,
+   { ERR, 0x29, 0x2D, 0x3D, 0x39, 0x25, 0x35,  ERR, 0x21, 0x31,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"ASL", 0,
+   {0x0A,  ERR, 0x0E, 0x1E,  ERR, 0x06, 0x16,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"BCC", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x90,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BCS", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xB0,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BEQ", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xF0,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BIT", 0,
+   { ERR,  ERR, 0x2C,  ERR,  ERR, 0x24,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
+   {"BMI", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x30,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BNE", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0xD0,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BPL", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x10,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BRK", 0,
+   {0x00,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   7,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"BVC", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x50,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"BVS", 0,
+   { ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x70,  ERR},
+   {   0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    2,    0}},
+   {"CLC", 0,
+   {0x18,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"CLD", 0,
+   {0xD8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"CLI", 0,
+   {0x58,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"CLV", 0,
+   {0xB8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"CMP", 1,
+   { ERR, 0xC9, 0xCD, 0xDD, 0xD9, 0xC5, 0xD5,  ERR, 0xC1, 0xD1,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"CPX", 0,
+   { ERR, 0xE0, 0xEC,  ERR,  ERR, 0xE4,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    2,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
+   {"CPY", 0,
+   { ERR, 0xC0, 0xCC,  ERR,  ERR, 0xC4,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    2,    4,    0,    0,    3,    0,    0,    0,    0,    0,    0}},
+   {"DEC", 0,
+   { ERR,  ERR, 0xCE, 0xDE,  ERR, 0xC6, 0xD6,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"DEX", 0,
+   {0xCA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"DEY", 0,
+   {0x88,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"EOR", 1,
+   { ERR, 0x49, 0x4D, 0x5D, 0x59, 0x45, 0x55,  ERR, 0x41, 0x51,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"INC", 0,
+   { ERR,  ERR, 0xEE, 0xFE,  ERR, 0xE6, 0xF6,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"INX", 0,
+   {0xE8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"INY", 0,
+   {0xC8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"JMP", 0,
+   { ERR,  ERR, 0x4C,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR, 0x6C},
+   {   0,    0,    3,    0,    0,    0,    0,    0,    0,    0,    0,    5}},
+   {"JSR", 0,
+   { ERR,  ERR, 0x20,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    6,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"LDA", 1,
+   { ERR, 0xA9, 0xAD, 0xBD, 0xB9, 0xA5, 0xB5,  ERR, 0xA1, 0xB1,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"LDX", 1,
+   { ERR, 0xA2, 0xAE,  ERR, 0xBE, 0xA6,  ERR, 0xB6,  ERR,  ERR,  ERR,  ERR},
+   {   0,    2,    4,    0,    4,    3,    0,    4,    0,    0,    0,    0}},
+   {"LDY", 1,
+   { ERR, 0xA0, 0xAC, 0xBC,  ERR, 0xA4, 0xB4,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    2,    4,    4,    0,    3,    4,    0,    0,    0,    0,    0}},
+   {"LSR", 0,
+   {0x4A,  ERR, 0x4E, 0x5E,  ERR, 0x46, 0x56,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"NOP", 0,
+   {0xEA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"ORA", 1,
+   { ERR, 0x09, 0x0D, 0x1D, 0x19, 0x05, 0x15,  ERR, 0x01, 0x11,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"PHA", 0,
+   {0x48,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   3,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"PHP", 0,
+   {0x08,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   3,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"PLA", 0,
+   {0x68,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   4,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"PLP", 0,
+   {0x28,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   4,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"ROL", 0,
+   {0x2A,  ERR, 0x2E, 0x3E,  ERR, 0x26, 0x36,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"ROR", 0,
+   {0x6A,  ERR, 0x6E, 0x7E,  ERR, 0x66, 0x76,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    6,    7,    0,    5,    6,    0,    0,    0,    0,    0}},
+   {"RTI", 0,
+   {0x40,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   6,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"RTS", 0,
+   {0x60,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   6,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"SBC", 1,
+   { ERR, 0xE9, 0xED, 0xFD, 0xF9, 0xE5, 0xF5,  ERR, 0xE1, 0xF1,  ERR,  ERR},
+   {   0,    2,    4,    4,    4,    3,    4,    0,    6,    5,    0,    0}},
+   {"SEC", 0,
+   {0x38,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"SED", 0,
+   {0xF8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"SEI", 0,
+   {0x78,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"STA", 0,
+   { ERR,  ERR, 0x8D, 0x9D, 0x99, 0x85, 0x95,  ERR, 0x81, 0x91,  ERR,  ERR},
+   {   0,    0,    4,    5,    5,    3,    4,    0,    6,    6,    0,    0}},
+   {"STX", 0,
+   { ERR,  ERR, 0x8E,  ERR,  ERR, 0x86,  ERR, 0x96,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    4,    0,    0,    3,    0,    4,    0,    0,    0,    0}},
+   {"STY", 0,
+   { ERR,  ERR, 0x8C,  ERR,  ERR, 0x84, 0x94,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   0,    0,    4,    0,    0,    3,    4,    0,    0,    0,    0,    0}},
+   {"TAX", 0,
+   {0xAA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"TAY", 0,
+   {0xA8,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"TSX", 0,
+   {0xBA,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"TXA", 0,
+   {0x8A,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"TXS", 0,
+   {0x9A,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}},
+   {"TYA", 0,
+   {0x98,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR,  ERR},
+   {   2,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0}}
+};
+
+const int Nopcodes = sizeof (Opcodes) / sizeof (Opcodes[0]);
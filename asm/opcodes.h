@@ -0,0 +1,14 @@
+/* opcodes.h --- the 6502 instruction set, for the assembler and simulator */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Needs as6502.h first, for MAXMODES */
+
+struct Opcode {
+   char mnem[4];                 /* Mnemonic */
+   int flags;                    /* F_PAGE */
+   int obj[MAXMODES];            /* Opcode for each addressing mode, or ERR */
+   int cyc[MAXMODES];            /* Cycles for each addressing mode */
+};
+
+extern struct Opcode Opcodes[];     /* In alphabetical order of mnemonic */
+extern const int Nopcodes;
@@ -250,6 +250,8 @@ NEXTPG          byt     $ff,$fe,$fd,$fc
                 TEX     "Hello, world"
                 .asciiz "Hello, world"    ; Directive too long, will be truncated
                 TEX     "1234567890123456789012345678901234567890123456789012345678901234567890123456789012"
+                TEX                       ; Missing string
+                TEX     "Hello, world      ; Unterminated string
                 BYT     1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,30,30,31,32
                 fcb     256,257,258
                 fcb     $100,$fff,$ffff,$fffff
@@ -267,6 +269,8 @@ NEXTPG          byt     $ff,$fe,$fd,$fc
                 FCW     ,1
                 byt     1,2,
                 byt     1,,3
+                RMB     FORWARD           ; Can't forward reference RMB or ORG,
+                ORG     FORWARD           ; but no more errors after them
                 
 FORWARD         LDA     LASTBYTE
                 LDA     LASTBYTE-1
@@ -275,6 +279,15 @@ FORWARD         LDA     LASTBYTE
                 nop
                 nop
 
+                TIMED   3                 ; Over budget, as LDA abs,X may take 5
+                LDA     ABS,X
+                ENDTIMED
+                TIMED   10
+                TIMED   10                ; Can't nest TIMED
+                ENDTIMED
+                ENDTIMED                  ; No TIMED to end
+                TIMED   5                 ; Never ended
+
 BOGUS_ORG       org     $FFF0             ; Can't label ORGs
 NEARTOP         jmp     .
                 jmp     BOGUS_ORG
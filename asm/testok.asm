@@ -23,6 +23,7 @@ SEVEN           equ     49/7
 EIGHT           equ     10-2
 CHKAND          equ     $4242&$FF
 CHKEOR          equ     $B2B2^$F0F0
+MINUS_ONE       equ     -1                ; Listed as $FFFF
 
 BINARY          equ     %1010101010101010 ; Check number bases
 OCTAL           equ     @377
@@ -320,6 +321,26 @@ FORWARD         LDA     LASTBYTE
                 fcw     $ffff,$ffff
                 fcw     $ffff,$ffff
                 
+; Operator precedence and grouping in expressions
+                org     $2000
+                FCB     2+3*4             ; 14: '*' before '+'
+                FCB     (2+3)*4           ; 20: parentheses group
+                FCB     20-4-3            ; 13: left to right
+                FCB     100/7,100%7       ; 14 and 2
+                FCB     1<<4|1            ; 17: shift before '|'
+                FCB     $F0>>4&3          ; 3: shift before '&'
+                FCB     6^3|8,6&3^1       ; 13 and 3: '&' before '^' before '|'
+                FCB     -1&$FF,~$0F&$FF   ; $FF and $F0: unary before '&'
+                FCB     >$1234+1,<$1234   ; $13 and $34: '<' and '>' bind tightest
+                FCB     3<4,4<3,3<=3,4>=5 ; 1,0,1,0: comparisons
+                FCB     2=2,2==3,2<>2,2!=3 ; 1,0,0,1
+                FCB     1+1=2,2=1+1       ; 1 and 1: arithmetic before comparison
+                FCW     FWD_EXPR*2+1      ; $2469: forward reference
+                LDA     #(FIVE+SIX)*2     ; 22: grouping after '#'
+                LDA     (VEC),Y           ; Still indirect at the start
+                LDA     2*(VEC+2)         ; Zero page: $48
+FWD_EXPR        EQU     $1234
+
 ; Test bug in NMOS 6502
                 org     $07ff
 JMP_VEC         WRD     $AAAA             ; JMP vector crosses page boundary
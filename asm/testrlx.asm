@@ -0,0 +1,37 @@
+; testrlx --- test program for relaxation in the 6502 assembler  2026-10-18
+; Copyright (c) John Honniball. All rights reserved
+
+; This test program has forward references that turn out to be in
+; zero page, and branches that turn out to be out of range.  With -R
+; it should assemble with no errors, the references shrunk to the
+; zero-page forms and the branches stretched round a JMP.  Without -R
+; the far branches are errors.  A TIMED block is exactly in budget.
+; See 'testok.asm' for everything else.
+
+                ORG     $0400
+START           LDA     PTR               ; Shrinks to zero page
+                STA     PTR+1
+                LDX     #0
+LOOP            LDA     TABLE,X
+                BEQ     DONE              ; Out of range: stretched
+                JSR     SUB
+                INX
+                BNE     LOOP
+                JMP     DONE
+                RMB     130               ; Room for more
+DONE            LDA     RESULT
+                BNE     START             ; Out of range backwards: stretched
+                BRK
+
+                TIMED   10                ; Just in budget, at its slowest
+SUB             CMP     #$80
+                BCC     LOW
+                EOR     #$FF
+LOW             STA     RESULT            ; Shrinks to zero page
+                ENDTIMED
+                RTS
+
+TABLE           FCB     1,2,$81,$FF,0
+
+PTR             EQU     $80               ; Zero-page, but defined late
+RESULT          EQU     PTR+2
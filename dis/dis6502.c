@@ -0,0 +1,810 @@
+/* dis6502 --- disassemble 6502 object code into as6502 source   2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Reads the same files as the simulator (MOS Technology, Motorola or
+ * Intel hex, or a binary image) and writes source that as6502 turns
+ * back into exactly the same bytes.  The decode table comes from the
+ * assembler's own Opcodes[].
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "as6502.h"
+#include "opcodes.h"
+#include "sim6502.h"
+
+#define MAXLINE      256
+#define MAXFCB       8           /* Bytes on one FCB line */
+#define MNEMCOL      16          /* Columns, counting from zero */
+#define OPERCOL      24
+#define COMMCOL      40
+#define OUTSIZE      65536       /* Output buffer */
+#define SYMTAB       "Symbol Table"   /* Heading in a listing, before the symbols */
+
+/* What each byte of memory turned out to be */
+#define K_NONE       0           /* Not loaded */
+#define K_INSN       1           /* First byte of an instruction */
+#define K_OPER       2           /* Operand of an instruction */
+#define K_DATA       3           /* Anything else */
+
+/* How each address is referred to */
+#define R_LABEL      1           /* Label on the line at this address */
+#define R_EQU        2           /* Symbol defined by EQU before the code */
+#define R_FWD        4           /* Defined by EQU after its last use, to stay absolute */
+
+struct Dis {                     /* What each of the 256 op-codes disassembles to */
+   int     Mnem;                 /* Index in Opcodes[], or ERR */
+   int     Mode;                 /* INHERENT, etc. */
+   int     Len;                  /* Bytes in the instruction */
+   int     Cyc;                  /* Cycles, before any penalty */
+   int     Shrinks;              /* Absolute mode that as6502 would make zero-page */
+};
+
+struct Out {                     /* Buffered output */
+   FILE   *Fp;
+   int     Len;
+   char    Buf[OUTSIZE];
+};
+
+#ifdef __STDC__
+int main (int argc, const char * *argv);
+void init_dis (void);
+int read_symbols (const char *path);
+int sym_value (const char *str, int base);
+int valid_name (const char *str);
+void disassemble (const struct Cpu *cpu, const char *name, struct Out *out);
+void sweep (const unsigned char *mem);
+void refer (const unsigned char *mem);
+unsigned int operand (const unsigned char *mem, unsigned int a);
+void insn_line (const unsigned char *mem, unsigned int a, struct Out *out);
+unsigned int data_line (const unsigned char *mem, unsigned int a, struct Out *out);
+void put_label (unsigned int a, struct Out *out);
+void fwd_name (unsigned int v, struct Out *out);
+void put_ref (unsigned int v, struct Out *out);
+void put_str (const char *str, struct Out *out);
+void put_hex (unsigned int v, int digits, struct Out *out);
+void put_num (unsigned int v, int digits, struct Out *out);
+void put_col (int col, struct Out *out);
+void put_line (struct Out *out);
+void flush_out (struct Out *out);
+const char *out_name (const char *dir, const char *path);
+void usage (void);
+#else
+#define const
+int main ();
+void init_dis ();
+int read_symbols ();
+int sym_value ();
+int valid_name ();
+void disassemble ();
+void sweep ();
+void refer ();
+unsigned int operand ();
+void insn_line ();
+unsigned int data_line ();
+void put_label ();
+void fwd_name ();
+void put_ref ();
+void put_str ();
+void put_hex ();
+void put_num ();
+void put_col ();
+void put_line ();
+void flush_out ();
+const char *out_name ();
+void usage ();
+#endif   /* __STDC__ */
+
+struct Dis Dis[256];
+char   *Name[MEMSIZE];           /* Names from the symbol file */
+unsigned char Kind[MEMSIZE];     /* K_INSN, etc. */
+unsigned char Ref[MEMSIZE];      /* R_LABEL, etc. */
+unsigned char Loaded[MEMSIZE];
+unsigned int Lastuse[256];       /* Last use of each R_FWD address */
+int     Annotate;                /* Addresses, bytes and cycles in comments */
+int     Linestart;               /* Where the current line began in the buffer */
+
+int main (argc, argv)
+const int argc;
+const char *argv[];
+{
+   static struct Out out;
+   struct Cpu *cpu;
+   FILE *fp;
+   const char *dir;
+   const char *path;
+   long loadaddr;
+   int bad;
+   int errs;
+   int a;
+
+   loadaddr = ERR;
+   dir = NULL;
+   Annotate = NO;
+   errs = 0;
+
+   init_dis ();
+
+   for (a = 1; a < argc && argv[a][0] == '-' && argv[a][1] != EOS; a++) {
+      switch (argv[a][1]) {
+      case 'a':
+         Annotate = YES;
+         break;
+      case 'l':
+         if (++a >= argc)
+            usage ();
+
+         loadaddr = strtol (argv[a], NULL, 0);   /* Where a binary file goes */
+         break;
+      case 'y':
+         if (++a >= argc)
+            usage ();
+
+         if (read_symbols (argv[a]) == ERR)
+            exit (1);
+         break;
+      case 'd':
+         if (++a >= argc)
+            usage ();
+
+         dir = argv[a];    /* One source file in here for each object file */
+         break;
+      default:
+         usage ();
+      }
+   }
+
+   if (a >= argc)
+      usage ();
+
+   if ((cpu = sim_new ()) == NULL) {
+      fputs ("dis6502: out of memory\n", stderr);
+      exit (1);
+   }
+
+   cpu->Loaded = Loaded;
+   out.Fp = stdout;
+   out.Len = 0;
+
+   for ( ; a < argc; a++) {
+      if ((fp = fopen (argv[a], READBIN)) == NULL) {
+         fputs (argv[a], stderr);
+         fputs (": can't open\n", stderr);
+         errs++;
+         continue;
+      }
+
+      memset (cpu->Mem, 0, MEMSIZE);
+      memset (Loaded, 0, sizeof (Loaded));
+      cpu->Lowaddr = MEMSIZE;
+      cpu->Highaddr = -1L;
+
+      bad = sim_load (cpu, fp, loadaddr);
+      fclose (fp);
+
+      if (bad != 0) {
+         fprintf (stderr, "%s: %d bad records\n", argv[a], bad);
+         errs++;
+      }
+
+      if (dir != NULL) {
+         path = out_name (dir, argv[a]);
+         if ((out.Fp = fopen (path, WRITE)) == NULL) {
+            fputs (path, stderr);
+            fputs (": can't open\n", stderr);
+            exit (1);
+         }
+      }
+
+      disassemble (cpu, argv[a], &out);
+
+      if (dir != NULL)
+         fclose (out.Fp);
+   }
+
+   sim_free (cpu);
+
+   return (errs == 0 ? 0 : 1);
+}
+
+
+/* init_dis --- build the decode table from the assembler's opcode table */
+
+void init_dis ()
+{
+   int i, mode, op;
+
+   for (op = 0; op < 256; op++)
+      Dis[op].Mnem = ERR;
+
+   for (i = 0; i < Nopcodes; i++)
+      for (mode = 0; mode < MAXMODES; mode++) {
+         if ((op = Opcodes[i].obj[mode]) == ERR)
+            continue;
+
+         Dis[op].Mnem = i;
+         Dis[op].Mode = mode;
+         Dis[op].Cyc = Opcodes[i].cyc[mode];
+
+         switch (mode) {
+         case INHERENT:
+            Dis[op].Len = 1;
+            break;
+         case ABSOLUTE:
+         case INDEX_X:
+         case INDEX_Y:
+         case INDIRECT:
+            Dis[op].Len = 3;
+            break;
+         default:
+            Dis[op].Len = 2;
+            break;
+         }
+
+         Dis[op].Shrinks = (mode == ABSOLUTE || mode == INDEX_X || mode == INDEX_Y) &&
+                           Opcodes[i].obj[mode + Z_OFFSET] != ERR;
+      }
+}
+
+
+/* read_symbols --- read names for addresses, as 'NAME EQU value' or 'NAME hex' pairs;
+ * from a listing, only its symbol table */
+
+int read_symbols (path)
+const char *path;
+{
+   FILE *fp;
+   char lin[MAXLINE];
+   char *tok[MAXLINE / 2];
+   char *p;
+   int ntoks, i, v;
+   int skip;
+
+   if ((fp = fopen (path, READ)) == NULL) {
+      fputs (path, stderr);
+      fputs (": can't open\n", stderr);
+      return (ERR);
+   }
+
+   skip = NO;
+   while (!skip && fgets (lin, sizeof (lin), fp) != NULL)
+      skip = (strncmp (lin, SYMTAB, strlen (SYMTAB)) == 0);    /* It's a listing */
+
+   if (!skip)
+      rewind (fp);
+
+   while (fgets (lin, sizeof (lin), fp) != NULL) {
+      if (skip && strstr (lin, " labels used") != NULL)
+         break;      /* End of the symbol table */
+
+      if ((p = strchr (lin, COMMENT_SYM)) != NULL)
+         *p = EOS;
+
+      ntoks = 0;
+      for (p = strtok (lin, " \t\r\n"); p != NULL; p = strtok (NULL, " \t\r\n"))
+         tok[ntoks++] = p;
+
+      if (ntoks == 3 && strcasecmp (tok[1], "EQU") == 0) {
+         tok[1] = tok[2];     /* As in source: decimal unless marked as hex */
+         ntoks = 2;
+         v = sym_value (tok[1], 10);
+      }
+      else
+         v = ERR;
+
+      for (i = 0; i + 1 < ntoks; i += 2) {
+         if (v == ERR && (v = sym_value (tok[i + 1], 16)) == ERR)   /* As in a listing: hex */
+            continue;
+
+         if (!valid_name (tok[i]))
+            fprintf (stderr, "%s: %s: not a valid label\n", path, tok[i]);
+         else if (Name[v] == NULL)
+            Name[v] = strdup (tok[i]);
+
+         v = ERR;
+      }
+   }
+
+   fclose (fp);
+
+   return (OK);
+}
+
+
+/* sym_value --- value of a symbol, or ERR if it isn't an address */
+
+int sym_value (str, base)
+const char *str;
+int base;
+{
+   char *end;
+   long v;
+
+   if (*str == HEX) {
+      str++;
+      base = 16;
+   }
+   else if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+      base = 16;
+
+   v = strtol (str, &end, base);
+
+   if (*str == EOS || *end != EOS || v < 0L || v >= MEMSIZE)
+      return (ERR);
+
+   return ((int)v);
+}
+
+
+/* valid_name --- can as6502 use this as a label? */
+
+int valid_name (str)
+const char *str;
+{
+   int i;
+
+   if (!(isalpha (str[0]) || str[0] == '_'))
+      return (NO);
+
+   for (i = 1; str[i] != EOS; i++)
+      if (!(isalnum (str[i]) || str[i] == '_'))
+         return (NO);
+
+   return (i < MAXLABEL);
+}
+
+
+/* disassemble --- write out the source for everything that was loaded */
+
+void disassemble (cpu, name, out)
+const struct Cpu *cpu;
+const char *name;
+struct Out *out;
+{
+   const unsigned char *const mem = cpu->Mem;
+   long a;
+
+   sweep (mem);
+   refer (mem);
+
+   put_str ("; ", out);
+   put_str (name, out);
+   put_line (out);
+   put_line (out);
+
+   for (a = 0L; a < MEMSIZE; a++)
+      if ((Ref[a] & R_EQU) && Name[a] != NULL) {
+         put_str (Name[a], out);
+         put_col (MNEMCOL, out);
+         put_str ("EQU", out);
+         put_col (OPERCOL, out);
+         put_num (a, 4, out);
+         put_line (out);
+      }
+
+   for (a = 0L; a < MEMSIZE; ) {
+      if (!Loaded[a]) {
+         a++;
+         continue;
+      }
+
+      if (a == 0L || !Loaded[a - 1]) {
+         put_line (out);
+         put_col (MNEMCOL, out);
+         put_str ("ORG", out);
+         put_col (OPERCOL, out);
+         put_num (a, 4, out);
+         put_line (out);
+      }
+
+      if (Kind[a] == K_INSN) {
+         insn_line (mem, a, out);
+         a += Dis[mem[a]].Len;
+      }
+      else
+         a = data_line (mem, a, out);
+   }
+
+   put_line (out);
+
+   if (!Loaded[MEMSIZE - 1]) {   /* as6502 won't take even END after $FFFF */
+      put_col (MNEMCOL, out);
+      put_str ("END", out);
+      put_line (out);
+   }
+
+   flush_out (out);
+}
+
+
+/* sweep --- decide which bytes are instructions, from the bottom up */
+
+void sweep (mem)
+const unsigned char *mem;
+{
+   const struct Dis *d;
+   long a, i, dest;
+   int ok;
+
+   memset (Ref, 0, sizeof (Ref));
+
+   for (a = 0L; a < MEMSIZE; ) {
+      if (!Loaded[a]) {
+         Kind[a++] = K_NONE;
+         continue;
+      }
+
+      d = &Dis[mem[a]];
+      ok = (d->Mnem != ERR && a + d->Len <= MEMSIZE);
+
+      for (i = 1; ok && i < d->Len; i++)
+         ok = Loaded[a + i];
+
+      if (ok && d->Mode == RELATIVE) {    /* Branches don't wrap round memory */
+         dest = a + 2 + (signed char)mem[a + 1];
+         ok = (dest >= 0L && dest < MEMSIZE);
+      }
+
+      /* An EQU has to follow this one, and as6502 won't take it after $FFFF */
+      if (ok && d->Shrinks && mem[a + 2] == 0 && a + 2 == MEMSIZE - 1)
+         ok = NO;
+
+      if (ok) {
+         Kind[a] = K_INSN;
+         for (i = 1; i < d->Len; i++)
+            Kind[a + i] = K_OPER;
+
+         a += d->Len;
+      }
+      else
+         Kind[a++] = K_DATA;
+   }
+}
+
+
+/* refer --- find out how each operand will be written, and what needs a label */
+
+void refer (mem)
+const unsigned char *mem;
+{
+   const struct Dis *d;
+   unsigned int v;
+   long a;
+
+   for (a = 0L; a < MEMSIZE; a++) {
+      if (Kind[a] != K_INSN)
+         continue;
+
+      d = &Dis[mem[a]];
+      v = operand (mem, a);
+
+      switch (d->Mode) {
+      case INHERENT:
+      case IMMEDIATE:
+         break;
+      case Z_PAGE:
+      case Z_INDEX_X:
+      case Z_INDEX_Y:
+      case INDIRECT_X:
+      case INDIRECT_Y:
+         if (Name[v] != NULL)   /* Must be defined before use, to be zero-page */
+            Ref[v] |= R_EQU;
+         break;
+      default:
+         if (d->Shrinks && v < 256) {
+            Ref[v] |= R_FWD;
+            Lastuse[v] = a;
+         }
+         else if (Kind[v] == K_INSN || Kind[v] == K_DATA)
+            Ref[v] |= R_LABEL;
+         else if (Name[v] != NULL)
+            Ref[v] |= R_EQU;
+         break;
+      }
+   }
+}
+
+
+/* operand --- the address, value or destination in the instruction at 'a' */
+
+unsigned int operand (mem, a)
+const unsigned char *mem;
+const unsigned int a;
+{
+   const struct Dis *const d = &Dis[mem[a]];
+
+   if (d->Mode == RELATIVE)
+      return (a + 2 + (signed char)mem[a + 1]);
+   else if (d->Len == 3)
+      return (mem[a + 1] | (mem[a + 2] << 8));
+   else if (d->Len == 2)
+      return (mem[a + 1]);
+   else
+      return (0);
+}
+
+
+/* insn_line --- write out one instruction */
+
+void insn_line (mem, a, out)
+const unsigned char *mem;
+const unsigned int a;
+struct Out *out;
+{
+   const struct Dis *const d = &Dis[mem[a]];
+   const unsigned int v = operand (mem, a);
+   int i;
+
+   put_label (a, out);
+   put_col (MNEMCOL, out);
+   put_str (Opcodes[d->Mnem].mnem, out);
+
+   if (d->Mode != INHERENT)
+      put_col (OPERCOL, out);
+
+   switch (d->Mode) {
+   case INHERENT:
+      break;
+   case IMMEDIATE:
+      put_str ("#", out);
+      put_num (v, 2, out);
+      break;
+   case Z_PAGE:
+   case Z_INDEX_X:
+   case Z_INDEX_Y:
+   case INDIRECT_X:
+   case INDIRECT_Y:
+      if (d->Mode == INDIRECT_X || d->Mode == INDIRECT_Y)
+         put_str ("(", out);
+
+      if (Name[v] != NULL)
+         put_str (Name[v], out);
+      else
+         put_num (v, 2, out);
+
+      if (d->Mode == Z_INDEX_X || d->Mode == INDIRECT_X)
+         put_str (",X", out);
+      else if (d->Mode == Z_INDEX_Y)
+         put_str (",Y", out);
+
+      if (d->Mode == INDIRECT_X)
+         put_str (")", out);
+      else if (d->Mode == INDIRECT_Y)
+         put_str ("),Y", out);
+      break;
+   default:
+      if (d->Mode == INDIRECT)
+         put_str ("(", out);
+
+      if (d->Shrinks && v < 256)
+         fwd_name (v, out);
+      else
+         put_ref (v, out);
+
+      if (d->Mode == INDEX_X)
+         put_str (",X", out);
+      else if (d->Mode == INDEX_Y)
+         put_str (",Y", out);
+      else if (d->Mode == INDIRECT)
+         put_str (")", out);
+      break;
+   }
+
+   if (Annotate) {
+      put_col (COMMCOL, out);
+      put_str ("; ", out);
+      put_hex (a, 4, out);
+
+      for (i = 0; i < d->Len; i++) {
+         put_str (" ", out);
+         put_hex (mem[a + i], 2, out);
+      }
+
+      put_col (COMMCOL + 16, out);
+      put_hex (d->Cyc, 1, out);
+   }
+
+   put_line (out);
+
+   /* Zero-page address used as absolute: define it now that all its uses are over */
+   if (d->Shrinks && v < 256 && Lastuse[v] == a) {
+      fwd_name (v, out);
+      put_col (MNEMCOL, out);
+      put_str ("EQU", out);
+      put_col (OPERCOL, out);
+      put_num (v, 4, out);
+      put_line (out);
+   }
+}
+
+
+/* data_line --- write out bytes that aren't code, and return the next address */
+
+unsigned int data_line (mem, a, out)
+const unsigned char *mem;
+unsigned int a;
+struct Out *out;
+{
+   const unsigned int first = a;
+   int n;
+
+   put_label (a, out);
+   put_col (MNEMCOL, out);
+   put_str ("FCB", out);
+   put_col (OPERCOL, out);
+
+   for (n = 0; n < MAXFCB && a < MEMSIZE && Kind[a] == K_DATA && (n == 0 || !(Ref[a] & R_LABEL)); n++, a++) {
+      if (n != 0)
+         put_str (",", out);
+
+      put_num (mem[a], 2, out);
+   }
+
+   if (Annotate) {
+      put_col (COMMCOL, out);
+      put_str ("; ", out);
+      put_hex (first, 4, out);
+   }
+
+   put_line (out);
+
+   return (a);
+}
+
+
+/* put_label --- put the label for an address, if anything refers to it */
+
+void put_label (a, out)
+const unsigned int a;
+struct Out *out;
+{
+   if (!(Ref[a] & R_LABEL) || (Ref[a] & R_EQU))    /* EQU has already defined it */
+      return;
+
+   if (Name[a] != NULL)
+      put_str (Name[a], out);
+   else {
+      put_str ("L", out);
+      put_hex (a, 4, out);
+   }
+}
+
+
+/* fwd_name --- name for a zero-page address that has to stay absolute */
+
+void fwd_name (v, out)
+const unsigned int v;
+struct Out *out;
+{
+   put_str ("A", out);
+   put_hex (v, 4, out);
+}
+
+
+/* put_ref --- refer to an address by name, if it has one */
+
+void put_ref (v, out)
+const unsigned int v;
+struct Out *out;
+{
+   if ((Ref[v] & (R_LABEL | R_EQU)) && Name[v] != NULL)
+      put_str (Name[v], out);
+   else if (Ref[v] & R_LABEL) {
+      put_str ("L", out);
+      put_hex (v, 4, out);
+   }
+   else
+      put_num (v, 4, out);
+}
+
+
+/* put_str --- add a string to the output */
+
+void put_str (str, out)
+const char *str;
+struct Out *out;
+{
+   while (*str != EOS)
+      out->Buf[out->Len++] = *str++;
+}
+
+
+/* put_hex --- add hex digits to the output */
+
+void put_hex (v, digits, out)
+const unsigned int v;
+int digits;
+struct Out *out;
+{
+   static const char hex[] = "0123456789ABCDEF";
+
+   while (--digits >= 0)
+      out->Buf[out->Len++] = hex[(v >> (digits * 4)) & 0xf];
+}
+
+
+/* put_num --- add a hex number, as as6502 writes it */
+
+void put_num (v, digits, out)
+const unsigned int v;
+const int digits;
+struct Out *out;
+{
+   out->Buf[out->Len++] = HEX;
+   put_hex (v, digits, out);
+}
+
+
+/* put_col --- pad the line out to a column, with at least one space */
+
+void put_col (col, out)
+const int col;
+struct Out *out;
+{
+   if (out->Len > Linestart)
+      out->Buf[out->Len++] = ' ';
+
+   while (out->Len - Linestart < col)
+      out->Buf[out->Len++] = ' ';
+}
+
+
+/* put_line --- finish a line, and write out the buffer if it is nearly full */
+
+void put_line (out)
+struct Out *out;
+{
+   out->Buf[out->Len++] = NEWLINE;
+
+   if (out->Len > OUTSIZE - MAXLINE)
+      flush_out (out);
+
+   Linestart = out->Len;
+}
+
+
+/* flush_out --- write out the buffer */
+
+void flush_out (out)
+struct Out *out;
+{
+   fwrite (out->Buf, sizeof (char), out->Len, out->Fp);
+   out->Len = 0;
+   Linestart = 0;
+}
+
+
+/* out_name --- name of the source file in 'dir' for an object file */
+
+const char *out_name (dir, path)
+const char *dir;
+const char *path;
+{
+   static char name[MAXLINE];
+   const char *base;
+   char *dot;
+
+   base = strrchr (path, '/');
+   base = (base == NULL) ? path : base + 1;
+
+   snprintf (name, sizeof (name), "%s/%s", dir, base);
+
+   if ((dot = strrchr (name, '.')) != NULL && strchr (dot, '/') == NULL)
+      *dot = EOS;
+
+   strncat (name, ".asm", sizeof (name) - strlen (name) - 1);
+
+   return (name);
+}
+
+
+/* usage --- print a usage message and exit */
+
+void usage ()
+{
+   fputs ("Usage: dis6502 [-a] [-l loadaddr] [-y symbols] [-d dir] file...\n", stderr);
+   exit (1);
+}
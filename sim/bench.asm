@@ -0,0 +1,52 @@
+; bench --- long-running program to time the 6502 simulator    2026-10-17
+; Copyright (c) John Honniball. All rights reserved
+
+; CRC-16/CCITT, a bit at a time, over 32K of memory, 64 times over.
+; About 440 million cycles.  Ends at BRK with the CRC in X (high)
+; and Y (low), so that the answer can be checked too.
+
+PTR             EQU     $F0               ; Zero-page pointer to the data
+CRC             EQU     $F2               ; Low byte, then high byte
+COUNT           EQU     $F4               ; Passes left to do
+
+                ORG     $0200
+START           LDA     #64
+                STA     COUNT
+PASS            LDA     #$FF
+                STA     CRC
+                STA     CRC+1
+                LDA     #$00
+                STA     PTR
+                LDA     #$10              ; Data from $1000 to $8FFF
+                STA     PTR+1
+                LDY     #0
+NEXTB           LDA     (PTR),Y
+                EOR     CRC+1
+                STA     CRC+1
+                LDX     #8
+SHIFT           ASL     CRC
+                ROL     CRC+1
+                BCC     NOXOR
+                LDA     CRC+1             ; Polynomial is $1021
+                EOR     #$10
+                STA     CRC+1
+                LDA     CRC
+                EOR     #$21
+                STA     CRC
+NOXOR           DEX
+                BNE     SHIFT
+                INY
+                BNE     NEXTB
+                INC     PTR+1
+                LDA     PTR+1
+                CMP     #$90
+                BNE     NEXTB
+                DEC     COUNT
+                BNE     PASS
+                LDX     CRC+1
+                LDY     CRC
+                BRK
+
+                ORG     $FFFC
+                FCW     START             ; Reset vector
+                END
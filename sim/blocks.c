@@ -0,0 +1,1070 @@
+/* blocks --- run the 6502 from pre-decoded basic blocks    2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Straight-line runs of code are decoded once, into blocks of handler
+ * pointers with their operands and cycle counts already worked out.
+ * A block ends at a branch, jump, call, return, BRK or illegal op-code,
+ * or after MAXRUN instructions.  Every byte of memory has a count of
+ * the blocks that cover it, and a store to a byte of code throws those
+ * blocks away, so self-modifying code still works.
+ */
+
+/* Modification:
+ * 2026-10-17 agent Mark the pages that stores hit, for snapshots
+ * 2026-10-17 agent Send instructions that might reach a device through the memory map
+ * 2026-10-17 agent Run in batches up to the next device event, and take interrupts
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#define MEM          (cpu->Mem)
+#define ZPWORD(a)    (MEM[a] | (MEM[BYTE((a) + 1)] << 8))
+#define SETNZ(v)     (cpu->Nflag = cpu->Zflag = (v))
+#define PENALTY(base, ea)  if (ip->Page && CROSSES(base, ea)) cpu->Cycles++
+#define STORE(ea, v) MEM[ea] = (v); cpu->Dirty[(ea) >> 8] = YES; \
+                     if (cpu->Codemap[ea]) return (smc (cpu, ip, ea))
+#define PULL()       MEM[STACKPAGE + ++cpu->S]
+
+/* Operand fetches for each addressing mode, into 'm' */
+#define RD_IMM       m = ip->Arg
+#define RD_DIR       m = MEM[ip->Arg]
+#define RD_ZPX       m = MEM[BYTE(ip->Arg + cpu->X)]
+#define RD_ZPY       m = MEM[BYTE(ip->Arg + cpu->Y)]
+#define RD_ABX       { const unsigned int ea = WORD(ip->Arg + cpu->X); PENALTY(ip->Arg, ea); m = MEM[ea]; }
+#define RD_ABY       { const unsigned int ea = WORD(ip->Arg + cpu->Y); PENALTY(ip->Arg, ea); m = MEM[ea]; }
+#define RD_INX       { const unsigned int t = BYTE(ip->Arg + cpu->X); m = MEM[ZPWORD(t)]; }
+#define RD_INY       { const unsigned int t = ZPWORD(ip->Arg), ea = WORD(t + cpu->Y); \
+                       PENALTY(t, ea); m = MEM[ea]; }
+
+/* Effective addresses for stores and read-modify-write, into 'ea' */
+#define EA_DIR       ea = ip->Arg
+#define EA_ZPX       ea = BYTE(ip->Arg + cpu->X)
+#define EA_ZPY       ea = BYTE(ip->Arg + cpu->Y)
+#define EA_ABX       ea = WORD(ip->Arg + cpu->X)
+#define EA_ABY       ea = WORD(ip->Arg + cpu->Y)
+#define EA_INX       { const unsigned int t = BYTE(ip->Arg + cpu->X); ea = ZPWORD(t); }
+#define EA_INY       { const unsigned int t = ZPWORD(ip->Arg); ea = WORD(t + cpu->Y); }
+
+#define HANDLER(name) \
+int name (cpu, ip) \
+struct Cpu *cpu; \
+const struct Insn *ip;
+
+#define READER(name, fetch, body) \
+HANDLER (name) \
+{ \
+   unsigned int m; \
+   fetch; \
+   body; \
+   return (0); \
+}
+
+#define WRITER(name, addr, val) \
+HANDLER (name) \
+{ \
+   unsigned int ea; \
+   addr; \
+   STORE (ea, val); \
+   return (0); \
+}
+
+#define MODIFIER(name, addr, body) \
+HANDLER (name) \
+{ \
+   unsigned int ea, m; \
+   addr; \
+   m = MEM[ea]; \
+   body; \
+   STORE (ea, m); \
+   return (0); \
+}
+
+#define ACCUMULATOR(name, body) \
+HANDLER (name) \
+{ \
+   unsigned int m; \
+   m = cpu->A; \
+   body; \
+   cpu->A = m; \
+   return (0); \
+}
+
+#define IMPLIED(name, body) \
+HANDLER (name) \
+{ \
+   body; \
+   return (0); \
+}
+
+#define BRANCH(name, cond) \
+HANDLER (name) \
+{ \
+   if (cond) { \
+      cpu->Cycles += CROSSES(ip->Next, ip->Arg) ? 2 : 1; \
+      if (ip->Arg == WORD(ip->Next - 2)) \
+         cpu->Stop = STOP_LOOP; \
+      cpu->Pc = ip->Arg; \
+   } \
+   else \
+      cpu->Pc = ip->Next; \
+   return (1); \
+}
+
+#define COMPARE(reg) { \
+   const unsigned int t = (reg) - m; \
+   cpu->Cflag = !(t & 0x100); \
+   SETNZ(BYTE(t)); }
+
+/* Every mode that an instruction of each kind might have */
+#define READERS(x, body) \
+   READER (x##_imm, RD_IMM, body) \
+   READER (x##_dir, RD_DIR, body) \
+   READER (x##_zpx, RD_ZPX, body) \
+   READER (x##_zpy, RD_ZPY, body) \
+   READER (x##_abx, RD_ABX, body) \
+   READER (x##_aby, RD_ABY, body) \
+   READER (x##_inx, RD_INX, body) \
+   READER (x##_iny, RD_INY, body)
+
+#define WRITERS(x, val) \
+   WRITER (x##_dir, EA_DIR, val) \
+   WRITER (x##_zpx, EA_ZPX, val) \
+   WRITER (x##_zpy, EA_ZPY, val) \
+   WRITER (x##_abx, EA_ABX, val) \
+   WRITER (x##_aby, EA_ABY, val) \
+   WRITER (x##_inx, EA_INX, val) \
+   WRITER (x##_iny, EA_INY, val)
+
+#define MODIFIERS(x, body) \
+   ACCUMULATOR (x##_acc, body) \
+   MODIFIER (x##_dir, EA_DIR, body) \
+   MODIFIER (x##_zpx, EA_ZPX, body) \
+   MODIFIER (x##_abx, EA_ABX, body)
+
+/* The same, laid out by addressing mode, as in Opcodes[] */
+/*                  inh       imm      abs      abs,X    abs,Y    zpage    zpage,X  zpage,Y  ind,X    ind,Y    rel   ind */
+#define READSET(x)  { NULL,    x##_imm, x##_dir, x##_abx, x##_aby, x##_dir, x##_zpx, x##_zpy, x##_inx, x##_iny, NULL, NULL }
+#define WRITESET(x) { NULL,    NULL,    x##_dir, x##_abx, x##_aby, x##_dir, x##_zpx, x##_zpy, x##_inx, x##_iny, NULL, NULL }
+#define MODSET(x)   { x##_acc, NULL,    x##_dir, x##_abx, NULL,    x##_dir, x##_zpx, NULL,    NULL,    NULL,    NULL, NULL }
+#define RELSET(x)   { NULL,    NULL,    NULL,    NULL,    NULL,    NULL,    NULL,    NULL,    NULL,    NULL,    x,    NULL }
+
+struct Opset {
+   int     Op;                   /* I_ADC, etc. */
+   Handler Fn[MAXMODES];         /* Handler for each addressing mode */
+};
+
+#ifdef __STDC__
+int smc (struct Cpu *cpu, const struct Insn *ip, unsigned int ea);
+int io_ (struct Cpu *cpu, const struct Insn *ip);
+int reaches_io (const struct Cpu *cpu, const struct Decode *d, unsigned int arg);
+void push (struct Cpu *cpu, unsigned int v);
+unsigned char pack_p (const struct Cpu *cpu);
+void unpack_p (struct Cpu *cpu, unsigned int p);
+void interrupt (struct Cpu *cpu);
+const struct Insn *step_block (struct Cpu *cpu, const struct Block *b, unsigned long deadline);
+struct Block *build (struct Cpu *cpu, unsigned int pc);
+int ends_block (int op);
+void invalidate (struct Cpu *cpu, unsigned int ea);
+void unlink_page (struct Cache *c, struct Block *b, unsigned int page);
+int link_of (const struct Block *b, unsigned int page);
+void drop (struct Cache *c, struct Block *b);
+void bury (struct Cache *c);
+#else
+#define const
+int smc ();
+int io_ ();
+int reaches_io ();
+void push ();
+unsigned char pack_p ();
+void unpack_p ();
+void interrupt ();
+const struct Insn *step_block ();
+struct Block *build ();
+int ends_block ();
+void invalidate ();
+void unlink_page ();
+int link_of ();
+void drop ();
+void bury ();
+#endif   /* __STDC__ */
+
+Handler Hand[256];               /* Handler for each op-code */
+
+
+/* The handlers themselves */
+
+READERS (adc_, adc (cpu, m))
+READERS (and_, SETNZ(cpu->A &= m))
+READERS (bit_, cpu->Nflag = m; cpu->Vflag = m & P_V; cpu->Zflag = cpu->A & m)
+READERS (cmp_, COMPARE(cpu->A))
+READERS (cpx_, COMPARE(cpu->X))
+READERS (cpy_, COMPARE(cpu->Y))
+READERS (eor_, SETNZ(cpu->A ^= m))
+READERS (lda_, SETNZ(cpu->A = m))
+READERS (ldx_, SETNZ(cpu->X = m))
+READERS (ldy_, SETNZ(cpu->Y = m))
+READERS (ora_, SETNZ(cpu->A |= m))
+READERS (sbc_, sbc (cpu, m))
+
+WRITERS (sta_, cpu->A)
+WRITERS (stx_, cpu->X)
+WRITERS (sty_, cpu->Y)
+
+MODIFIERS (asl_, cpu->Cflag = m >> 7; m = BYTE(m << 1); SETNZ(m))
+MODIFIERS (lsr_, cpu->Cflag = m & 1; m >>= 1; SETNZ(m))
+MODIFIERS (rol_, m = (m << 1) | cpu->Cflag; cpu->Cflag = m >> 8; m = BYTE(m); SETNZ(m))
+MODIFIERS (ror_, m |= cpu->Cflag << 8; cpu->Cflag = m & 1; m >>= 1; SETNZ(m))
+MODIFIERS (inc_, m = BYTE(m + 1); SETNZ(m))
+MODIFIERS (dec_, m = BYTE(m - 1); SETNZ(m))
+
+IMPLIED (clc_, cpu->Cflag = 0)
+IMPLIED (sec_, cpu->Cflag = 1)
+IMPLIED (cld_, cpu->Dflag = 0)
+IMPLIED (sed_, cpu->Dflag = P_D)
+IMPLIED (sei_, cpu->Iflag = P_I)
+IMPLIED (clv_, cpu->Vflag = 0)
+IMPLIED (nop_, ;)
+IMPLIED (tax_, SETNZ(cpu->X = cpu->A))
+IMPLIED (tay_, SETNZ(cpu->Y = cpu->A))
+IMPLIED (txa_, SETNZ(cpu->A = cpu->X))
+IMPLIED (tya_, SETNZ(cpu->A = cpu->Y))
+IMPLIED (tsx_, SETNZ(cpu->X = cpu->S))
+IMPLIED (txs_, cpu->S = cpu->X)
+IMPLIED (inx_, SETNZ(++cpu->X))
+IMPLIED (iny_, SETNZ(++cpu->Y))
+IMPLIED (dex_, SETNZ(--cpu->X))
+IMPLIED (dey_, SETNZ(--cpu->Y))
+IMPLIED (pla_, SETNZ(cpu->A = PULL()))
+
+BRANCH (bcc_, !cpu->Cflag)
+BRANCH (bcs_, cpu->Cflag)
+BRANCH (beq_, cpu->Zflag == 0)
+BRANCH (bne_, cpu->Zflag != 0)
+BRANCH (bmi_, cpu->Nflag & 0x80)
+BRANCH (bpl_, !(cpu->Nflag & 0x80))
+BRANCH (bvc_, !cpu->Vflag)
+BRANCH (bvs_, cpu->Vflag)
+
+
+HANDLER (cli_)    /* Leave the block if an interrupt is waiting */
+{
+   cpu->Iflag = 0;
+
+   if (cpu->Irqs > 0) {
+      cpu->Pc = ip->Next;
+      return (1);
+   }
+
+   return (0);
+}
+
+
+HANDLER (plp_)    /* Likewise */
+{
+   unpack_p (cpu, PULL());
+
+   if (cpu->Irqs > 0 && !cpu->Iflag) {
+      cpu->Pc = ip->Next;
+      return (1);
+   }
+
+   return (0);
+}
+
+
+HANDLER (pha_)
+{
+   unsigned int ea;
+
+   ea = STACKPAGE + cpu->S--;
+   STORE (ea, cpu->A);
+   return (0);
+}
+
+
+HANDLER (php_)
+{
+   unsigned int ea;
+
+   ea = STACKPAGE + cpu->S--;
+   STORE (ea, pack_p (cpu) | P_B);
+   return (0);
+}
+
+
+HANDLER (jmp_abs)
+{
+   if (ip->Arg == WORD(ip->Next - 3))
+      cpu->Stop = STOP_LOOP;
+
+   cpu->Pc = ip->Arg;
+   return (1);
+}
+
+
+HANDLER (jmp_ind)    /* The NMOS 6502 doesn't carry into the high byte of the pointer */
+{
+   unsigned int t;
+
+   t = ip->Arg;
+   cpu->Pc = MEM[t] | (MEM[(t & 0xff00) | BYTE(t + 1)] << 8);
+
+   if (cpu->Pc == WORD(ip->Next - 3))
+      cpu->Stop = STOP_LOOP;
+
+   return (1);
+}
+
+
+HANDLER (jsr_)
+{
+   unsigned int t;
+
+   t = WORD(ip->Next - 1);    /* Return address, less one */
+   push (cpu, t >> 8);
+   push (cpu, BYTE(t));
+   cpu->Pc = ip->Arg;
+   return (1);
+}
+
+
+HANDLER (rts_)
+{
+   unsigned int t;
+
+   t = PULL();
+   t |= PULL() << 8;
+   cpu->Pc = WORD(t + 1);
+   return (1);
+}
+
+
+HANDLER (rti_)
+{
+   unsigned int t;
+
+   unpack_p (cpu, PULL());
+   t = PULL();
+   t |= PULL() << 8;
+   cpu->Pc = t;
+   return (1);
+}
+
+
+HANDLER (brk_)
+{
+   unsigned int t;
+
+   if (cpu->Brkhalt) {     /* Stop at the BRK, without running it */
+      cpu->Pc = WORD(ip->Next - 1);
+      cpu->Cycles -= ip->Cyc;
+      cpu->Insns--;
+      cpu->Stop = STOP_BRK;
+      return (1);
+   }
+
+   t = WORD(ip->Next + 1);    /* BRK skips a padding byte */
+   push (cpu, t >> 8);
+   push (cpu, BYTE(t));
+   push (cpu, pack_p (cpu) | P_B);
+   cpu->Iflag = P_I;
+   cpu->Pc = MEM[IRQVEC] | (MEM[IRQVEC + 1] << 8);
+   return (1);
+}
+
+
+HANDLER (ill_)
+{
+   cpu->Pc = WORD(ip->Next - 1);
+   cpu->Cycles -= ip->Cyc;
+   cpu->Insns--;
+   cpu->Stop = STOP_ILLEGAL;
+   return (1);
+}
+
+
+HANDLER (end_)    /* Falls through into the next block */
+{
+   cpu->Pc = ip->Next;
+   return (1);
+}
+
+
+struct Opset Opsets[] = {
+   { I_ADC, READSET(adc_) },
+   { I_AND, READSET(and_) },
+   { I_ASL, MODSET(asl_) },
+   { I_BCC, RELSET(bcc_) },
+   { I_BCS, RELSET(bcs_) },
+   { I_BEQ, RELSET(beq_) },
+   { I_BIT, READSET(bit_) },
+   { I_BMI, RELSET(bmi_) },
+   { I_BNE, RELSET(bne_) },
+   { I_BPL, RELSET(bpl_) },
+   { I_BRK, { brk_ } },
+   { I_BVC, RELSET(bvc_) },
+   { I_BVS, RELSET(bvs_) },
+   { I_CLC, { clc_ } },
+   { I_CLD, { cld_ } },
+   { I_CLI, { cli_ } },
+   { I_CLV, { clv_ } },
+   { I_CMP, READSET(cmp_) },
+   { I_CPX, READSET(cpx_) },
+   { I_CPY, READSET(cpy_) },
+   { I_DEC, MODSET(dec_) },
+   { I_DEX, { dex_ } },
+   { I_DEY, { dey_ } },
+   { I_EOR, READSET(eor_) },
+   { I_INC, MODSET(inc_) },
+   { I_INX, { inx_ } },
+   { I_INY, { iny_ } },
+   { I_JMP, { NULL, NULL, jmp_abs, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, jmp_ind } },
+   { I_JSR, { NULL, NULL, jsr_ } },
+   { I_LDA, READSET(lda_) },
+   { I_LDX, READSET(ldx_) },
+   { I_LDY, READSET(ldy_) },
+   { I_LSR, MODSET(lsr_) },
+   { I_NOP, { nop_ } },
+   { I_ORA, READSET(ora_) },
+   { I_PHA, { pha_ } },
+   { I_PHP, { php_ } },
+   { I_PLA, { pla_ } },
+   { I_PLP, { plp_ } },
+   { I_ROL, MODSET(rol_) },
+   { I_ROR, MODSET(ror_) },
+   { I_RTI, { rti_ } },
+   { I_RTS, { rts_ } },
+   { I_SBC, READSET(sbc_) },
+   { I_SEC, { sec_ } },
+   { I_SED, { sed_ } },
+   { I_SEI, { sei_ } },
+   { I_STA, WRITESET(sta_) },
+   { I_STX, WRITESET(stx_) },
+   { I_STY, WRITESET(sty_) },
+   { I_TAX, { tax_ } },
+   { I_TAY, { tay_ } },
+   { I_TSX, { tsx_ } },
+   { I_TXA, { txa_ } },
+   { I_TXS, { txs_ } },
+   { I_TYA, { tya_ } },
+   { I_ILL, { ill_ } }
+};
+
+
+/* init_handlers --- choose a handler for each op-code, from the decode table */
+
+void init_handlers ()
+{
+   int op;
+   const struct Decode *d;
+
+   for (op = 0; op < 256; op++) {
+      d = &Decode[op];
+      Hand[op] = Opsets[d->Op].Fn[d->Mode];
+
+      if (Opsets[d->Op].Op != d->Op || Hand[op] == NULL) {
+         fprintf (stderr, "%s: internal error: no handler for mode %d\n", Simops[d->Op], d->Mode);
+         exit (1);
+      }
+   }
+}
+
+
+/* sim_run --- run until something stops it, or for 'maxcycles' cycles.
+ * Blocks run straight through unless the next event or the limit might come
+ * part way, and events and interrupts are seen to between them. */
+
+int sim_run (cpu, maxcycles)
+struct Cpu *cpu;
+const unsigned long maxcycles;
+{
+   struct Cache *c;
+   struct Block *b;
+   const struct Insn *ip;
+   unsigned long start, deadline;
+
+   if (cpu->Cache == NULL) {
+      if ((cpu->Cache = calloc (1, sizeof (struct Cache))) == NULL) {
+         cpu->Stop = STOP_MEMORY;
+         return (cpu->Stop);
+      }
+
+      cpu->Codemap = cpu->Cache->Code;
+   }
+   else if (cpu->Stale)
+      sim_flush (cpu);
+
+   cpu->Stale = NO;
+   c = cpu->Cache;
+   unpack_p (cpu, cpu->P);
+   cpu->Stop = STOP_NONE;
+   start = cpu->Cycles;
+
+   for (;;) {
+      if (cpu->Nevents > 0 && cpu->Events[0].When <= cpu->Cycles)
+         fire_events (cpu);
+
+      if (cpu->Irqs > 0 && !cpu->Iflag)
+         interrupt (cpu);
+
+      if (cpu->Cycles - start >= maxcycles)
+         break;
+
+      if ((b = c->At[cpu->Pc]) == NULL && (b = build (cpu, cpu->Pc)) == NULL) {
+         cpu->Stop = STOP_MEMORY;
+         break;
+      }
+
+      deadline = DEADLINE(cpu, start + maxcycles);
+
+      if (cpu->Prof == NULL && cpu->Cycles + b->Most < deadline)
+         for (ip = b->Insn; (*ip->Fn) (cpu, ip) == 0; ip++)
+            ;
+      else
+         ip = step_block (cpu, b, deadline);
+
+      cpu->Cycles += ip->Sofar;
+      cpu->Insns += ip->Count;
+
+      if (c->Dead != NULL)
+         bury (c);
+
+      if (cpu->Stop != STOP_NONE)
+         break;
+   }
+
+   if (cpu->Stop == STOP_NONE)
+      cpu->Stop = STOP_LIMIT;
+
+   cpu->P = pack_p (cpu);
+
+   return (cpu->Stop);
+}
+
+
+/* sim_poke --- store a byte from outside the simulation, dropping any code it was part of */
+
+void sim_poke (cpu, addr, byte)
+struct Cpu *cpu;
+const long addr;
+const int byte;
+{
+   const unsigned int ea = WORD(addr);
+
+   cpu->Mem[ea] = byte;
+   cpu->Dirty[ea >> 8] = YES;
+
+   if (cpu->Codemap != NULL && cpu->Codemap[ea]) {
+      invalidate (cpu, ea);
+      bury (cpu->Cache);
+   }
+}
+
+
+/* sim_flush --- throw away every decoded block */
+
+void sim_flush (cpu)
+struct Cpu *cpu;
+{
+   struct Cache *c;
+   long a;
+
+   if ((c = cpu->Cache) == NULL)
+      return;
+
+   for (a = 0L; a < MEMSIZE; a++)
+      if (c->At[a] != NULL)
+         free (c->At[a]);
+
+   bury (c);
+   memset (c, 0, sizeof (struct Cache));
+}
+
+
+/* smc --- a store has hit code: drop the blocks and leave this one */
+
+int smc (cpu, ip, ea)
+struct Cpu *cpu;
+const struct Insn *ip;
+const unsigned int ea;
+{
+   invalidate (cpu, ea);
+   cpu->Pc = ip->Next;
+
+   return (1);
+}
+
+
+/* adc --- add with carry, in binary or decimal */
+
+void adc (cpu, m)
+struct Cpu *cpu;
+const unsigned int m;
+{
+   unsigned int a, r;
+
+   a = cpu->A;
+
+   if (cpu->Dflag) {    /* NMOS: Z from the binary sum, N and V from the decimal one */
+      r = (a & 0x0f) + (m & 0x0f) + cpu->Cflag;
+      if (r > 9)
+         r += 6;
+      r = (r & 0x0f) + (a & 0xf0) + (m & 0xf0) + (r > 0x0f ? 0x10 : 0);
+      cpu->Zflag = BYTE(a + m + cpu->Cflag);
+      cpu->Nflag = BYTE(r);
+      cpu->Vflag = ~(a ^ m) & (a ^ r) & 0x80;
+      if ((r & 0x1f0) > 0x90)
+         r += 0x60;
+      cpu->Cflag = (r > 0xff);
+      cpu->A = BYTE(r);
+   }
+   else {
+      r = a + m + cpu->Cflag;
+      cpu->Vflag = ~(a ^ m) & (a ^ r) & 0x80;
+      cpu->Cflag = r >> 8;
+      SETNZ(cpu->A = BYTE(r));
+   }
+}
+
+
+/* sbc --- subtract with borrow, in binary or decimal */
+
+void sbc (cpu, m)
+struct Cpu *cpu;
+const unsigned int m;
+{
+   unsigned int a, r, lo, hi;
+
+   a = cpu->A;
+   r = a - m - !cpu->Cflag;
+   cpu->Vflag = (a ^ m) & (a ^ r) & 0x80;
+
+   if (cpu->Dflag) {    /* NMOS: all the flags from the binary difference */
+      lo = (a & 0x0f) - (m & 0x0f) - !cpu->Cflag;
+      hi = (a >> 4) - (m >> 4);
+      if (lo & 0x10) {
+         lo -= 6;
+         hi--;
+      }
+      if (hi & 0x10)
+         hi -= 6;
+      SETNZ(BYTE(r));
+      cpu->Cflag = !(r & 0x100);
+      cpu->A = BYTE((hi << 4) | (lo & 0x0f));
+   }
+   else {
+      cpu->Cflag = !(r & 0x100);
+      SETNZ(cpu->A = BYTE(r));
+   }
+}
+
+
+/* io_ --- do an instruction that might reach a device.  The device's byte
+ * is put in memory for the usual handler to read, and what the handler
+ * stores is taken back out of memory and given to the device. */
+
+int io_ (cpu, ip)
+struct Cpu *cpu;
+const struct Insn *ip;
+{
+   const unsigned int op = MEM[ip->Addr];
+   const struct Decode *d = &Decode[op];
+   unsigned long now;
+   struct Device *dev;
+   unsigned int ea, t, held, base;
+   int r, touched;
+
+   switch (d->Mode) {
+   case ABSOLUTE:
+      EA_DIR;
+      base = ea;
+      break;
+   case INDEX_X:
+      EA_ABX;
+      base = ip->Arg;
+      break;
+   case INDEX_Y:
+      EA_ABY;
+      base = ip->Arg;
+      break;
+   case INDIRECT_X:
+      EA_INX;
+      base = ea;
+      break;
+   case INDIRECT_Y:
+      base = ZPWORD(ip->Arg);
+      ea = WORD(base + cpu->Y);
+      break;
+   default:
+      return ((*Hand[op]) (cpu, ip));
+   }
+
+   /* The end of the instruction, counting a page crossing, as sim_interp() has it */
+   now = cpu->Cycles + ip->Sofar + (ip->Page && CROSSES(base, ea) ? 1 : 0);
+   touched = NO;
+
+   if (LOADS(d->Op) && (dev = cpu->Rdev[ea >> 8]) != NULL) {
+      MEM[ea] = (*dev->Read) (dev, ea, now);
+      cpu->Dirty[ea >> 8] = YES;
+      touched = YES;
+   }
+
+   if (STORES(d->Op) && (dev = cpu->Wdev[ea >> 8]) != NULL) {
+      held = MEM[ea];
+      r = (*Hand[op]) (cpu, ip);
+      t = MEM[ea];
+      MEM[ea] = held;      /* So ROM stays as it was */
+      (*dev->Write) (dev, ea, t, now);
+      touched = YES;
+   }
+   else
+      r = (*Hand[op]) (cpu, ip);
+
+   if (cpu->Codemap[ea])   /* Running code from a device's page, which is unlikely */
+      return (smc (cpu, ip, ea));
+
+   if (touched) {          /* It may have an event or an interrupt for us sooner */
+      cpu->Pc = ip->Next;
+      return (1);
+   }
+
+   return (r);
+}
+
+
+/* reaches_io --- might this instruction read or store in a page that has a device? */
+
+int reaches_io (cpu, d, arg)
+const struct Cpu *cpu;
+const struct Decode *d;
+const unsigned int arg;
+{
+   unsigned int p0, p1;
+
+   if (d->Op == I_JMP || d->Op == I_JSR)
+      return (NO);
+
+   switch (d->Mode) {
+   case ABSOLUTE:
+      p0 = p1 = arg >> 8;
+      break;
+   case INDEX_X:     /* Anywhere up to 255 bytes on, and pages 0 and 1 have no devices */
+   case INDEX_Y:
+      p0 = arg >> 8;
+      p1 = BYTE(p0 + 1);
+      break;
+   case INDIRECT_X:  /* Could be anywhere */
+   case INDIRECT_Y:
+      return (YES);
+   default:          /* No devices in the zero page */
+      return (NO);
+   }
+
+   return (cpu->Rdev[p0] != NULL || cpu->Wdev[p0] != NULL ||
+           cpu->Rdev[p1] != NULL || cpu->Wdev[p1] != NULL);
+}
+
+
+/* push --- push a byte, for the instructions that end a block anyway */
+
+void push (cpu, v)
+struct Cpu *cpu;
+const unsigned int v;
+{
+   const unsigned int ea = STACKPAGE + cpu->S--;
+
+   MEM[ea] = v;
+   cpu->Dirty[ea >> 8] = YES;
+
+   if (cpu->Codemap[ea])
+      invalidate (cpu, ea);
+}
+
+
+/* pack_p --- put the status register together from the unpacked flags */
+
+unsigned char pack_p (cpu)
+const struct Cpu *cpu;
+{
+   return ((cpu->Nflag & P_N) | (cpu->Vflag ? P_V : 0) | P_U | cpu->Dflag |
+           cpu->Iflag | (cpu->Zflag ? 0 : P_Z) | (cpu->Cflag ? P_C : 0));
+}
+
+
+/* unpack_p --- take the status register apart */
+
+void unpack_p (cpu, p)
+struct Cpu *cpu;
+const unsigned int p;
+{
+   cpu->Nflag = p;
+   cpu->Zflag = !(p & P_Z);
+   cpu->Cflag = p & P_C;
+   cpu->Vflag = p & P_V;
+   cpu->Dflag = p & P_D;
+   cpu->Iflag = p & P_I;
+}
+
+
+/* interrupt --- answer the IRQ line, between instructions */
+
+void interrupt (cpu)
+struct Cpu *cpu;
+{
+   push (cpu, cpu->Pc >> 8);
+   push (cpu, BYTE(cpu->Pc));
+   push (cpu, pack_p (cpu));     /* Without B, unlike BRK */
+   cpu->Iflag = P_I;
+   cpu->Pc = MEM[IRQVEC] | (MEM[IRQVEC + 1] << 8);
+   cpu->Cycles += 7;
+}
+
+
+/* step_block --- run a block an instruction at a time, stopping once the
+ * cycle count reaches 'deadline', and counting each instruction and its
+ * cycles if profiling */
+
+const struct Insn *step_block (cpu, b, deadline)
+struct Cpu *cpu;
+const struct Block *b;
+const unsigned long deadline;
+{
+   struct Profile *const prof = cpu->Prof;
+   const struct Insn *ip;
+   unsigned long before;
+   int done;
+
+   for (ip = b->Insn; ; ip++) {
+      before = cpu->Cycles;
+      done = (*ip->Fn) (cpu, ip);
+
+      if (prof != NULL && ip - b->Insn < ip->Count && cpu->Stop != STOP_BRK && cpu->Stop != STOP_ILLEGAL) {
+         prof->Count[ip->Addr]++;
+         prof->Cycles[ip->Addr] += ip->Cyc + (cpu->Cycles - before);
+      }
+
+      if (done)
+         return (ip);
+
+      if (cpu->Cycles + ip->Sofar >= deadline) {
+         cpu->Pc = ip->Next;
+         return (ip);
+      }
+   }
+}
+
+
+/* build --- decode a block of code, starting at 'pc' */
+
+struct Block *build (cpu, pc)
+struct Cpu *cpu;
+const unsigned int pc;
+{
+   struct Cache *const c = cpu->Cache;
+   struct Block *b;
+   struct Insn *ip;
+   const struct Decode *d;
+   unsigned int addr, sofar, p0, p1;
+   int n;
+
+   if ((b = malloc (sizeof (struct Block))) == NULL)
+      return (NULL);
+
+   b->Start = pc;
+   addr = pc;
+   sofar = 0;
+   n = 0;
+
+   do {
+      d = &Decode[MEM[addr]];
+      ip = &b->Insn[n++];
+
+      if (d->Mode == RELATIVE)
+         ip->Arg = WORD(addr + 2 + (signed char)MEM[WORD(addr + 1)]);
+      else if (d->Len == 3)
+         ip->Arg = MEM[WORD(addr + 1)] | (MEM[WORD(addr + 2)] << 8);
+      else if (d->Len == 2)
+         ip->Arg = MEM[WORD(addr + 1)];
+      else
+         ip->Arg = 0;
+
+      if (cpu->Devices != NULL && reaches_io (cpu, d, ip->Arg))
+         ip->Fn = io_;
+      else
+         ip->Fn = Hand[MEM[addr]];
+
+      sofar += d->Cyc;
+      ip->Addr = addr;
+      ip->Next = WORD(addr + d->Len);
+      ip->Sofar = sofar;
+      ip->Count = n;
+      ip->Cyc = d->Cyc;
+      ip->Page = d->Page;
+
+      b->Last = WORD(addr + d->Len - 1);
+      addr = ip->Next;
+   } while (!ends_block (d->Op) && n < MAXRUN);
+
+   b->Most = sofar + n + 2;     /* A cycle for each page crossed, and two for a branch */
+
+   if (!ends_block (d->Op)) {    /* Carry on into the next block */
+      ip = &b->Insn[n];
+      ip->Fn = end_;
+      ip->Arg = 0;
+      ip->Addr = addr;
+      ip->Next = addr;
+      ip->Sofar = sofar;
+      ip->Count = n;
+      ip->Cyc = 0;
+      ip->Page = NO;
+   }
+
+   /* Mark the bytes as code and put the block on the lists for its pages */
+   for (addr = b->Start; ; addr = WORD(addr + 1)) {
+      c->Code[addr]++;
+      if (addr == b->Last)
+         break;
+   }
+
+   c->At[pc] = b;
+
+   p0 = b->Start >> 8;
+   p1 = b->Last >> 8;
+
+   b->Link[0] = c->Page[p0];
+   c->Page[p0] = b;
+
+   if (p1 != p0) {
+      b->Link[1] = c->Page[p1];
+      c->Page[p1] = b;
+   }
+   else
+      b->Link[1] = NULL;
+
+   return (b);
+}
+
+
+/* ends_block --- does this operation leave the block? */
+
+int ends_block (op)
+const int op;
+{
+   switch (op) {
+   case I_BCC:
+   case I_BCS:
+   case I_BEQ:
+   case I_BMI:
+   case I_BNE:
+   case I_BPL:
+   case I_BVC:
+   case I_BVS:
+   case I_JMP:
+   case I_JSR:
+   case I_RTS:
+   case I_RTI:
+   case I_BRK:
+   case I_ILL:
+      return (YES);
+   default:
+      return (NO);
+   }
+}
+
+
+/* invalidate --- drop every block that covers the byte at 'ea' */
+
+void invalidate (cpu, ea)
+struct Cpu *cpu;
+const unsigned int ea;
+{
+   struct Cache *const c = cpu->Cache;
+   const unsigned int page = ea >> 8;
+   struct Block **prev;
+   struct Block *b;
+   int k;
+
+   prev = &c->Page[page];
+
+   while ((b = *prev) != NULL) {
+      k = link_of (b, page);
+
+      if (WORD(ea - b->Start) <= WORD(b->Last - b->Start)) {
+         *prev = b->Link[k];
+
+         if ((b->Start >> 8) != (b->Last >> 8))   /* Also on the other page's list */
+            unlink_page (c, b, k ? b->Start >> 8 : b->Last >> 8);
+
+         drop (c, b);
+      }
+      else
+         prev = &b->Link[k];
+   }
+}
+
+
+/* unlink_page --- take a block off the list for one page */
+
+void unlink_page (c, b, page)
+struct Cache *c;
+struct Block *b;
+const unsigned int page;
+{
+   struct Block **prev;
+
+   for (prev = &c->Page[page]; *prev != NULL; prev = &(*prev)->Link[link_of (*prev, page)])
+      if (*prev == b) {
+         *prev = b->Link[link_of (b, page)];
+         return;
+      }
+}
+
+
+/* link_of --- which of a block's links is for this page */
+
+int link_of (b, page)
+const struct Block *b;
+const unsigned int page;
+{
+   return ((b->Start >> 8) == page ? 0 : 1);
+}
+
+
+/* drop --- forget a block, and free it once nothing can be running it */
+
+void drop (c, b)
+struct Cache *c;
+struct Block *b;
+{
+   unsigned int addr;
+
+   c->At[b->Start] = NULL;
+
+   for (addr = b->Start; ; addr = WORD(addr + 1)) {
+      c->Code[addr]--;
+      if (addr == b->Last)
+         break;
+   }
+
+   b->Dead = c->Dead;
+   c->Dead = b;
+}
+
+
+/* bury --- free the blocks that have been dropped */
+
+void bury (c)
+struct Cache *c;
+{
+   struct Block *b;
+
+   while ((b = c->Dead) != NULL) {
+      c->Dead = b->Dead;
+      free (b);
+   }
+}
@@ -0,0 +1,622 @@
+/* devices --- the memory map, and the devices in it        2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Each 256-byte page is either plain memory or belongs to a device.
+ * The map is kept as two tables of pages, one for reads and one for
+ * stores, and the decoder only sends an instruction through them if
+ * it might reach a device, so code that sticks to RAM runs as fast
+ * as it would with no devices at all.  The map is read from a file in
+ * the form of doc/mmap: the address of each page, and what's there.
+ */
+
+/* Modification:
+ * 2026-10-17 agent ACIA timed by its baud rate, with interrupts; baud-rate generator and timer
+ * 2026-10-18 agent Put out the byte an ACIA is still sending when the run stops
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+/* 6551 ACIA registers, and the bits of its status register */
+#define ACIA_DATA    0
+#define ACIA_STATUS  1
+#define ACIA_CMD     2
+#define ACIA_CTRL    3
+
+#define ACIA_OVRN    0x04        /* Overrun: a byte came in before the last was read */
+#define ACIA_RDRF    0x08        /* Receive data register full */
+#define ACIA_TDRE    0x10        /* Transmit data register empty */
+#define ACIA_IRQ     0x80        /* Holding the IRQ line down */
+
+#define ACIA_BITS    10          /* Start, eight data and stop */
+
+/* Timer registers, and the bits of its control and status */
+#define TIMER_LO     0           /* Period in cycles */
+#define TIMER_HI     1
+#define TIMER_CTRL   2
+#define TIMER_STATUS 3
+
+#define TIMER_RUN    0x01
+#define TIMER_IRQEN  0x80
+#define TIMER_DONE   0x80        /* Ran out; reading the status clears it */
+
+/* Cycles per bit for each rate of the 6551's own generator, at 1 MHz.
+ * Zero takes the clock from outside, which here is the baud-rate generator. */
+const unsigned int Bitcycles[16] = {
+   0, 20000, 13333, 9098, 7431, 6667, 3333, 1667,
+   833, 556, 417, 278, 208, 139, 104, 52
+};
+
+const char *Devname[NDEVKINDS] = {   /* Names for DEV_RAM, etc. */
+   "RAM", "ROM", "ACIA", "LED", "latch", "baud", "timer"
+};
+
+struct {                         /* Words in the map that name each kind of device */
+   const char *word;
+   int kind;
+} Devword[] = {
+   {"ACIA",     DEV_ACIA},
+   {"LED",      DEV_LED},
+   {"PSG",      DEV_LATCH},    /* Not modelled as yet */
+   {"CASSETTE", DEV_LATCH},
+   {"BAUD",     DEV_BAUD},
+   {"TIMER",    DEV_TIMER},
+   {"ROM",      DEV_ROM},
+   {"RAM",      DEV_RAM}
+};
+
+#ifdef __STDC__
+int map_kind (const char *text);
+int acia_read (struct Device *dev, unsigned int addr, unsigned long now);
+void acia_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+unsigned long acia_bit (const struct Device *dev);
+void acia_start (struct Device *dev, unsigned long now);
+void acia_rx (struct Device *dev, unsigned long when);
+void acia_sent (struct Device *dev, unsigned long when);
+void acia_irq (struct Device *dev);
+void baud_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+int timer_read (struct Device *dev, unsigned int addr, unsigned long now);
+void timer_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+void timer_fire (struct Device *dev, unsigned long when);
+int led_read (struct Device *dev, unsigned int addr, unsigned long now);
+void led_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+int latch_read (struct Device *dev, unsigned int addr, unsigned long now);
+void latch_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+void rom_write (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+#else
+#define const
+int map_kind ();
+int acia_read ();
+void acia_write ();
+unsigned long acia_bit ();
+void acia_start ();
+void acia_rx ();
+void acia_sent ();
+void acia_irq ();
+void baud_write ();
+int timer_read ();
+void timer_write ();
+void timer_fire ();
+int led_read ();
+void led_write ();
+int latch_read ();
+void latch_write ();
+void rom_write ();
+#endif   /* __STDC__ */
+
+
+/* sim_map --- set up the memory map from a file like doc/mmap, returning the number of bad lines */
+
+int sim_map (cpu, fp)
+struct Cpu *cpu;
+FILE *fp;
+{
+   char lin[BUFSIZ];
+   char *p, *q;
+   long addr;
+   int kind;
+   int bad;
+
+   bad = 0;
+
+   while (fgets (lin, sizeof (lin), fp) != NULL) {
+      for (p = lin; isspace (*p); p++)
+         ;
+
+      if (*p == EOS || *p == '#')      /* Blank line or comment */
+         continue;
+
+      addr = strtol (p, &q, 16);
+
+      if (q == p || (kind = map_kind (q)) == ERR)
+         bad++;
+      else if (sim_attach (cpu, addr, kind) == NULL && kind != DEV_RAM)
+         bad++;
+   }
+
+   return (bad);
+}
+
+
+/* map_kind --- the kind of device that a line of the map describes, or ERR */
+
+int map_kind (text)
+const char *text;
+{
+   char word[BUFSIZ];
+   const char *p;
+   int j;
+   size_t i;
+
+   for (p = text; isspace (*p); p++)
+      ;
+
+   if (*p == EOS)       /* Nothing there, so it's RAM */
+      return (DEV_RAM);
+
+   for ( ; *p != EOS; ) {
+      for (j = 0; isalnum (*p) && j < BUFSIZ - 1; p++)
+         word[j++] = toupper (*p);
+
+      word[j] = EOS;
+
+      for (i = 0; i < sizeof (Devword) / sizeof (Devword[0]); i++)
+         if (strcmp (word, Devword[i].word) == 0)
+            return (Devword[i].kind);
+
+      while (*p != EOS && !isalnum (*p))
+         p++;
+   }
+
+   return (ERR);
+}
+
+
+/* sim_attach --- put a device in the page at 'addr', or make it RAM again.
+ * Returns the device, or NULL for RAM, the zero page or the stack. */
+
+struct Device *sim_attach (cpu, addr, kind)
+struct Cpu *cpu;
+const long addr;
+const int kind;
+{
+   struct Device *dev;
+   const unsigned int page = WORD(addr) >> 8;
+
+   if (page < 2)        /* Zero page and stack are always RAM */
+      return (NULL);
+
+   sim_flush (cpu);     /* Blocks were decoded for the old map */
+
+   cpu->Rdev[page] = NULL;
+   cpu->Wdev[page] = NULL;
+
+   if (kind == DEV_RAM || kind < 0 || kind >= NDEVKINDS)
+      return (NULL);
+
+   if ((dev = calloc (1, sizeof (struct Device))) == NULL)
+      return (NULL);
+
+   dev->Kind = kind;
+   dev->Base = page << 8;
+   dev->Cpu = cpu;
+   dev->Rx = EOF;
+   dev->Tx = EOF;
+
+   switch (kind) {
+   case DEV_ROM:
+      dev->Read = NULL;
+      dev->Write = rom_write;
+      break;
+   case DEV_ACIA:
+      dev->Read = acia_read;
+      dev->Write = acia_write;
+      dev->Out = stdout;
+      break;
+   case DEV_LED:
+      dev->Read = led_read;
+      dev->Write = led_write;
+      break;
+   case DEV_LATCH:
+      dev->Read = latch_read;
+      dev->Write = latch_write;
+      break;
+   case DEV_BAUD:
+      dev->Read = latch_read;
+      dev->Write = baud_write;
+      break;
+   case DEV_TIMER:
+      dev->Read = timer_read;
+      dev->Write = timer_write;
+      break;
+   }
+
+   cpu->Rdev[page] = (dev->Read != NULL) ? dev : NULL;
+   cpu->Wdev[page] = dev;
+
+   dev->Next = cpu->Devices;
+   cpu->Devices = dev;
+
+   return (dev);
+}
+
+
+/* free_devices --- throw away the devices of a 6502 */
+
+void free_devices (cpu)
+struct Cpu *cpu;
+{
+   struct Device *dev, *next;
+
+   sim_drain (cpu);     /* Don't lose what was being sent */
+
+   for (dev = cpu->Devices; dev != NULL; dev = next) {
+      next = dev->Next;
+      free (dev);
+   }
+
+   cpu->Devices = NULL;
+   memset (cpu->Rdev, 0, sizeof (cpu->Rdev));
+   memset (cpu->Wdev, 0, sizeof (cpu->Wdev));
+
+   cpu->Nevents = 0;
+   cpu->Irqs = 0;
+}
+
+
+/* reset_devices --- the RESET line: stop what the devices were doing */
+
+void reset_devices (cpu)
+struct Cpu *cpu;
+{
+   struct Device *dev;
+
+   for (dev = cpu->Devices; dev != NULL; dev = dev->Next) {
+      dev->Irq = NO;
+
+      switch (dev->Kind) {
+      case DEV_ACIA:
+         dev->Reg[ACIA_STATUS] = 0;
+         dev->Reg[ACIA_CMD] = 0;
+         dev->Reg[ACIA_CTRL] = 0;
+         if (dev->Tx != EOF && !dev->Txout && dev->Out != NULL)   /* Don't lose what was sent */
+            putc (dev->Tx, dev->Out);
+         dev->Tx = EOF;
+         dev->Rxon = NO;
+         break;
+      case DEV_TIMER:
+         dev->Reg[TIMER_CTRL] = 0;
+         dev->Reg[TIMER_STATUS] = 0;
+         break;
+      }
+   }
+
+   cpu->Nevents = 0;
+   cpu->Irqs = 0;
+}
+
+
+/* acia_read --- read a register of the ACIA, receiving from 'In'.  With
+ * no baud rate, a byte is there as soon as the program looks for one. */
+
+int acia_read (dev, addr, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned long now;
+{
+   int byte;
+
+   if (dev->Rx == EOF && dev->In != NULL && !dev->Rxon)
+      dev->Rx = getc (dev->In);
+
+   switch (addr & 3) {
+   case ACIA_DATA:
+      byte = (dev->Rx == EOF) ? dev->Reg[ACIA_DATA] : dev->Rx;
+      dev->Reg[ACIA_DATA] = byte;
+      dev->Reg[ACIA_STATUS] &= ~ACIA_OVRN;
+      dev->Rx = EOF;
+      acia_irq (dev);
+      return (byte);
+   case ACIA_STATUS:
+      return ((dev->Tx == EOF ? ACIA_TDRE : 0) | (dev->Rx == EOF ? 0 : ACIA_RDRF) |
+              (dev->Reg[ACIA_STATUS] & ACIA_OVRN) | (dev->Irq ? ACIA_IRQ : 0));
+   default:
+      return (dev->Reg[addr & 3]);
+   }
+}
+
+
+/* acia_write --- write a register of the ACIA, sending to 'Out' */
+
+void acia_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+   unsigned long bit;
+
+   switch (addr & 3) {
+   case ACIA_DATA:
+      if ((bit = acia_bit (dev)) == 0) {
+         if (dev->Out != NULL)
+            putc (byte, dev->Out);
+      }
+      else if (dev->Tx != EOF) {    /* Too soon, and the last byte is lost */
+         dev->Tx = byte;
+         dev->Txout = NO;
+      }
+      else if (sim_schedule (dev->Cpu, now + ACIA_BITS * bit, acia_sent, dev) != ERR) {
+         dev->Tx = byte;
+         dev->Txout = NO;
+      }
+      break;
+   case ACIA_STATUS:    /* Programmed reset */
+      dev->Reg[ACIA_CMD] &= 0xe0;
+      dev->Reg[ACIA_STATUS] &= ~ACIA_OVRN;
+      break;
+   default:
+      dev->Reg[addr & 3] = byte;
+      acia_start (dev, now);
+      break;
+   }
+
+   acia_irq (dev);
+}
+
+
+/* acia_bit --- cycles for each bit at the ACIA's baud rate, or zero for no timing */
+
+unsigned long acia_bit (dev)
+const struct Device *dev;
+{
+   const struct Device *brg;
+
+   if (Bitcycles[dev->Reg[ACIA_CTRL] & 0x0f] != 0)
+      return (Bitcycles[dev->Reg[ACIA_CTRL] & 0x0f]);
+
+   for (brg = dev->Cpu->Devices; brg != NULL; brg = brg->Next)
+      if (brg->Kind == DEV_BAUD)
+         return (brg->Reg[0] | (brg->Reg[1] << 8));
+
+   return (0);
+}
+
+
+/* acia_start --- once there is a baud rate, receive a byte every ten bits */
+
+void acia_start (dev, now)
+struct Device *dev;
+const unsigned long now;
+{
+   const unsigned long bit = acia_bit (dev);
+
+   if (dev->Rxon || bit == 0 || dev->In == NULL)
+      return;
+
+   if (sim_schedule (dev->Cpu, now + ACIA_BITS * bit, acia_rx, dev) != ERR)
+      dev->Rxon = YES;
+}
+
+
+/* acia_rx --- event: a byte has come in from 'In' */
+
+void acia_rx (dev, when)
+struct Device *dev;
+const unsigned long when;
+{
+   const unsigned long bit = acia_bit (dev);
+   int byte;
+
+   if (bit == 0 || (byte = getc (dev->In)) == EOF) {
+      dev->Rxon = NO;      /* Back to no timing, or nothing more to come */
+      return;
+   }
+
+   if (dev->Rx != EOF)
+      dev->Reg[ACIA_STATUS] |= ACIA_OVRN;
+   else
+      dev->Rx = byte;
+
+   acia_irq (dev);
+
+   if (sim_schedule (dev->Cpu, when + ACIA_BITS * bit, acia_rx, dev) == ERR)
+      dev->Rxon = NO;
+}
+
+
+/* acia_sent --- event: the byte being sent has gone */
+
+void acia_sent (dev, when)
+struct Device *dev;
+const unsigned long when;
+{
+   if (dev->Out != NULL && !dev->Txout)
+      putc (dev->Tx, dev->Out);
+
+   dev->Tx = EOF;
+   acia_irq (dev);
+}
+
+
+/* sim_drain --- put out at once the bytes the ACIAs are still sending */
+
+void sim_drain (cpu)
+struct Cpu *cpu;
+{
+   struct Device *dev;
+
+   /* The 6502 goes on seeing the transmitter busy until acia_sent() */
+   for (dev = cpu->Devices; dev != NULL; dev = dev->Next)
+      if (dev->Kind == DEV_ACIA && dev->Tx != EOF && !dev->Txout) {
+         if (dev->Out != NULL)
+            putc (dev->Tx, dev->Out);
+
+         dev->Txout = YES;
+      }
+}
+
+
+/* acia_irq --- hold the IRQ line down for a byte in, or room for one out,
+ * if the command register allows it */
+
+void acia_irq (dev)
+struct Device *dev;
+{
+   const unsigned int cmd = dev->Reg[ACIA_CMD];
+
+   sim_irq (dev, ((cmd & 0x03) == 0x01 && dev->Rx != EOF) ||
+                 ((cmd & 0x0c) == 0x04 && dev->Tx == EOF));
+}
+
+
+/* baud_write --- set the baud-rate generator, in cycles for each bit */
+
+void baud_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+   struct Device *acia;
+
+   dev->Reg[addr & 3] = byte;
+
+   for (acia = dev->Cpu->Devices; acia != NULL; acia = acia->Next)
+      if (acia->Kind == DEV_ACIA)
+         acia_start (acia, now);
+}
+
+
+/* timer_read --- read a register of the timer; reading the status clears it */
+
+int timer_read (dev, addr, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned long now;
+{
+   int byte;
+
+   byte = dev->Reg[addr & 3];
+
+   if ((addr & 3) == TIMER_STATUS) {
+      dev->Reg[TIMER_STATUS] = 0;
+      sim_irq (dev, NO);
+   }
+
+   return (byte);
+}
+
+
+/* timer_write --- set the period of the timer, or start or stop it */
+
+void timer_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+   unsigned long period;
+
+   switch (addr & 3) {
+   case TIMER_CTRL:
+      dev->Reg[TIMER_CTRL] = byte;
+      sim_cancel (dev->Cpu, dev);
+
+      period = dev->Reg[TIMER_LO] | (dev->Reg[TIMER_HI] << 8);
+      if ((byte & TIMER_RUN) && period != 0)
+         sim_schedule (dev->Cpu, now + period, timer_fire, dev);
+      break;
+   case TIMER_STATUS:
+      dev->Reg[TIMER_STATUS] = 0;
+      break;
+   default:             /* The period, for the next time it starts */
+      dev->Reg[addr & 3] = byte;
+      break;
+   }
+
+   sim_irq (dev, (dev->Reg[TIMER_STATUS] & TIMER_DONE) && (dev->Reg[TIMER_CTRL] & TIMER_IRQEN));
+}
+
+
+/* timer_fire --- event: the timer has run out, and starts again */
+
+void timer_fire (dev, when)
+struct Device *dev;
+const unsigned long when;
+{
+   const unsigned long period = dev->Reg[TIMER_LO] | (dev->Reg[TIMER_HI] << 8);
+
+   dev->Reg[TIMER_STATUS] |= TIMER_DONE;
+
+   if (dev->Reg[TIMER_CTRL] & TIMER_IRQEN)
+      sim_irq (dev, YES);
+
+   if (period != 0)     /* From when it was due, so it doesn't drift */
+      sim_schedule (dev->Cpu, when + period, timer_fire, dev);
+}
+
+
+/* led_read --- read back the LEDs */
+
+int led_read (dev, addr, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned long now;
+{
+   return (dev->Reg[0]);
+}
+
+
+/* led_write --- set the LEDs, tracing any change to 'Out' */
+
+void led_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+   if (dev->Out != NULL && byte != dev->Reg[0])
+      fprintf (dev->Out, "%lu: LED %04X %02X\n", now, dev->Base, byte);
+
+   dev->Reg[0] = byte;
+}
+
+
+/* latch_read --- a device that isn't modelled reads back what was stored */
+
+int latch_read (dev, addr, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned long now;
+{
+   return (dev->Reg[addr & 3]);
+}
+
+
+/* latch_write --- and keeps what is stored in it */
+
+void latch_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+   dev->Reg[addr & 3] = byte;
+}
+
+
+/* rom_write --- stores to ROM do nothing */
+
+void rom_write (dev, addr, byte, now)
+struct Device *dev;
+const unsigned int addr;
+const unsigned int byte;
+const unsigned long now;
+{
+}
@@ -0,0 +1,139 @@
+/* events --- things that devices have to do at a given cycle  2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* A device that has something to do later, such as an ACIA finishing
+ * a byte or a timer running out, puts an event on a heap kept in order
+ * of cycle count.  The simulator runs instructions in batches up to the
+ * soonest of them, without looking at the devices in between, and then
+ * fires whatever is due and takes an interrupt if one is waiting.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#ifdef __STDC__
+void sift_down (struct Event *ev, int n, int i);
+#else
+#define const
+void sift_down ();
+#endif   /* __STDC__ */
+
+
+/* sim_schedule --- have 'fire' called for 'dev' once the cycle count reaches 'when' */
+
+int sim_schedule (cpu, when, fire, dev)
+struct Cpu *cpu;
+const unsigned long when;
+Firer fire;
+struct Device *dev;
+{
+   struct Event *ev;
+   int i, up, n;
+
+   if (cpu->Nevents == cpu->Maxevents) {
+      n = (cpu->Maxevents == 0) ? 8 : cpu->Maxevents * 2;
+
+      if ((ev = realloc (cpu->Events, n * sizeof (struct Event))) == NULL)
+         return (ERR);
+
+      cpu->Events = ev;
+      cpu->Maxevents = n;
+   }
+
+   ev = cpu->Events;
+
+   for (i = cpu->Nevents++; i > 0 && ev[up = (i - 1) / 2].When > when; i = up)
+      ev[i] = ev[up];
+
+   ev[i].When = when;
+   ev[i].Fire = fire;
+   ev[i].Dev = dev;
+
+   return (OK);
+}
+
+
+/* sim_cancel --- forget the events of a device */
+
+void sim_cancel (cpu, dev)
+struct Cpu *cpu;
+const struct Device *dev;
+{
+   struct Event *const ev = cpu->Events;
+   int i, n;
+
+   for (i = n = 0; i < cpu->Nevents; i++)
+      if (ev[i].Dev != dev)
+         ev[n++] = ev[i];
+
+   if (n == cpu->Nevents)
+      return;
+
+   cpu->Nevents = n;
+
+   for (i = n / 2 - 1; i >= 0; i--)    /* Back into a heap */
+      sift_down (ev, n, i);
+}
+
+
+/* sim_irq --- a device raises or lets go of the IRQ line */
+
+void sim_irq (dev, on)
+struct Device *dev;
+const int on;
+{
+   if (dev->Irq == (on != 0))
+      return;
+
+   dev->Irq = (on != 0);
+   dev->Cpu->Irqs += on ? 1 : -1;
+}
+
+
+/* fire_events --- fire every event that is due by now, soonest first */
+
+void fire_events (cpu)
+struct Cpu *cpu;
+{
+   struct Event *ev;
+   struct Event due;
+
+   while (cpu->Nevents > 0 && cpu->Events[0].When <= cpu->Cycles) {
+      ev = cpu->Events;
+      due = ev[0];
+      ev[0] = ev[--cpu->Nevents];
+      sift_down (ev, cpu->Nevents, 0);
+
+      (*due.Fire) (due.Dev, due.When);    /* May schedule another */
+   }
+}
+
+
+/* sift_down --- move the event at 'i' down the heap to where it belongs */
+
+void sift_down (ev, n, i)
+struct Event *ev;
+const int n;
+int i;
+{
+   struct Event e;
+   int kid;
+
+   e = ev[i];
+
+   while ((kid = 2 * i + 1) < n) {
+      if (kid + 1 < n && ev[kid + 1].When < ev[kid].When)
+         kid++;
+
+      if (ev[kid].When >= e.When)
+         break;
+
+      ev[i] = ev[kid];
+      i = kid;
+   }
+
+   ev[i] = e;
+}
@@ -0,0 +1,912 @@
+/* lanes --- run many 6502s side by side, in lockstep       2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Each lane is a whole 6502 with its own 64K, but the registers of
+ * all the lanes are kept together, one array for each register, and
+ * the memory is interleaved, so that the same address in a chunk of
+ * LANEWIDTH lanes is one row of bytes.  Lanes that are at the same
+ * address, with the same instruction there, form a group that runs
+ * as one: the instruction is decoded once and then done as a loop
+ * across the group.  The group runs on until its lanes branch
+ * different ways, one stops (at BRK, an illegal op-code, a loop or
+ * the cycle limit), or it catches up with a lane that is waiting;
+ * then the waiting lanes with the lowest address go next, which lets
+ * lanes that split at a branch join up again after it.  A lane with
+ * nobody to keep step with is simply a group of one.
+ */
+
+/* Modification:
+ * 2026-10-17 agent STORES() moved to sim6502.h, for the memory map too
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#define UNKNOWN      2           /* Not YES or NO, in Same[] */
+
+#define AT(i, addr)  (mem[(long)(addr) * LANEWIDTH + (i)])   /* Byte 'addr' of lane 'i' of a chunk */
+#define CHUNK(i)     (l->Mem + (long)((i) / LANEWIDTH) * LANEWIDTH * MEMSIZE)
+
+/* Branch each lane, or not, without a jump that depends on the lane */
+#define BRANCHES(cond) \
+   e = ea[0]; \
+   r = CROSSES(next, e) ? 2 : 1; \
+   for (k = 0; k < n; k++) { \
+      i = lane[k]; \
+      t = (cond); \
+      pc[i] = t ? e : next; \
+      cycles[i] += t ? r : 0; \
+   } \
+   if (e == at) \
+      for (k = 0; k < n; k++) \
+         if (pc[lane[k]] == at) \
+            stop[lane[k]] = STOP_LOOP; \
+   return (together (l, base))
+
+#ifdef __STDC__
+void run_chunk (struct Lanes *l, int base, int n);
+int gather (struct Lanes *l, int base, int n);
+void run_group (struct Lanes *l, int base, int ng);
+int same_code (struct Lanes *l, int base, unsigned int at, int len);
+long run_op (struct Lanes *l, int base, const struct Decode *d, unsigned int at);
+long together (const struct Lanes *l, int base);
+#else
+#define const
+void run_chunk ();
+int gather ();
+void run_group ();
+int same_code ();
+long run_op ();
+long together ();
+#endif   /* __STDC__ */
+
+
+/* lanes_new --- make 'n' lanes, each a 6502 with its memory filled with zeros */
+
+struct Lanes *lanes_new (n)
+const int n;
+{
+   struct Lanes *l;
+
+   sim_init ();
+
+   if ((l = calloc (1, sizeof (struct Lanes))) == NULL)
+      return (NULL);
+
+   l->N = n;
+   l->Brkhalt = YES;
+   l->Mem = calloc ((n + LANEWIDTH - 1) / LANEWIDTH, LANEWIDTH * MEMSIZE);
+   l->Pc = calloc (n, sizeof (unsigned int));
+   l->A = calloc (n, 1);
+   l->X = calloc (n, 1);
+   l->Y = calloc (n, 1);
+   l->S = calloc (n, 1);
+   l->Nflag = calloc (n, 1);
+   l->Zflag = calloc (n, 1);
+   l->Cflag = calloc (n, 1);
+   l->Vflag = calloc (n, 1);
+   l->Dflag = calloc (n, 1);
+   l->Iflag = calloc (n, 1);
+   l->Cycles = calloc (n, sizeof (unsigned long));
+   l->Insns = calloc (n, sizeof (unsigned long));
+   l->Limit = calloc (n, sizeof (unsigned long));
+   l->Stop = calloc (n, 1);
+   l->Used = calloc (n, 1);
+   l->Wait = malloc (MEMSIZE);
+   l->Same = malloc (MEMSIZE);
+
+   if (l->Mem == NULL || l->Pc == NULL || l->A == NULL || l->X == NULL ||
+       l->Y == NULL || l->S == NULL || l->Nflag == NULL || l->Zflag == NULL ||
+       l->Cflag == NULL || l->Vflag == NULL || l->Dflag == NULL || l->Iflag == NULL ||
+       l->Cycles == NULL || l->Insns == NULL || l->Limit == NULL || l->Stop == NULL ||
+       l->Used == NULL || l->Wait == NULL || l->Same == NULL) {
+      lanes_free (l);
+      return (NULL);
+   }
+
+   return (l);
+}
+
+
+/* lanes_free --- throw the lanes away */
+
+void lanes_free (l)
+struct Lanes *l;
+{
+   free (l->Mem);
+   free (l->Pc);
+   free (l->A);
+   free (l->X);
+   free (l->Y);
+   free (l->S);
+   free (l->Nflag);
+   free (l->Zflag);
+   free (l->Cflag);
+   free (l->Vflag);
+   free (l->Dflag);
+   free (l->Iflag);
+   free (l->Cycles);
+   free (l->Insns);
+   free (l->Limit);
+   free (l->Stop);
+   free (l->Used);
+   free (l->Wait);
+   free (l->Same);
+   free (l);
+}
+
+
+/* lanes_put --- copy a 6502, memory and all, into lane 'i' */
+
+void lanes_put (l, i, cpu)
+struct Lanes *l;
+const int i;
+const struct Cpu *cpu;
+{
+   unsigned char *const mem = CHUNK(i);
+   const int k = i % LANEWIDTH;
+   const unsigned int p = cpu->P;
+   long addr;
+
+   /* Memory is scattered a byte to a row, so leave the zeros in a new lane alone */
+   for (addr = 0L; addr < MEMSIZE; addr++)
+      if (l->Used[i] || cpu->Mem[addr] != 0)
+         AT(k, addr) = cpu->Mem[addr];
+
+   l->Used[i] = YES;
+   l->Pc[i] = cpu->Pc;
+   l->A[i] = cpu->A;
+   l->X[i] = cpu->X;
+   l->Y[i] = cpu->Y;
+   l->S[i] = cpu->S;
+   l->Nflag[i] = p & P_N;
+   l->Zflag[i] = !(p & P_Z);
+   l->Cflag[i] = p & P_C;
+   l->Vflag[i] = p & P_V;
+   l->Dflag[i] = p & P_D;
+   l->Iflag[i] = p & P_I;
+   l->Cycles[i] = cpu->Cycles;
+   l->Insns[i] = cpu->Insns;
+   l->Stop[i] = cpu->Stop;
+}
+
+
+/* lanes_get --- copy the registers of lane 'i' back out into a 6502, but not its memory */
+
+void lanes_get (l, i, cpu)
+const struct Lanes *l;
+const int i;
+struct Cpu *cpu;
+{
+   cpu->Pc = l->Pc[i];
+   cpu->A = l->A[i];
+   cpu->X = l->X[i];
+   cpu->Y = l->Y[i];
+   cpu->S = l->S[i];
+   cpu->P = (l->Nflag[i] & P_N) | (l->Vflag[i] ? P_V : 0) | P_U | l->Dflag[i] |
+            l->Iflag[i] | (l->Zflag[i] ? 0 : P_Z) | (l->Cflag[i] ? P_C : 0);
+   cpu->Cycles = l->Cycles[i];
+   cpu->Insns = l->Insns[i];
+   cpu->Stop = l->Stop[i];
+}
+
+
+/* lanes_peek --- a byte of the memory of lane 'i' */
+
+int lanes_peek (l, i, addr)
+const struct Lanes *l;
+const int i;
+const long addr;
+{
+   const unsigned char *const mem = CHUNK(i);
+
+   return (AT(i % LANEWIDTH, WORD(addr)));
+}
+
+
+/* lanes_run --- run all the lanes until each one stops, or for about
+ * 'maxcycles' cycles each.  Returns the number that hit the limit. */
+
+int lanes_run (l, maxcycles)
+struct Lanes *l;
+const unsigned long maxcycles;
+{
+   int i, n;
+
+   for (i = 0; i < l->N; i++) {
+      l->Stop[i] = STOP_NONE;
+      l->Limit[i] = l->Cycles[i] + maxcycles;
+   }
+
+   for (i = 0; i < l->N; i += LANEWIDTH)
+      run_chunk (l, i, (l->N - i < LANEWIDTH) ? l->N - i : LANEWIDTH);
+
+   for (i = n = 0; i < l->N; i++)
+      if (l->Stop[i] == STOP_LIMIT)
+         n++;
+
+   return (n);
+}
+
+
+/* run_chunk --- run the lanes of one chunk until all of them have stopped */
+
+void run_chunk (l, base, n)
+struct Lanes *l;
+const int base;
+const int n;
+{
+   const unsigned int *const pc = l->Pc + base;
+   int k;
+
+   memset (l->Wait, 0, MEMSIZE);
+   memset (l->Same, UNKNOWN, MEMSIZE);
+   l->Nchunk = n;
+
+   for (k = 0; k < n; k++)
+      l->Wait[pc[k]]++;
+
+   while (gather (l, base, n) > 0) {
+      run_group (l, base, l->Ngroup);
+
+      for (k = 0; k < l->Ngroup; k++)
+         if (l->Stop[base + l->Group[k]] == STOP_NONE)
+            l->Wait[pc[l->Group[k]]]++;
+   }
+}
+
+
+/* gather --- make a group of the waiting lanes with the lowest address
+ * and the same instruction there.  Returns how many lanes are waiting. */
+
+int gather (l, base, n)
+struct Lanes *l;
+const int base;
+const int n;
+{
+   const unsigned char *const mem = CHUNK(base);
+   const unsigned int *const pc = l->Pc + base;
+   const unsigned char *const stop = l->Stop + base;
+   int lead, len, waiting;
+   unsigned int at;
+   int j, k;
+
+   lead = -1;
+   for (k = waiting = 0; k < n; k++) {
+      if (stop[k] == STOP_NONE) {
+         waiting++;
+         if (lead < 0 || pc[k] < pc[lead])
+            lead = k;
+      }
+   }
+
+   l->Ngroup = 0;
+   if (lead < 0)
+      return (0);
+
+   at = pc[lead];
+   len = Decode[AT(lead, at)].Len;
+
+   for (k = lead; k < n; k++) {
+      if (stop[k] != STOP_NONE || pc[k] != at)
+         continue;
+
+      for (j = 0; j < len; j++)
+         if (AT(k, WORD(at + j)) != AT(lead, WORD(at + j)))
+            break;
+
+      if (j == len) {
+         l->Group[l->Ngroup++] = k;
+         l->Wait[at]--;
+      }
+   }
+
+   return (waiting);
+}
+
+
+/* run_group --- run the group until its lanes part company, one of them
+ * stops, or it reaches an address where another lane is waiting.
+ * While they keep together the lanes share one PC, and the cycles
+ * that every instruction takes are only added up for the group. */
+
+void run_group (l, base, ng)
+struct Lanes *l;
+const int base;
+const int ng;
+{
+   const unsigned char *const mem = CHUNK(base);
+   unsigned int *const pc = l->Pc + base;
+   unsigned long *const cycles = l->Cycles + base;
+   unsigned long *const insns = l->Insns + base;
+   const unsigned long *const limit = l->Limit + base;
+   unsigned char *const stop = l->Stop + base;
+   const int *const group = l->Group;
+   const struct Decode *d;
+   unsigned long sofar, steps, room, left;
+   long at;
+   int apart;
+   int i, k;
+
+   at = pc[group[0]];
+   sofar = steps = 0L;
+   apart = NO;
+
+   /* Cycles that every lane can run before any might reach its limit */
+   for (k = 0, room = ~0UL; k < ng; k++) {
+      i = group[k];
+      left = (cycles[i] < limit[i]) ? limit[i] - cycles[i] : 0L;
+      if (left < room)
+         room = left;
+   }
+
+   for (;;) {
+      d = &Decode[AT(group[0], at)];
+
+      if (ng > 1 && !same_code (l, base, at, d->Len))
+         break;
+
+      /* Indexing and branches can cost a lane two cycles more than the others */
+      if (sofar + 2 * steps >= room) {
+         for (k = 0; k < ng; k++) {
+            i = group[k];
+            if (cycles[i] + sofar >= limit[i]) {
+               stop[i] = STOP_LIMIT;
+               apart = YES;
+            }
+         }
+
+         if (apart) {
+            apart = NO;
+            break;
+         }
+      }
+
+      sofar += d->Cyc;
+      steps++;
+
+      if ((at = run_op (l, base, d, at)) == ERR) {
+         apart = YES;      /* Each lane's PC is up to date */
+         break;
+      }
+
+      if (l->Wait[at] != 0)
+         break;
+   }
+
+   for (k = 0; k < ng; k++) {
+      i = group[k];
+      cycles[i] += sofar;
+      insns[i] += steps;
+      if (!apart)
+         pc[i] = at;
+   }
+
+   l->Steps += steps;
+}
+
+
+/* same_code --- do all the lanes of the group have the same instruction at 'at'? */
+
+int same_code (l, base, at, len)
+struct Lanes *l;
+const int base;
+const unsigned int at;
+const int len;
+{
+   const unsigned char *const mem = CHUNK(base);
+   const unsigned char *row;
+   const int *const group = l->Group;
+   const int ng = l->Ngroup;
+   unsigned int addr, diff;
+   int j, k;
+
+   for (j = 0, diff = 0; j < len; j++) {
+      addr = WORD(at + j);
+      row = &AT(0, addr);
+
+      /* Whether a byte is the same in every lane is kept until something
+       * is stored there; not on the stack, which changes all the time */
+      if ((addr & 0xff00) != STACKPAGE) {
+         if (l->Same[addr] == UNKNOWN) {
+            for (k = 0, l->Same[addr] = YES; k < l->Nchunk; k++)
+               if (row[k] != row[0])
+                  l->Same[addr] = NO;
+         }
+
+         if (l->Same[addr] == YES)
+            continue;
+      }
+
+      if (group[ng - 1] - group[0] == ng - 1) {    /* Lanes next to each other */
+         for (k = group[0]; k < group[0] + ng; k++)
+            diff |= row[k] ^ row[group[0]];
+      }
+      else {
+         for (k = 1; k < ng; k++)
+            diff |= row[group[k]] ^ row[group[0]];
+      }
+   }
+
+   return (diff == 0);
+}
+
+
+/* run_op --- run one instruction at 'at' in each lane of the group.  Returns
+ * the address of the next one, or ERR if the lanes now have different PCs
+ * or some have stopped, when each lane's PC has been set. */
+
+long run_op (l, base, d, at)
+struct Lanes *l;
+const int base;
+const struct Decode *d;
+const unsigned int at;
+{
+   unsigned char *const mem = CHUNK(base);
+   unsigned int *const pc = l->Pc + base;
+   unsigned char *const a = l->A + base;
+   unsigned char *const x = l->X + base;
+   unsigned char *const y = l->Y + base;
+   unsigned char *const s = l->S + base;
+   unsigned char *const nf = l->Nflag + base;
+   unsigned char *const zf = l->Zflag + base;
+   unsigned char *const cf = l->Cflag + base;
+   unsigned char *const vf = l->Vflag + base;
+   unsigned char *const df = l->Dflag + base;
+   unsigned char *const irq = l->Iflag + base;
+   unsigned long *const cycles = l->Cycles + base;
+   unsigned long *const insns = l->Insns + base;
+   unsigned char *const stop = l->Stop + base;
+   const int *const lane = l->Group;
+   const int n = l->Ngroup;
+   unsigned int *const ea = l->Ea;
+   const unsigned int next = WORD(at + d->Len);
+   const unsigned int lo = AT(lane[0], WORD(at + 1));    /* Operand bytes, the same in every lane */
+   const unsigned int hi = AT(lane[0], WORD(at + 2));
+   unsigned char *q;
+   unsigned int e, p, t, r;
+   struct Cpu alu;
+   int i, k;
+
+   /* Work out the effective address in each lane; immediate operands are at pc + 1 */
+   switch (d->Mode) {
+   case IMMEDIATE:
+   case ABSOLUTE:
+   case Z_PAGE:
+   case RELATIVE:
+      if (d->Mode == IMMEDIATE)
+         e = WORD(at + 1);
+      else if (d->Mode == ABSOLUTE)
+         e = lo | (hi << 8);
+      else if (d->Mode == Z_PAGE)
+         e = lo;
+      else
+         e = WORD(at + 2 + (signed char)lo);
+
+      for (k = 0; k < n; k++)
+         ea[k] = e;
+      break;
+   case INDEX_X:
+   case INDEX_Y:
+      t = lo | (hi << 8);
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         ea[k] = WORD(t + (d->Mode == INDEX_X ? x[i] : y[i]));
+         cycles[i] += d->Page & (CROSSES(t, ea[k]) != 0);
+      }
+      break;
+   case Z_INDEX_X:
+      for (k = 0; k < n; k++)
+         ea[k] = BYTE(lo + x[lane[k]]);
+      break;
+   case Z_INDEX_Y:
+      for (k = 0; k < n; k++)
+         ea[k] = BYTE(lo + y[lane[k]]);
+      break;
+   case INDIRECT_X:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         t = BYTE(lo + x[i]);
+         ea[k] = AT(i, t) | (AT(i, BYTE(t + 1)) << 8);
+      }
+      break;
+   case INDIRECT_Y:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         t = AT(i, lo) | (AT(i, BYTE(lo + 1)) << 8);
+         ea[k] = WORD(t + y[i]);
+         cycles[i] += d->Page & (CROSSES(t, ea[k]) != 0);
+      }
+      break;
+   case INDIRECT:    /* JMP (ind): the NMOS 6502 doesn't carry into the high byte */
+      t = lo | (hi << 8);
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         ea[k] = AT(i, t) | (AT(i, (t & 0xff00) | BYTE(t + 1)) << 8);
+      }
+      break;
+   }
+
+   /* The lanes may no longer agree about what's there */
+   if (STORES(d->Op) && d->Mode != INHERENT)
+      for (k = 0; k < n; k++)
+         l->Same[ea[k]] = UNKNOWN;
+
+   switch (d->Op) {
+   case I_ADC:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         alu.A = a[i];
+         alu.Cflag = cf[i];
+         alu.Dflag = df[i];
+         adc (&alu, AT(i, ea[k]));
+         a[i] = alu.A;
+         nf[i] = alu.Nflag;
+         zf[i] = alu.Zflag;
+         cf[i] = alu.Cflag;
+         vf[i] = alu.Vflag;
+      }
+      break;
+   case I_SBC:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         alu.A = a[i];
+         alu.Cflag = cf[i];
+         alu.Dflag = df[i];
+         sbc (&alu, AT(i, ea[k]));
+         a[i] = alu.A;
+         nf[i] = alu.Nflag;
+         zf[i] = alu.Zflag;
+         cf[i] = alu.Cflag;
+         vf[i] = alu.Vflag;
+      }
+      break;
+   case I_AND:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = a[i] & AT(i, ea[k]);
+      }
+      break;
+   case I_ORA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = a[i] | AT(i, ea[k]);
+      }
+      break;
+   case I_EOR:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = a[i] ^ AT(i, ea[k]);
+      }
+      break;
+   case I_ASL:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         q = (d->Mode == INHERENT) ? &a[i] : &AT(i, ea[k]);
+         t = *q;
+         cf[i] = t >> 7;
+         *q = nf[i] = zf[i] = BYTE(t << 1);
+      }
+      break;
+   case I_LSR:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         q = (d->Mode == INHERENT) ? &a[i] : &AT(i, ea[k]);
+         t = *q;
+         cf[i] = t & 1;
+         *q = nf[i] = zf[i] = t >> 1;
+      }
+      break;
+   case I_ROL:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         q = (d->Mode == INHERENT) ? &a[i] : &AT(i, ea[k]);
+         t = *q;
+         r = (t << 1) | cf[i];
+         cf[i] = t >> 7;
+         *q = nf[i] = zf[i] = BYTE(r);
+      }
+      break;
+   case I_ROR:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         q = (d->Mode == INHERENT) ? &a[i] : &AT(i, ea[k]);
+         t = *q;
+         r = (t >> 1) | (cf[i] << 7);
+         cf[i] = t & 1;
+         *q = nf[i] = zf[i] = BYTE(r);
+      }
+      break;
+   case I_INC:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, ea[k]) = nf[i] = zf[i] = BYTE(AT(i, ea[k]) + 1);
+      }
+      break;
+   case I_DEC:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, ea[k]) = nf[i] = zf[i] = BYTE(AT(i, ea[k]) - 1);
+      }
+      break;
+   case I_INX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         x[i] = nf[i] = zf[i] = BYTE(x[i] + 1);
+      }
+      break;
+   case I_INY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         y[i] = nf[i] = zf[i] = BYTE(y[i] + 1);
+      }
+      break;
+   case I_DEX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         x[i] = nf[i] = zf[i] = BYTE(x[i] - 1);
+      }
+      break;
+   case I_DEY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         y[i] = nf[i] = zf[i] = BYTE(y[i] - 1);
+      }
+      break;
+   case I_BIT:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         t = AT(i, ea[k]);
+         nf[i] = t;
+         vf[i] = t & P_V;
+         zf[i] = a[i] & t;
+      }
+      break;
+   case I_CMP:
+   case I_CPX:
+   case I_CPY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         t = (d->Op == I_CMP) ? a[i] : (d->Op == I_CPX) ? x[i] : y[i];
+         r = t - AT(i, ea[k]);
+         cf[i] = !(r & 0x100);
+         nf[i] = zf[i] = BYTE(r);
+      }
+      break;
+   case I_LDA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = AT(i, ea[k]);
+      }
+      break;
+   case I_LDX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         x[i] = nf[i] = zf[i] = AT(i, ea[k]);
+      }
+      break;
+   case I_LDY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         y[i] = nf[i] = zf[i] = AT(i, ea[k]);
+      }
+      break;
+   case I_STA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, ea[k]) = a[i];
+      }
+      break;
+   case I_STX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, ea[k]) = x[i];
+      }
+      break;
+   case I_STY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, ea[k]) = y[i];
+      }
+      break;
+   case I_TAX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         x[i] = nf[i] = zf[i] = a[i];
+      }
+      break;
+   case I_TAY:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         y[i] = nf[i] = zf[i] = a[i];
+      }
+      break;
+   case I_TXA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = x[i];
+      }
+      break;
+   case I_TYA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = y[i];
+      }
+      break;
+   case I_TSX:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         x[i] = nf[i] = zf[i] = s[i];
+      }
+      break;
+   case I_TXS:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         s[i] = x[i];
+      }
+      break;
+   case I_PHA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, STACKPAGE + s[i]--) = a[i];
+      }
+      break;
+   case I_PHP:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, STACKPAGE + s[i]--) = (nf[i] & P_N) | (vf[i] ? P_V : 0) | P_U | P_B |
+                                       df[i] | irq[i] | (zf[i] ? 0 : P_Z) | cf[i];
+      }
+      break;
+   case I_PLA:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         a[i] = nf[i] = zf[i] = AT(i, STACKPAGE + ++s[i]);
+      }
+      break;
+   case I_PLP:
+   case I_RTI:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         p = AT(i, STACKPAGE + ++s[i]);
+         nf[i] = p;
+         zf[i] = !(p & P_Z);
+         cf[i] = p & P_C;
+         vf[i] = p & P_V;
+         df[i] = p & P_D;
+         irq[i] = p & P_I;
+
+         if (d->Op == I_RTI) {
+            t = AT(i, STACKPAGE + ++s[i]);
+            t |= AT(i, STACKPAGE + ++s[i]) << 8;
+            pc[i] = t;
+         }
+      }
+
+      if (d->Op == I_RTI)
+         return (together (l, base));
+      break;
+   case I_CLC:
+   case I_SEC:
+      for (k = 0; k < n; k++)
+         cf[lane[k]] = (d->Op == I_SEC);
+      break;
+   case I_CLD:
+   case I_SED:
+      for (k = 0; k < n; k++)
+         df[lane[k]] = (d->Op == I_SED) ? P_D : 0;
+      break;
+   case I_CLI:
+   case I_SEI:
+      for (k = 0; k < n; k++)
+         irq[lane[k]] = (d->Op == I_SEI) ? P_I : 0;
+      break;
+   case I_CLV:
+      for (k = 0; k < n; k++)
+         vf[lane[k]] = 0;
+      break;
+   case I_NOP:
+      break;
+   case I_BCC:
+      BRANCHES (cf[i] == 0);
+   case I_BCS:
+      BRANCHES (cf[i] != 0);
+   case I_BNE:
+      BRANCHES (zf[i] != 0);
+   case I_BEQ:
+      BRANCHES (zf[i] == 0);
+   case I_BPL:
+      BRANCHES ((nf[i] & 0x80) == 0);
+   case I_BMI:
+      BRANCHES ((nf[i] & 0x80) != 0);
+   case I_BVC:
+      BRANCHES (vf[i] == 0);
+   case I_BVS:
+      BRANCHES (vf[i] != 0);
+   case I_JMP:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         if (ea[k] == at)
+            stop[i] = STOP_LOOP;
+
+         pc[i] = ea[k];
+      }
+
+      return (together (l, base));
+   case I_JSR:
+      t = WORD(next - 1);     /* Return address, less one */
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         AT(i, STACKPAGE + s[i]--) = t >> 8;
+         AT(i, STACKPAGE + s[i]--) = BYTE(t);
+      }
+
+      return (ea[0]);
+   case I_RTS:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         t = AT(i, STACKPAGE + ++s[i]);
+         t |= AT(i, STACKPAGE + ++s[i]) << 8;
+         pc[i] = WORD(t + 1);
+      }
+
+      return (together (l, base));
+   case I_BRK:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         if (l->Brkhalt) {
+            pc[i] = at;
+            cycles[i] -= d->Cyc;
+            insns[i]--;
+            stop[i] = STOP_BRK;
+            continue;
+         }
+
+         t = WORD(next + 1);     /* BRK skips a padding byte */
+         AT(i, STACKPAGE + s[i]--) = t >> 8;
+         AT(i, STACKPAGE + s[i]--) = BYTE(t);
+         AT(i, STACKPAGE + s[i]--) = (nf[i] & P_N) | (vf[i] ? P_V : 0) | P_U | P_B |
+                                     df[i] | irq[i] | (zf[i] ? 0 : P_Z) | cf[i];
+         irq[i] = P_I;
+         pc[i] = AT(i, IRQVEC) | (AT(i, IRQVEC + 1) << 8);
+      }
+
+      return (together (l, base));
+   case I_ILL:
+      for (k = 0; k < n; k++) {
+         i = lane[k];
+         pc[i] = at;
+         cycles[i] -= d->Cyc;
+         insns[i]--;
+         stop[i] = STOP_ILLEGAL;
+      }
+
+      return (ERR);
+   }
+
+   return (next);
+}
+
+
+/* together --- the PC that every lane of the group has reached, or ERR
+ * if they have parted company or any of them has stopped */
+
+long together (l, base)
+const struct Lanes *l;
+const int base;
+{
+   const unsigned int *const pc = l->Pc + base;
+   const unsigned char *const stop = l->Stop + base;
+   const int *const group = l->Group;
+   int k;
+
+   for (k = 0; k < l->Ngroup; k++)
+      if (stop[group[k]] != STOP_NONE || pc[group[k]] != pc[group[0]])
+         return (ERR);
+
+   return (pc[group[0]]);
+}
@@ -0,0 +1,945 @@
+/* libsim6502 --- John's 6502 simulator, as a library      2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Modification:
+ * 2026-10-17 agent Table-driven NMOS 6502, decoded from the assembler's opcode table
+ * 2026-10-17 agent Kept as sim_interp(), now that sim_run() uses decoded blocks
+ * 2026-10-17 agent Count instructions and cycles at each address when profiling
+ * 2026-10-17 agent Optionally mark which bytes were loaded, for the disassembler
+ * 2026-10-17 agent Clear a 6502 out, ready for another program
+ * 2026-10-17 agent Keep track of dirty pages for snapshots
+ * 2026-10-17 agent Devices in the memory map
+ * 2026-10-17 agent Run up to the next device event, and take interrupts
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "as6502.h"
+#include "opcodes.h"
+#include "sim6502.h"
+
+struct Decode Decode[256];       /* Filled in from Opcodes[] */
+
+const char Simops[NSIMOPS][4] = {   /* Names for I_ADC, etc. */
+   "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI",
+   "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD", "CLI",
+   "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR",
+   "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX", "LDY",
+   "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL",
+   "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA",
+   "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+   "???"
+};
+
+const unsigned char Modelen[MAXMODES] = {   /* Bytes for each addressing mode */
+/* inh, imm, abs, abs,X, abs,Y, zpage, zpage,X, zpage,Y, ind,X, ind,Y, rel, ind */
+     1,   2,   3,     3,     3,     2,       2,       2,     2,     2,   2,   3
+};
+
+int     Siminited = NO;
+
+#ifdef __STDC__
+int load_hex (struct Cpu *cpu, FILE *fp, char *lin);
+int hex_record (struct Cpu *cpu, const char *lin, int kind, int store);
+int load_bin (struct Cpu *cpu, FILE *fp, long addr);
+int hexbyte (const char *p);
+void put_mem (struct Cpu *cpu, long addr, int byte);
+#else
+#define const
+int load_hex ();
+int hex_record ();
+int load_bin ();
+int hexbyte ();
+void put_mem ();
+#endif   /* __STDC__ */
+
+
+/* sim_init --- invert the assembler's opcode table into a decode table */
+
+void sim_init ()
+{
+   int i, j, mode, op;
+
+   if (Siminited)
+      return;
+
+   for (op = 0; op < 256; op++) {
+      Decode[op].Op = I_ILL;
+      Decode[op].Mode = INHERENT;
+      Decode[op].Len = 1;
+      Decode[op].Cyc = 2;
+      Decode[op].Page = NO;
+   }
+
+   for (i = 0; i < Nopcodes; i++) {
+      for (j = 0; j < I_ILL; j++)
+         if (strcmp (Simops[j], Opcodes[i].mnem) == 0)
+            break;
+
+      if (j == I_ILL) {
+         fprintf (stderr, "%s: internal error: no simulation\n", Opcodes[i].mnem);
+         exit (1);
+      }
+
+      for (mode = 0; mode < MAXMODES; mode++) {
+         if ((op = Opcodes[i].obj[mode]) == ERR)
+            continue;
+
+         Decode[op].Op = j;
+         Decode[op].Mode = mode;
+         Decode[op].Len = Modelen[mode];
+         Decode[op].Cyc = Opcodes[i].cyc[mode];
+         Decode[op].Page = (Opcodes[i].flags & F_PAGE) &&
+                           (mode == INDEX_X || mode == INDEX_Y || mode == INDIRECT_Y);
+      }
+   }
+
+   init_handlers ();
+
+   Siminited = YES;
+}
+
+
+/* sim_new --- make a new 6502 with its memory filled with zeros */
+
+struct Cpu *sim_new ()
+{
+   struct Cpu *cpu;
+
+   sim_init ();
+
+   cpu = calloc (1, sizeof (struct Cpu));
+   if (cpu == NULL)
+      return (NULL);
+
+   cpu->Mem = calloc (MEMSIZE, sizeof (unsigned char));
+   if (cpu->Mem == NULL) {
+      free (cpu);
+      return (NULL);
+   }
+
+   cpu->Brkhalt = YES;
+   cpu->Lowaddr = MEMSIZE;
+   cpu->Highaddr = -1L;
+   sim_reset (cpu, ERR);
+
+   return (cpu);
+}
+
+
+/* sim_free --- throw a 6502 away */
+
+void sim_free (cpu)
+struct Cpu *cpu;
+{
+   sim_flush (cpu);
+
+   if (cpu->Base != NULL)
+      sim_release (cpu->Base);
+
+   free_devices (cpu);
+
+   free (cpu->Events);
+   free (cpu->Cache);
+   free (cpu->Prof);
+   free (cpu->Mem);
+   free (cpu);
+}
+
+
+/* sim_reset --- reset the 6502, starting at 'start' or else through the reset vector */
+
+void sim_reset (cpu, start)
+struct Cpu *cpu;
+const long start;
+{
+   cpu->A = cpu->X = cpu->Y = 0;
+   cpu->S = 0xff;
+   cpu->P = P_U | P_I | P_Z;
+   cpu->Cycles = 0L;
+   cpu->Insns = 0L;
+   cpu->Stop = STOP_NONE;
+
+   reset_devices (cpu);    /* Their events were for the old cycle count */
+
+   if (start != ERR)
+      cpu->Pc = WORD(start);
+   else
+      cpu->Pc = cpu->Mem[RESETVEC] | (cpu->Mem[RESETVEC + 1] << 8);
+}
+
+
+/* sim_clear --- fill memory with zeros and forget what was loaded, ready for another program */
+
+void sim_clear (cpu)
+struct Cpu *cpu;
+{
+   sim_flush (cpu);
+   memset (cpu->Mem, 0, MEMSIZE);
+
+   if (cpu->Loaded != NULL)
+      memset (cpu->Loaded, 0, MEMSIZE);
+
+   if (cpu->Prof != NULL)
+      memset (cpu->Prof, 0, sizeof (struct Profile));
+
+   memset (cpu->Dirty, YES, NPAGES);
+   cpu->Lowaddr = MEMSIZE;
+   cpu->Highaddr = -1L;
+   cpu->Vecset = NO;
+   sim_reset (cpu, ERR);
+}
+
+
+/* sim_status --- the processor status register, as PHP would push it */
+
+unsigned char sim_status (cpu)
+const struct Cpu *cpu;
+{
+   return (cpu->P | P_U | P_B);
+}
+
+
+/* sim_interp --- run one instruction at a time until something stops it,
+ * or for about 'maxcycles' cycles.  Slower than sim_run(), but simpler. */
+
+int sim_interp (cpu, maxcycles)
+struct Cpu *cpu;
+const unsigned long maxcycles;
+{
+   unsigned char *const mem = cpu->Mem;
+   const struct Decode *d;
+   unsigned long cycles, insns, limit, end;
+   unsigned int pc, ea, t, r;
+   unsigned int a, x, y, s;
+   unsigned int c, v, n, z, dec, irq;   /* Flags; 'n' and 'z' hold a result */
+   struct Profile *const prof = cpu->Prof;
+   unsigned int here;
+   unsigned long before;
+   int stop;
+   struct Device *dev;
+   unsigned int held;
+
+   if (cpu->Cache != NULL)    /* Stores here don't drop decoded blocks */
+      cpu->Stale = YES;
+
+   memset (cpu->Dirty, YES, NPAGES);   /* Nor mark the pages they hit */
+
+   pc = cpu->Pc;
+   a = cpu->A;
+   x = cpu->X;
+   y = cpu->Y;
+   s = cpu->S;
+   c = cpu->P & P_C;
+   v = cpu->P & P_V;
+   n = cpu->P & P_N;
+   z = !(cpu->P & P_Z);
+   dec = cpu->P & P_D;
+   irq = cpu->P & P_I;
+   cycles = cpu->Cycles;
+   insns = cpu->Insns;
+   end = cycles + maxcycles;
+   limit = cycles;      /* See to events and interrupts before the first */
+   stop = STOP_NONE;
+
+   for (;;) {
+      /* At the next event or the end, or sooner if something might be waiting */
+      if (cycles >= limit) {
+         cpu->Cycles = cycles;
+         if (cpu->Nevents > 0 && cpu->Events[0].When <= cycles)
+            fire_events (cpu);
+
+         if (cpu->Irqs > 0 && !irq) {
+            mem[STACKPAGE + s] = pc >> 8;
+            s = BYTE(s - 1);
+            mem[STACKPAGE + s] = BYTE(pc);
+            s = BYTE(s - 1);
+            mem[STACKPAGE + s] = (n & P_N) | (v ? P_V : 0) | P_U | dec | irq | (z ? 0 : P_Z) | c;
+            s = BYTE(s - 1);
+            irq = P_I;
+            pc = mem[IRQVEC] | (mem[IRQVEC + 1] << 8);
+            cycles += 7;
+         }
+
+         if (cycles >= end)
+            break;
+
+         limit = DEADLINE(cpu, end);
+      }
+
+      here = pc;
+      before = cycles;
+      d = &Decode[mem[pc]];
+      cycles += d->Cyc;
+      insns++;
+
+      /* Work out the effective address; immediate operands are at pc + 1 */
+      switch (d->Mode) {
+      case IMMEDIATE:
+         ea = WORD(pc + 1);
+         break;
+      case ABSOLUTE:
+         ea = mem[WORD(pc + 1)] | (mem[WORD(pc + 2)] << 8);
+         break;
+      case INDEX_X:
+         t = mem[WORD(pc + 1)] | (mem[WORD(pc + 2)] << 8);
+         ea = WORD(t + x);
+         if (d->Page && CROSSES(t, ea))
+            cycles++;
+         break;
+      case INDEX_Y:
+         t = mem[WORD(pc + 1)] | (mem[WORD(pc + 2)] << 8);
+         ea = WORD(t + y);
+         if (d->Page && CROSSES(t, ea))
+            cycles++;
+         break;
+      case Z_PAGE:
+         ea = mem[WORD(pc + 1)];
+         break;
+      case Z_INDEX_X:
+         ea = BYTE(mem[WORD(pc + 1)] + x);
+         break;
+      case Z_INDEX_Y:
+         ea = BYTE(mem[WORD(pc + 1)] + y);
+         break;
+      case INDIRECT_X:
+         t = BYTE(mem[WORD(pc + 1)] + x);
+         ea = mem[t] | (mem[BYTE(t + 1)] << 8);
+         break;
+      case INDIRECT_Y:
+         t = mem[WORD(pc + 1)];
+         t = mem[t] | (mem[BYTE(t + 1)] << 8);
+         ea = WORD(t + y);
+         if (d->Page && CROSSES(t, ea))
+            cycles++;
+         break;
+      case RELATIVE:
+         ea = WORD(pc + 2 + (signed char)mem[WORD(pc + 1)]);
+         break;
+      case INDIRECT:    /* JMP (ind): the NMOS 6502 doesn't carry into the high byte */
+         t = mem[WORD(pc + 1)] | (mem[WORD(pc + 2)] << 8);
+         ea = mem[t] | (mem[(t & 0xff00) | BYTE(t + 1)] << 8);
+         break;
+      default:
+         ea = 0;
+         break;
+      }
+
+      pc = WORD(pc + d->Len);
+
+      /* As io_() does for blocks: the device's byte goes through memory */
+      dev = NULL;
+      held = 0;
+
+      if (cpu->Devices != NULL && (d->Mode == ABSOLUTE || d->Mode == INDEX_X || d->Mode == INDEX_Y ||
+                                   d->Mode == INDIRECT_X || d->Mode == INDIRECT_Y)) {
+         if (LOADS(d->Op) && (dev = cpu->Rdev[ea >> 8]) != NULL) {
+            mem[ea] = (*dev->Read) (dev, ea, cycles);
+            limit = cycles;      /* It may have an event or an interrupt for us sooner */
+         }
+
+         if (STORES(d->Op) && (dev = cpu->Wdev[ea >> 8]) != NULL) {
+            held = mem[ea];
+            limit = cycles;
+         }
+         else
+            dev = NULL;
+      }
+
+      switch (d->Op) {
+      case I_ADC:
+         t = mem[ea];
+         if (dec) {     /* NMOS: Z from the binary sum, N and V from the decimal one */
+            r = (a & 0x0f) + (t & 0x0f) + c;
+            if (r > 9)
+               r += 6;
+            r = (r & 0x0f) + (a & 0xf0) + (t & 0xf0) + (r > 0x0f ? 0x10 : 0);
+            z = BYTE(a + t + c);
+            n = r;
+            v = ~(a ^ t) & (a ^ r) & 0x80;
+            if ((r & 0x1f0) > 0x90)
+               r += 0x60;
+            c = (r > 0xff);
+            a = BYTE(r);
+         }
+         else {
+            r = a + t + c;
+            v = ~(a ^ t) & (a ^ r) & 0x80;
+            c = r >> 8;
+            a = n = z = BYTE(r);
+         }
+         break;
+      case I_SBC:
+         t = mem[ea];
+         r = a - t - !c;
+         v = (a ^ t) & (a ^ r) & 0x80;
+         if (dec) {     /* NMOS: all the flags from the binary difference */
+            unsigned int lo, hi;
+
+            lo = (a & 0x0f) - (t & 0x0f) - !c;
+            hi = (a >> 4) - (t >> 4);
+            if (lo & 0x10) {
+               lo -= 6;
+               hi--;
+            }
+            if (hi & 0x10)
+               hi -= 6;
+            n = z = BYTE(r);
+            c = !(r & 0x100);
+            a = BYTE((hi << 4) | (lo & 0x0f));
+         }
+         else {
+            c = !(r & 0x100);
+            a = n = z = BYTE(r);
+         }
+         break;
+      case I_AND:
+         a = n = z = a & mem[ea];
+         break;
+      case I_ORA:
+         a = n = z = a | mem[ea];
+         break;
+      case I_EOR:
+         a = n = z = a ^ mem[ea];
+         break;
+      case I_ASL:
+         if (d->Mode == INHERENT) {
+            c = a >> 7;
+            a = n = z = BYTE(a << 1);
+         }
+         else {
+            t = mem[ea];
+            c = t >> 7;
+            mem[ea] = n = z = BYTE(t << 1);
+         }
+         break;
+      case I_LSR:
+         if (d->Mode == INHERENT) {
+            c = a & 1;
+            a = n = z = a >> 1;
+         }
+         else {
+            t = mem[ea];
+            c = t & 1;
+            mem[ea] = n = z = t >> 1;
+         }
+         break;
+      case I_ROL:
+         if (d->Mode == INHERENT) {
+            r = (a << 1) | c;
+            c = a >> 7;
+            a = n = z = BYTE(r);
+         }
+         else {
+            t = mem[ea];
+            r = (t << 1) | c;
+            c = t >> 7;
+            mem[ea] = n = z = BYTE(r);
+         }
+         break;
+      case I_ROR:
+         if (d->Mode == INHERENT) {
+            r = (a >> 1) | (c << 7);
+            c = a & 1;
+            a = n = z = r;
+         }
+         else {
+            t = mem[ea];
+            r = (t >> 1) | (c << 7);
+            c = t & 1;
+            mem[ea] = n = z = r;
+         }
+         break;
+      case I_INC:
+         mem[ea] = n = z = BYTE(mem[ea] + 1);
+         break;
+      case I_DEC:
+         mem[ea] = n = z = BYTE(mem[ea] - 1);
+         break;
+      case I_INX:
+         x = n = z = BYTE(x + 1);
+         break;
+      case I_INY:
+         y = n = z = BYTE(y + 1);
+         break;
+      case I_DEX:
+         x = n = z = BYTE(x - 1);
+         break;
+      case I_DEY:
+         y = n = z = BYTE(y - 1);
+         break;
+      case I_BIT:
+         t = mem[ea];
+         n = t;
+         v = t & P_V;
+         z = a & t;
+         break;
+      case I_CMP:
+         r = a - mem[ea];
+         c = !(r & 0x100);
+         n = z = BYTE(r);
+         break;
+      case I_CPX:
+         r = x - mem[ea];
+         c = !(r & 0x100);
+         n = z = BYTE(r);
+         break;
+      case I_CPY:
+         r = y - mem[ea];
+         c = !(r & 0x100);
+         n = z = BYTE(r);
+         break;
+      case I_LDA:
+         a = n = z = mem[ea];
+         break;
+      case I_LDX:
+         x = n = z = mem[ea];
+         break;
+      case I_LDY:
+         y = n = z = mem[ea];
+         break;
+      case I_STA:
+         mem[ea] = a;
+         break;
+      case I_STX:
+         mem[ea] = x;
+         break;
+      case I_STY:
+         mem[ea] = y;
+         break;
+      case I_TAX:
+         x = n = z = a;
+         break;
+      case I_TAY:
+         y = n = z = a;
+         break;
+      case I_TXA:
+         a = n = z = x;
+         break;
+      case I_TYA:
+         a = n = z = y;
+         break;
+      case I_TSX:
+         x = n = z = s;
+         break;
+      case I_TXS:
+         s = x;
+         break;
+      case I_PHA:
+         mem[STACKPAGE + s] = a;
+         s = BYTE(s - 1);
+         break;
+      case I_PHP:
+         mem[STACKPAGE + s] = (n & P_N) | (v ? P_V : 0) | P_U | P_B | dec | irq | (z ? 0 : P_Z) | c;
+         s = BYTE(s - 1);
+         break;
+      case I_PLA:
+         s = BYTE(s + 1);
+         a = n = z = mem[STACKPAGE + s];
+         break;
+      case I_PLP:
+         s = BYTE(s + 1);
+         t = mem[STACKPAGE + s];
+         n = t;
+         z = !(t & P_Z);
+         c = t & P_C;
+         v = t & P_V;
+         dec = t & P_D;
+         irq = t & P_I;
+         if (cpu->Irqs > 0)
+            limit = cycles;
+         break;
+      case I_CLC:
+         c = 0;
+         break;
+      case I_SEC:
+         c = 1;
+         break;
+      case I_CLD:
+         dec = 0;
+         break;
+      case I_SED:
+         dec = P_D;
+         break;
+      case I_CLI:
+         irq = 0;
+         if (cpu->Irqs > 0)
+            limit = cycles;
+         break;
+      case I_SEI:
+         irq = P_I;
+         break;
+      case I_CLV:
+         v = 0;
+         break;
+      case I_NOP:
+         break;
+      case I_BCC:
+         t = !c;
+         goto branch;
+      case I_BCS:
+         t = c;
+         goto branch;
+      case I_BNE:
+         t = (z != 0);
+         goto branch;
+      case I_BEQ:
+         t = (z == 0);
+         goto branch;
+      case I_BPL:
+         t = !(n & 0x80);
+         goto branch;
+      case I_BMI:
+         t = (n & 0x80);
+         goto branch;
+      case I_BVC:
+         t = !v;
+         goto branch;
+      case I_BVS:
+         t = v;
+      branch:
+         if (t) {
+            cycles += CROSSES(pc, ea) ? 2 : 1;
+            if (ea == WORD(pc - 2))
+               stop = STOP_LOOP;
+
+            pc = ea;
+         }
+         break;
+      case I_JMP:
+         if (ea == WORD(pc - d->Len))
+            stop = STOP_LOOP;
+         pc = ea;
+         break;
+      case I_JSR:
+         t = WORD(pc - 1);    /* Return address, less one */
+         mem[STACKPAGE + s] = t >> 8;
+         s = BYTE(s - 1);
+         mem[STACKPAGE + s] = BYTE(t);
+         s = BYTE(s - 1);
+         pc = ea;
+         break;
+      case I_RTS:
+         s = BYTE(s + 1);
+         t = mem[STACKPAGE + s];
+         s = BYTE(s + 1);
+         t |= mem[STACKPAGE + s] << 8;
+         pc = WORD(t + 1);
+         break;
+      case I_RTI:
+         s = BYTE(s + 1);
+         t = mem[STACKPAGE + s];
+         n = t;
+         z = !(t & P_Z);
+         c = t & P_C;
+         v = t & P_V;
+         dec = t & P_D;
+         irq = t & P_I;
+         s = BYTE(s + 1);
+         t = mem[STACKPAGE + s];
+         s = BYTE(s + 1);
+         t |= mem[STACKPAGE + s] << 8;
+         pc = t;
+         if (cpu->Irqs > 0)
+            limit = cycles;
+         break;
+      case I_BRK:
+         if (cpu->Brkhalt) {
+            pc = WORD(pc - 1);
+            cycles -= d->Cyc;
+            insns--;
+            stop = STOP_BRK;
+            break;
+         }
+
+         t = WORD(pc + 1);    /* BRK skips a padding byte */
+         mem[STACKPAGE + s] = t >> 8;
+         s = BYTE(s - 1);
+         mem[STACKPAGE + s] = BYTE(t);
+         s = BYTE(s - 1);
+         mem[STACKPAGE + s] = (n & P_N) | (v ? P_V : 0) | P_U | P_B | dec | irq | (z ? 0 : P_Z) | c;
+         s = BYTE(s - 1);
+         irq = P_I;
+         pc = mem[IRQVEC] | (mem[IRQVEC + 1] << 8);
+         break;
+      case I_ILL:
+         pc = WORD(pc - 1);
+         cycles -= d->Cyc;
+         insns--;
+         stop = STOP_ILLEGAL;
+         break;
+      }
+
+      if (dev != NULL) {
+         t = mem[ea];
+         mem[ea] = held;
+         (*dev->Write) (dev, ea, t, cycles);
+      }
+
+      if (prof != NULL && stop != STOP_BRK && stop != STOP_ILLEGAL) {
+         prof->Count[here]++;
+         prof->Cycles[here] += cycles - before;
+      }
+
+      if (stop != STOP_NONE)
+         break;
+   }
+
+   cpu->Pc = pc;
+   cpu->A = a;
+   cpu->X = x;
+   cpu->Y = y;
+   cpu->S = s;
+   cpu->P = (n & P_N) | (v ? P_V : 0) | P_U | dec | irq | (z ? 0 : P_Z) | (c ? P_C : 0);
+   cpu->Cycles = cycles;
+   cpu->Insns = insns;
+   cpu->Stop = (stop == STOP_NONE) ? STOP_LIMIT : stop;
+
+   return (cpu->Stop);
+}
+
+
+/* sim_load --- load MOS Technology, Motorola or Intel hex, or a binary image
+ * at 'addr' (a whole 64K image goes at zero).  Returns the number of bad records.
+ * It is hex only if the first line is a whole good record, so that a binary
+ * image can start with any byte. */
+
+int sim_load (cpu, fp, addr)
+struct Cpu *cpu;
+FILE *fp;
+const long addr;
+{
+   char lin[BUFSIZ];
+   long base;
+   int ch;
+   int n, i;
+
+   for (n = 0; n < sizeof (lin) - 1 && (ch = getc (fp)) != EOF; ) {
+      lin[n++] = ch;
+      if (ch == NEWLINE)
+         break;
+   }
+
+   lin[n] = EOS;
+
+   if (n > 0 && n == strlen (lin) && strchr (";S:", lin[0]) != NULL &&
+       hex_record (cpu, lin, lin[0], NO) != ERR)
+      return (load_hex (cpu, fp, lin));
+
+   base = (addr == ERR) ? 0L : addr;    /* Binary: what was read is the start of it */
+
+   for (i = 0; i < n && base + i < MEMSIZE; i++)
+      put_mem (cpu, base + i, lin[i] & 0xff);
+
+   return (load_bin (cpu, fp, base + n));
+}
+
+
+/* load_hex --- load records of hex, starting with the one in 'lin' (BUFSIZ long) */
+
+int load_hex (cpu, fp, lin)
+struct Cpu *cpu;
+FILE *fp;
+char lin[];
+{
+   const int kind = lin[0];     /* The character that starts each record */
+   int bad;
+   int stat;
+
+   bad = 0;
+
+   do {
+      if (lin[0] != kind)
+         continue;
+
+      if ((stat = hex_record (cpu, lin, kind, YES)) == ERR)
+         bad++;
+      else if (stat == YES)
+         break;
+   } while (fgets (lin, BUFSIZ, fp) != NULL);
+
+   return (bad);
+}
+
+
+/* hex_record --- check a record of hex, and load its bytes too if 'store'.
+ * Returns OK, YES for an end record, or ERR if it is bad. */
+
+int hex_record (cpu, lin, kind, store)
+struct Cpu *cpu;
+const char lin[];
+const int kind;
+const int store;
+{
+   const char *p;
+   int len, alen, type, sum, i, b, c;
+   int data, end, good;
+   long a;
+
+   p = lin + 1;
+   alen = 2;
+   type = 0;
+
+   if (kind == 'S') {
+      if (!isdigit (lin[1]))
+         return (ERR);
+
+      if (lin[1] == '2' || lin[1] == '6' || lin[1] == '8')
+         alen = 3;
+      else if (lin[1] == '3' || lin[1] == '7')
+         alen = 4;
+
+      p++;
+   }
+
+   if ((len = hexbyte (p)) < 0)
+      return (ERR);
+
+   sum = len;
+   p += 2;
+
+   if (kind == 'S')
+      len -= alen + 1;     /* The count takes in the address and checksum */
+
+   for (a = 0L, i = 0; i < alen; i++, p += 2) {
+      if ((b = hexbyte (p)) < 0)
+         return (ERR);
+
+      a = (a << 8) | b;
+      sum += b;
+   }
+
+   if (kind == ':') {
+      if ((type = hexbyte (p)) < 0)
+         return (ERR);
+
+      sum += type;
+      p += 2;
+   }
+
+   switch (kind) {
+   case ';':
+      data = YES;
+      end = (len == 0);    /* MOS end record: the count is of records, not an address */
+      break;
+   case 'S':
+      data = (lin[1] == '1');    /* Only S1 records hold data */
+      end = NO;
+      break;
+   default:
+      data = (type == 0);
+      end = (type == 1);
+      break;
+   }
+
+   if (len < 0)
+      return (ERR);
+
+   for (i = 0; i < len; i++, p += 2) {
+      if ((b = hexbyte (p)) < 0)
+         return (ERR);
+
+      if (store && data)
+         put_mem (cpu, a + i, b);
+
+      sum += b;
+   }
+
+   switch (kind) {     /* Each has its own checksum */
+   case ';':
+      b = hexbyte (p);
+      c = hexbyte (p + 2);
+      good = (b >= 0 && c >= 0 && ((b << 8) | c) == (sum & 0xffff));
+      p += 4;
+      break;
+   case 'S':
+      b = hexbyte (p);
+      good = (b >= 0 && b == (~sum & 0xff));
+      p += 2;
+      break;
+   default:
+      b = hexbyte (p);
+      good = (b >= 0 && b == (-sum & 0xff));
+      p += 2;
+      break;
+   }
+
+   while (*p != EOS && isspace (*p))     /* Nothing else on the line */
+      p++;
+
+   if (!good || *p != EOS)
+      return (ERR);
+
+   return (end ? YES : OK);
+}
+
+
+/* load_bin --- load a binary image */
+
+int load_bin (cpu, fp, addr)
+struct Cpu *cpu;
+FILE *fp;
+long addr;
+{
+   unsigned char buf[BUFSIZ];
+   size_t n, i;
+   long a;
+
+   if (addr == ERR)
+      addr = 0L;
+
+   for (a = addr; (n = fread (buf, sizeof (unsigned char), sizeof (buf), fp)) > 0; a += n)
+      for (i = 0; i < n && a + i < MEMSIZE; i++)
+         put_mem (cpu, a + i, buf[i]);
+
+   return (0);
+}
+
+
+/* hexbyte --- two hex digits, or ERR */
+
+int hexbyte (p)
+const char *p;
+{
+   static const char digits[] = "0123456789ABCDEF";
+   const char *h, *l;
+
+   if (p[0] == EOS || p[1] == EOS)
+      return (ERR);
+
+   h = strchr (digits, toupper (p[0]));
+   l = strchr (digits, toupper (p[1]));
+
+   if (h == NULL || l == NULL)
+      return (ERR);
+
+   return (((h - digits) << 4) | (l - digits));
+}
+
+
+/* put_mem --- store a loaded byte, keeping track of what has been loaded */
+
+void put_mem (cpu, addr, byte)
+struct Cpu *cpu;
+long addr;
+const int byte;
+{
+   addr &= 0xffff;    /* Records can wrap */
+
+   sim_poke (cpu, addr, byte);
+
+   if (cpu->Loaded != NULL)
+      cpu->Loaded[addr] = YES;
+
+   if (addr < cpu->Lowaddr)
+      cpu->Lowaddr = addr;
+
+   if (addr > cpu->Highaddr)
+      cpu->Highaddr = addr;
+
+   if (addr == RESETVEC || addr == RESETVEC + 1)
+      cpu->Vecset = YES;
+}
@@ -0,0 +1,220 @@
+/* profile --- show where a 6502 program spent its time      2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* The counts are merged onto the listing from as6502, as two columns
+ * in front of each line of code, and then totalled up for each label.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#define LABCOL       30          /* Where list_it() puts the label */
+#define MNEMCOL      (LABCOL + MAXLABEL)
+
+struct Label {                   /* Start of a routine, from the listing */
+   char    Name[MAXLABEL];
+   unsigned int Addr;
+   int     Seq;                  /* Order in the listing */
+   unsigned long Insns;          /* Instructions run from here to the next label */
+   unsigned long Cycles;         /* and the cycles they took */
+};
+
+#ifdef __STDC__
+int code_addr (const char *lin);
+int label_addr (const char *lin);
+int hexnum (const char *p, int n);
+int by_address (const void *a, const void *b);
+int by_cycles (const void *a, const void *b);
+#else
+#define const
+int code_addr ();
+int label_addr ();
+int hexnum ();
+int by_address ();
+int by_cycles ();
+#endif   /* __STDC__ */
+
+
+/* sim_profile --- start counting instructions and cycles at each address */
+
+int sim_profile (cpu)
+struct Cpu *cpu;
+{
+   if (cpu->Prof == NULL)
+      cpu->Prof = calloc (1, sizeof (struct Profile));
+   else
+      memset (cpu->Prof, 0, sizeof (struct Profile));
+
+   return (cpu->Prof == NULL ? ERR : OK);
+}
+
+
+/* sim_annotate --- copy a listing with the counts in front, then the busiest routines */
+
+void sim_annotate (cpu, lst, out)
+const struct Cpu *cpu;
+FILE *lst;
+FILE *out;
+{
+   const struct Profile *const prof = cpu->Prof;
+   char lin[BUFSIZ];
+   struct Label *lab;
+   int nlabs, maxlabs;
+   unsigned long total;
+   long a, end;
+   int i, j, n;
+
+   if (prof == NULL)
+      return;
+
+   lab = NULL;
+   nlabs = maxlabs = 0;
+
+   while (fgets (lin, sizeof (lin), lst) != NULL) {
+      if ((a = code_addr (lin)) != ERR && prof->Count[a] != 0)
+         fprintf (out, "%10lu %12lu  %s", prof->Count[a], prof->Cycles[a], lin);
+      else
+         fprintf (out, "%23s  %s", "", lin);
+
+      if ((a = label_addr (lin)) == ERR)
+         continue;
+
+      if (nlabs >= maxlabs) {
+         maxlabs = maxlabs ? maxlabs * 2 : 64;
+         if ((lab = realloc (lab, maxlabs * sizeof (struct Label))) == NULL)
+            return;
+      }
+
+      for (n = 0; n < MAXLABEL - 1 && !isspace (lin[LABCOL + n]); n++)
+         lab[nlabs].Name[n] = lin[LABCOL + n];
+
+      lab[nlabs].Name[n] = EOS;
+      lab[nlabs].Addr = a;
+      lab[nlabs].Seq = nlabs;
+      nlabs++;
+   }
+
+   /* Each label covers the code up to the next one; the first of several at one address wins */
+   qsort (lab, nlabs, sizeof (struct Label), by_address);
+
+   for (i = j = 0; i < nlabs; i++)
+      if (j == 0 || lab[i].Addr != lab[j - 1].Addr)
+         lab[j++] = lab[i];
+
+   nlabs = j;
+
+   for (i = 0; i < nlabs; i++) {
+      end = (i + 1 < nlabs) ? lab[i + 1].Addr : cpu->Highaddr + 1;
+      lab[i].Insns = lab[i].Cycles = 0L;
+
+      for (a = lab[i].Addr; a < end && a < MEMSIZE; a++) {
+         lab[i].Insns += prof->Count[a];
+         lab[i].Cycles += prof->Cycles[a];
+      }
+   }
+
+   for (a = 0L, total = 0L; a < MEMSIZE; a++)
+      total += prof->Cycles[a];
+
+   qsort (lab, nlabs, sizeof (struct Label), by_cycles);
+
+   fprintf (out, "\nProfile\n\n");
+   fprintf (out, "Routine         Addr       Hits   Instructions         Cycles       %%\n");
+
+   for (i = 0; i < nlabs && lab[i].Cycles != 0; i++)
+      fprintf (out, "%-15s %04X %10lu %14lu %14lu %7.2f\n", lab[i].Name, lab[i].Addr,
+               prof->Count[lab[i].Addr], lab[i].Insns, lab[i].Cycles,
+               100.0 * lab[i].Cycles / total);
+
+   free (lab);
+}
+
+
+/* code_addr --- address of a line of code or data in the listing, or ERR */
+
+int code_addr (lin)
+const char *lin;
+{
+   /* "nnnn: AAAA BB ..." for a source line, "      AAAA BB ..." under a DELAY */
+   if (strlen (lin) < 14)
+      return (ERR);
+
+   if (!(lin[4] == ':' || strncmp (lin, "      ", 6) == 0))
+      return (ERR);
+
+   if (lin[10] != ' ' || hexnum (lin + 11, 2) == ERR || lin[13] != ' ')
+      return (ERR);
+
+   return (hexnum (lin + 6, 4));
+}
+
+
+/* label_addr --- address of the label on this line, unless it is just a constant */
+
+int label_addr (lin)
+const char *lin;
+{
+   if (lin[4] != ':' || strlen (lin) <= LABCOL || isspace (lin[LABCOL]))
+      return (ERR);
+
+   if (strlen (lin) > MNEMCOL + 3 && strncasecmp (lin + MNEMCOL, "EQU", 3) == 0)
+      return (ERR);
+
+   return (hexnum (lin + 6, 4));
+}
+
+
+/* hexnum --- 'n' hex digits, or ERR */
+
+int hexnum (p, n)
+const char *p;
+const int n;
+{
+   int i, v;
+
+   for (i = v = 0; i < n; i++) {
+      if (!isxdigit (p[i]))
+         return (ERR);
+
+      v = (v << 4) | (isdigit (p[i]) ? p[i] - '0' : toupper (p[i]) - 'A' + 10);
+   }
+
+   return (v);
+}
+
+
+/* by_address --- compare labels for qsort, lowest address first */
+
+int by_address (a, b)
+const void *a;
+const void *b;
+{
+   const struct Label *la = a;
+   const struct Label *lb = b;
+
+   if (la->Addr != lb->Addr)
+      return (la->Addr < lb->Addr ? -1 : 1);
+
+   return (la->Seq - lb->Seq);
+}
+
+
+/* by_cycles --- compare labels for qsort, busiest first */
+
+int by_cycles (a, b)
+const void *a;
+const void *b;
+{
+   const struct Label *la = a;
+   const struct Label *lb = b;
+
+   if (la->Cycles != lb->Cycles)
+      return (la->Cycles > lb->Cycles ? -1 : 1);
+
+   return (la->Addr < lb->Addr ? -1 : 1);
+}
@@ -0,0 +1,442 @@
+/* sim6502 --- run a 6502 program from the assembler       2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Loads MOS Technology, Motorola or Intel hex, or a binary image,
+ * and runs it until BRK, an illegal opcode, a jump to itself
+ * or the cycle limit.
+ */
+
+/* Modification:
+ * 2026-10-17 agent Run several programs side by side in lockstep with -m
+ * 2026-10-17 agent Devices from a memory map, with -M, and ACIA input with -a
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#define DEFCYCLES    4000000000UL   /* Default cycle limit */
+#define TRIALCYCLES  100000UL       /* Trial of -m files in lockstep */
+#define MINGROUP     32             /* Lanes each decoded instruction must serve, on average, to stay in lockstep */
+
+#ifdef __STDC__
+int main (int argc, const char * *argv);
+int many (const char *file[], int nfiles, long start, long loadaddr,
+          unsigned long maxcycles, int brkhalt, int bench);
+struct Cpu *load (const char *file, long start, long loadaddr);
+void show (const struct Cpu *cpu);
+void map (struct Cpu *cpu, const char *file, const char *input);
+void leds (const struct Cpu *cpu);
+void usage (void);
+#else
+#define const
+int main ();
+int many ();
+struct Cpu *load ();
+void show ();
+void map ();
+void leds ();
+void usage ();
+#endif   /* __STDC__ */
+
+const char *Stopname[] = {
+   "running", "BRK", "illegal opcode", "loop", "cycle limit", "out of memory"
+};
+
+int main (argc, argv)
+const int argc;
+const char *argv[];
+{
+   struct Cpu *cpu;
+   FILE *fp;
+   long start, loadaddr;
+   unsigned long maxcycles;
+   int bench;
+   int interp;
+   const char *listing;
+   const char *mapfile;
+   const char *input;
+   int brkhalt;
+   int lockstep;
+   int a;
+   clock_t t0, t1;
+   double secs;
+
+   start = ERR;
+   loadaddr = ERR;
+   maxcycles = DEFCYCLES;
+   bench = NO;
+   interp = NO;
+   listing = NULL;
+   mapfile = NULL;
+   input = NULL;
+   brkhalt = YES;
+   lockstep = NO;
+
+   for (a = 1; a < argc && argv[a][0] == '-' && argv[a][1] != EOS; a++) {
+      switch (argv[a][1]) {
+      case 's':
+         if (++a >= argc)
+            usage ();
+
+         start = strtol (argv[a], NULL, 0);   /* Rather than the reset vector */
+         break;
+      case 'l':
+         if (++a >= argc)
+            usage ();
+
+         loadaddr = strtol (argv[a], NULL, 0);   /* Where a binary file goes */
+         break;
+      case 'c':
+         if (++a >= argc)
+            usage ();
+
+         maxcycles = strtoul (argv[a], NULL, 0);
+         break;
+      case 'i':
+         brkhalt = NO;     /* BRK goes through the IRQ vector */
+         break;
+      case 'I':
+         interp = YES;     /* One instruction at a time, without decoded blocks */
+         break;
+      case 'p':
+         if (++a >= argc)
+            usage ();
+
+         listing = argv[a];   /* Profile, and annotate this listing */
+         break;
+      case 'M':
+         if (++a >= argc)
+            usage ();
+
+         mapfile = argv[a];   /* Devices, as in doc/mmap */
+         break;
+      case 'a':
+         if (++a >= argc)
+            usage ();
+
+         input = argv[a];     /* What the ACIA receives */
+         break;
+      case 'B':
+         bench = YES;      /* Report the speed of the simulation */
+         break;
+      case 'm':
+         lockstep = YES;   /* Many files, each in its own lane */
+         break;
+      default:
+         usage ();
+      }
+   }
+
+   if (lockstep && (interp || listing != NULL || mapfile != NULL || input != NULL))
+      usage ();      /* Lanes have no interpreter, profile or devices */
+
+   if (lockstep && a < argc)
+      return (many (argv + a, argc - a, start, loadaddr, maxcycles, brkhalt, bench));
+
+   if (a != argc - 1)
+      usage ();
+
+   cpu = load (argv[a], start, loadaddr);
+   cpu->Brkhalt = brkhalt;
+
+   if (mapfile != NULL)
+      map (cpu, mapfile, input);
+
+   if (listing != NULL && sim_profile (cpu) == ERR) {
+      fputs ("sim6502: no memory for the profile\n", stderr);
+      exit (1);
+   }
+
+   t0 = clock ();
+   if (interp)
+      sim_interp (cpu, maxcycles);
+   else
+      sim_run (cpu, maxcycles);
+   t1 = clock ();
+
+   sim_drain (cpu);     /* Cut short by the cycle limit */
+   fflush (stdout);     /* After anything the ACIA sent */
+   show (cpu);
+   leds (cpu);
+
+   if (bench) {
+      secs = (double)(t1 - t0) / CLOCKS_PER_SEC;
+      if (secs <= 0.0)
+         secs = 1.0 / CLOCKS_PER_SEC;
+
+      printf ("%.3f s: %.1f MIPS, %.1f emulated MHz\n", secs,
+              cpu->Insns / secs / 1e6, cpu->Cycles / secs / 1e6);
+   }
+
+   if (listing != NULL) {
+      if ((fp = fopen (listing, READ)) == NULL) {
+         fputs (listing, stderr);
+         fputs (": can't open\n", stderr);
+         exit (1);
+      }
+
+      putchar ('\n');
+      sim_annotate (cpu, fp, stdout);
+      fclose (fp);
+   }
+
+   a = (cpu->Stop == STOP_BRK || cpu->Stop == STOP_LOOP) ? 0 : 1;
+   sim_free (cpu);
+
+   return (a);
+}
+
+
+/* many --- run many files side by side, in lockstep if they keep together */
+
+int many (file, nfiles, start, loadaddr, maxcycles, brkhalt, bench)
+const char *file[];
+const int nfiles;
+const long start;
+const long loadaddr;
+const unsigned long maxcycles;
+const int brkhalt;
+const int bench;
+{
+   struct Lanes *l;
+   struct Cpu *cpu;
+   unsigned long insns, cycles, trial;
+   int status;
+   int left;
+   int i;
+   clock_t t0;
+   double secs;
+
+   if ((l = lanes_new (nfiles)) == NULL) {
+      fputs ("sim6502: out of memory\n", stderr);
+      exit (1);
+   }
+
+   l->Brkhalt = brkhalt;
+
+   for (i = 0; i < nfiles; i++) {
+      cpu = load (file[i], start, loadaddr);
+      lanes_put (l, i, cpu);
+      sim_free (cpu);
+   }
+
+   /* A short trial shows whether the lanes keep together.  Unless each
+    * decoded instruction is done for MINGROUP lanes or more, on average,
+    * lockstep is slower than running each file on its own, with its
+    * decoded blocks. */
+   trial = (maxcycles < TRIALCYCLES) ? maxcycles : TRIALCYCLES;
+
+   t0 = clock ();
+   left = lanes_run (l, trial);
+   secs = (double)(clock () - t0) / CLOCKS_PER_SEC;
+
+   if (left > 0 && trial < maxcycles) {      /* Some lanes have further to go */
+      for (i = 0, insns = 0L; i < nfiles; i++)
+         insns += l->Insns[i];
+
+      if (insns >= MINGROUP * l->Steps) {    /* Start again, in lockstep for the whole run */
+         for (i = 0; i < nfiles; i++) {
+            cpu = load (file[i], start, loadaddr);
+            lanes_put (l, i, cpu);
+            sim_free (cpu);
+         }
+
+         t0 = clock ();
+         lanes_run (l, maxcycles);
+         secs += (double)(clock () - t0) / CLOCKS_PER_SEC;
+      }
+      else {                     /* Start again, one file at a time */
+         lanes_free (l);
+         l = NULL;
+      }
+   }
+
+   status = 0;
+   insns = cycles = 0L;
+
+   cpu = (l != NULL) ? sim_new () : NULL;    /* Else one for each file in turn */
+   if (l != NULL && cpu == NULL) {
+      fputs ("sim6502: out of memory\n", stderr);
+      exit (1);
+   }
+
+   for (i = 0; i < nfiles; i++) {
+      if (l != NULL)
+         lanes_get (l, i, cpu);
+      else {
+         cpu = load (file[i], start, loadaddr);
+         cpu->Brkhalt = brkhalt;
+
+         t0 = clock ();
+         sim_run (cpu, maxcycles);
+         secs += (double)(clock () - t0) / CLOCKS_PER_SEC;
+      }
+
+      printf ("%s: ", file[i]);
+      show (cpu);
+
+      insns += cpu->Insns;
+      cycles += cpu->Cycles;
+
+      if (!(cpu->Stop == STOP_BRK || cpu->Stop == STOP_LOOP))
+         status = 1;
+
+      if (l == NULL)
+         sim_free (cpu);
+   }
+
+   if (bench) {
+      if (secs <= 0.0)
+         secs = 1.0 / CLOCKS_PER_SEC;
+
+      printf ("%.3f s: %.1f MIPS, %.1f emulated MHz in all\n", secs,
+              insns / secs / 1e6, cycles / secs / 1e6);
+   }
+
+   if (l != NULL) {
+      sim_free (cpu);
+      lanes_free (l);
+   }
+
+   return (status);
+}
+
+
+struct Cpu *load (file, start, loadaddr)
+const char *file;
+long start;
+const long loadaddr;
+{
+   struct Cpu *cpu;
+   FILE *fp;
+   int bad;
+
+   fp = fopen (file, READBIN);
+   if (fp == NULL) {
+      fputs (file, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   if ((cpu = sim_new ()) == NULL) {
+      fputs ("sim6502: out of memory\n", stderr);
+      exit (1);
+   }
+
+   bad = sim_load (cpu, fp, loadaddr);
+   fclose (fp);
+
+   if (bad != 0)
+      fprintf (stderr, "%s: %d bad records\n", file, bad);
+
+   if (cpu->Highaddr < 0) {
+      fprintf (stderr, "%s: nothing to run\n", file);
+      exit (1);
+   }
+
+   /* Start at '-s', else through the reset vector, else at the bottom */
+   if (start == ERR && !cpu->Vecset)
+      start = cpu->Lowaddr;
+
+   sim_reset (cpu, start);
+
+   return (cpu);
+}
+
+
+/* show --- print why the simulation stopped, and the registers */
+
+void show (cpu)
+const struct Cpu *cpu;
+{
+   unsigned char p;
+   static const char flags[] = "NV-BDIZC";
+   char f[9];
+   int i;
+
+   p = sim_status (cpu);
+
+   for (i = 0; i < 8; i++)
+      f[i] = (p & (0x80 >> i)) ? flags[i] : '.';
+
+   f[8] = EOS;
+
+   printf ("%s at %04X\n", Stopname[cpu->Stop], cpu->Pc);
+   printf ("A=%02X X=%02X Y=%02X S=%02X P=%02X %s\n",
+           cpu->A, cpu->X, cpu->Y, cpu->S, p, f);
+   printf ("%lu instructions, %lu cycles\n", cpu->Insns, cpu->Cycles);
+}
+
+
+/* map --- set up the devices from a memory map */
+
+void map (cpu, file, input)
+struct Cpu *cpu;
+const char *file;
+const char *input;
+{
+   struct Device *dev;
+   FILE *fp, *in;
+   int bad;
+
+   if ((fp = fopen (file, READ)) == NULL) {
+      fputs (file, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   bad = sim_map (cpu, fp);
+   fclose (fp);
+
+   if (bad != 0)
+      fprintf (stderr, "%s: %d lines not understood\n", file, bad);
+
+   if (input == NULL)
+      return;
+
+   if ((in = fopen (input, READBIN)) == NULL) {
+      fputs (input, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   for (dev = cpu->Devices; dev != NULL; dev = dev->Next)
+      if (dev->Kind == DEV_ACIA)
+         dev->In = in;     /* Shared, if there are two */
+}
+
+
+/* leds --- show the front-panel LEDs, lowest address first */
+
+void leds (cpu)
+const struct Cpu *cpu;
+{
+   const struct Device *dev;
+   int page, i;
+
+   for (page = 0; page < NPAGES; page++) {
+      if ((dev = cpu->Wdev[page]) == NULL || dev->Kind != DEV_LED)
+         continue;
+
+      printf ("LED %04X ", dev->Base);
+
+      for (i = 7; i >= 0; i--)
+         putchar ((dev->Reg[0] & (1 << i)) ? '*' : '.');
+
+      putchar ('\n');
+   }
+}
+
+
+/* usage --- print a usage message and exit */
+
+void usage ()
+{
+   fputs ("Usage: sim6502 [-s start] [-l loadaddr] [-c maxcycles] [-i] [-I] [-B] [-p listing] [-M map [-a input]] file\n", stderr);
+   fputs ("       sim6502 -m [-s start] [-l loadaddr] [-c maxcycles] [-i] [-B] file...\n", stderr);
+   exit (1);
+}
@@ -0,0 +1,354 @@
+/* Definitions for the 6502 simulator                               */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems   */
+
+/* Needs ../asm/as6502.h first, for the addressing modes */
+
+#define MEMSIZE      65536L      /* Whole of the 6502's address space */
+#define NPAGES       256         /* Pages of 256 bytes, as snapshots keep them */
+#define STACKPAGE    0x0100
+#define NMIVEC       0xfffa
+#define RESETVEC     0xfffc
+#define IRQVEC       0xfffe
+
+#define READBIN      "rb"
+
+#define BYTE(v)      ((v) & 0xff)
+#define WORD(v)      ((v) & 0xffff)
+#define CROSSES(a, b) (((a) ^ (b)) & 0xff00)    /* Different pages */
+
+/* Bits in the processor status register */
+
+#define P_C          0x01
+#define P_Z          0x02
+#define P_I          0x04
+#define P_D          0x08
+#define P_B          0x10
+#define P_U          0x20        /* Always reads as one */
+#define P_V          0x40
+#define P_N          0x80
+
+/* Operations, in the same order as Simops[] */
+
+#define I_ADC   0
+#define I_AND   1
+#define I_ASL   2
+#define I_BCC   3
+#define I_BCS   4
+#define I_BEQ   5
+#define I_BIT   6
+#define I_BMI   7
+#define I_BNE   8
+#define I_BPL   9
+#define I_BRK  10
+#define I_BVC  11
+#define I_BVS  12
+#define I_CLC  13
+#define I_CLD  14
+#define I_CLI  15
+#define I_CLV  16
+#define I_CMP  17
+#define I_CPX  18
+#define I_CPY  19
+#define I_DEC  20
+#define I_DEX  21
+#define I_DEY  22
+#define I_EOR  23
+#define I_INC  24
+#define I_INX  25
+#define I_INY  26
+#define I_JMP  27
+#define I_JSR  28
+#define I_LDA  29
+#define I_LDX  30
+#define I_LDY  31
+#define I_LSR  32
+#define I_NOP  33
+#define I_ORA  34
+#define I_PHA  35
+#define I_PHP  36
+#define I_PLA  37
+#define I_PLP  38
+#define I_ROL  39
+#define I_ROR  40
+#define I_RTI  41
+#define I_RTS  42
+#define I_SBC  43
+#define I_SEC  44
+#define I_SED  45
+#define I_SEI  46
+#define I_STA  47
+#define I_STX  48
+#define I_STY  49
+#define I_TAX  50
+#define I_TAY  51
+#define I_TSX  52
+#define I_TXA  53
+#define I_TXS  54
+#define I_TYA  55
+#define I_ILL  56                /* Not an NMOS 6502 instruction */
+#define NSIMOPS 57
+
+/* Why the simulator stopped */
+
+#define STOP_NONE    0           /* Still running */
+#define STOP_BRK     1           /* BRK, with Brkhalt set */
+#define STOP_ILLEGAL 2           /* Opcode that isn't in the table */
+#define STOP_LOOP    3           /* Jump or branch to itself */
+#define STOP_LIMIT   4           /* Ran for as many cycles as it was allowed */
+#define STOP_MEMORY  5           /* No memory for decoded blocks */
+
+/* Operations that store at the effective address, unless on the accumulator */
+#define STORES(op)   ((op) == I_STA || (op) == I_STX || (op) == I_STY || (op) == I_INC || \
+                      (op) == I_DEC || (op) == I_ASL || (op) == I_LSR || (op) == I_ROL || (op) == I_ROR)
+
+/* Operations that read from it, of those that have one */
+#define LOADS(op)    ((op) != I_STA && (op) != I_STX && (op) != I_STY && (op) != I_JMP && (op) != I_JSR)
+
+/* Kinds of device in the memory map */
+
+#define DEV_RAM      0           /* Plain memory, not a device at all */
+#define DEV_ROM      1           /* Reads as memory, ignores stores */
+#define DEV_ACIA     2           /* 6551 serial port */
+#define DEV_LED      3           /* Front-panel LEDs */
+#define DEV_LATCH    4           /* Stand-in that reads back what was stored */
+#define DEV_BAUD     5           /* Baud-rate generator, for an ACIA on its external clock */
+#define DEV_TIMER    6           /* Interval timer */
+#define NDEVKINDS    7
+
+/* The sooner of 'end' and the next event */
+#define DEADLINE(cpu, end) ((cpu)->Nevents > 0 && (cpu)->Events[0].When < (end) ? \
+                            (cpu)->Events[0].When : (end))
+
+#define MAXRUN     32          /* Instructions in a decoded block, so it spans two pages at most */
+
+struct Decode {                  /* What each of the 256 opcodes does */
+   unsigned char Op;             /* I_ADC, etc. */
+   unsigned char Mode;           /* INHERENT, etc. */
+   unsigned char Len;            /* Bytes in the instruction */
+   unsigned char Cyc;            /* Cycles, before any penalty */
+   unsigned char Page;           /* A cycle more if indexing crosses a page */
+};
+
+struct Cpu;
+struct Insn;
+struct Device;
+
+#ifdef __STDC__
+typedef int (*Handler) (struct Cpu *cpu, const struct Insn *ip);
+typedef int (*Reader) (struct Device *dev, unsigned int addr, unsigned long now);
+typedef void (*Writer) (struct Device *dev, unsigned int addr, unsigned int byte, unsigned long now);
+typedef void (*Firer) (struct Device *dev, unsigned long when);
+#else
+typedef int (*Handler) ();
+typedef int (*Reader) ();
+typedef void (*Writer) ();
+typedef void (*Firer) ();
+#endif   /* __STDC__ */
+
+struct Insn {                    /* One pre-decoded instruction */
+   Handler Fn;                   /* Does the work; non-zero to leave the block */
+   unsigned short Arg;           /* Operand, address, or branch destination */
+   unsigned short Addr;          /* Address of the instruction itself */
+   unsigned short Next;          /* Address of the following instruction */
+   unsigned short Sofar;         /* Cycles in the block, up to and including this */
+   unsigned char Count;          /* Instructions likewise */
+   unsigned char Cyc;            /* Cycles for this one, before any penalty */
+   unsigned char Page;           /* A cycle more if indexing crosses a page */
+};
+
+struct Block {                   /* Straight-line code, decoded once and cached */
+   unsigned int Start;           /* Address of the first byte */
+   unsigned int Last;            /* and of the last */
+   struct Block *Link[2];        /* Next on the list for each page it covers */
+   struct Block *Dead;           /* Next waiting to be freed */
+   unsigned int Most;            /* Cycles it could take, with every penalty */
+   struct Insn Insn[MAXRUN + 1];
+};
+
+struct Cache {                   /* All the decoded blocks of one 6502 */
+   struct Block *At[MEMSIZE];    /* Block starting at each address */
+   struct Block *Page[256];      /* Blocks covering each page */
+   unsigned char Code[MEMSIZE];  /* How many blocks cover each byte */
+   struct Block *Dead;           /* Invalidated, to be freed between blocks */
+};
+
+struct Profile {                 /* Where the time went */
+   unsigned long Count[MEMSIZE]; /* Times the instruction at each address was run */
+   unsigned long Cycles[MEMSIZE];   /* and the cycles it took, with any penalties */
+};
+
+struct Device {                  /* Something in a page of the memory map */
+   int     Kind;                 /* DEV_ACIA, etc. */
+   unsigned int Base;            /* Address of the page */
+   struct Cpu *Cpu;              /* 6502 that it belongs to */
+   Reader  Read;                 /* NULL if reads come from memory */
+   Writer  Write;
+   unsigned char Reg[4];         /* Its registers */
+   int     Rx;                   /* ACIA: byte received, or EOF */
+   int     Tx;                   /* ACIA: byte still being sent, or EOF */
+   int     Txout;                /* ACIA: Tx has been put to 'Out' already, by sim_drain() */
+   int     Rxon;                 /* ACIA: receiving in time with the baud rate */
+   int     Irq;                  /* Holding the IRQ line down */
+   FILE    *In;                  /* ACIA: where bytes come from, or NULL */
+   FILE    *Out;                 /* ACIA: where they go; LED: trace of changes, or NULL */
+   struct Device *Next;          /* All the devices of the 6502 */
+};
+
+struct Event {                   /* Something a device has to do at a given cycle */
+   unsigned long When;           /* Cycle count it is due at */
+   Firer   Fire;
+   struct Device *Dev;
+};
+
+struct Page {                    /* One page of memory in a snapshot */
+   int     Refs;                 /* Snapshots sharing it */
+   unsigned char Byte[256];
+};
+
+struct Snapshot {                /* Saved state of a 6502, sharing unchanged pages */
+   int     Refs;                 /* Holders, and 6502s based on it */
+   struct Page *Page[NPAGES];
+   unsigned int Pc;
+   unsigned char A, X, Y, S, P;
+   unsigned long Cycles;
+   unsigned long Insns;
+   int     Stop;
+   long    Lowaddr;
+   long    Highaddr;
+   int     Vecset;
+};
+
+struct Cpu {                     /* One simulated 6502 and its memory */
+   unsigned char *Mem;           /* 64K of RAM */
+   unsigned int Pc;
+   unsigned char A, X, Y, S, P;
+   unsigned char Nflag, Zflag;   /* Results that give N and Z, while running */
+   unsigned char Cflag, Vflag;   /* The other flags, likewise */
+   unsigned char Dflag, Iflag;
+   struct Cache *Cache;          /* Decoded blocks, made when first run */
+   unsigned char *Codemap;       /* Cache->Code, for checking stores */
+   int     Stale;                /* Memory changed without checking the cache */
+   struct Profile *Prof;         /* Counts, when profiling */
+   unsigned long Cycles;         /* Since reset */
+   unsigned long Insns;          /* Instructions since reset */
+   int     Stop;                 /* STOP_BRK, etc. */
+   int     Brkhalt;              /* BRK stops the simulation */
+   long    Lowaddr;              /* Range of addresses loaded */
+   long    Highaddr;
+   unsigned char *Loaded;        /* If not NULL, marks each byte that was loaded */
+   int     Vecset;               /* Reset vector was loaded */
+   struct Snapshot *Base;        /* Last snapshot taken or restored, or NULL */
+   unsigned char Dirty[NPAGES];  /* Pages stored to since then */
+   struct Device *Devices;       /* In the memory map, or NULL if it's all RAM */
+   struct Device *Rdev[NPAGES];  /* Device that reads from each page go to, or NULL */
+   struct Device *Wdev[NPAGES];  /* Device that stores go to, or NULL */
+   struct Event *Events;         /* Pending, as a heap with the soonest first */
+   int     Nevents;
+   int     Maxevents;
+   int     Irqs;                 /* Devices holding the IRQ line down */
+};
+
+#define LANEWIDTH    64          /* Lanes whose memory is interleaved */
+
+struct Lanes {                   /* Many 6502s run in lockstep, a register to an array */
+   int     N;                    /* Number of lanes */
+   int     Brkhalt;              /* BRK stops a lane */
+   unsigned char *Mem;           /* 64K for each lane, interleaved LANEWIDTH at a time */
+   unsigned int *Pc;
+   unsigned char *A, *X, *Y, *S;
+   unsigned char *Nflag, *Zflag; /* As in struct Cpu */
+   unsigned char *Cflag, *Vflag;
+   unsigned char *Dflag, *Iflag;
+   unsigned long *Cycles;
+   unsigned long *Insns;
+   unsigned long Steps;          /* Instructions decoded, once for a whole group */
+   unsigned long *Limit;         /* Cycles at which each lane stops */
+   unsigned char *Stop;          /* STOP_BRK, etc. */
+   unsigned char *Used;          /* Lane has had a 6502 put in it */
+   unsigned char *Wait;          /* Lanes of a chunk waiting at each address */
+   unsigned char *Same;          /* Each byte is the same in every lane of the chunk */
+   int     Nchunk;               /* Lanes in the chunk */
+   int     Group[LANEWIDTH];     /* Lanes of a chunk running together */
+   int     Ngroup;
+   unsigned int Ea[LANEWIDTH];   /* Effective address for each in Group[] */
+};
+
+extern struct Decode Decode[256];
+extern const char Simops[NSIMOPS][4];
+extern const char *Devname[NDEVKINDS];
+
+#ifdef __STDC__
+void sim_init (void);
+struct Cpu *sim_new (void);
+void sim_free (struct Cpu *cpu);
+void sim_reset (struct Cpu *cpu, long start);
+void sim_clear (struct Cpu *cpu);
+int sim_run (struct Cpu *cpu, unsigned long maxcycles);
+int sim_interp (struct Cpu *cpu, unsigned long maxcycles);
+void sim_poke (struct Cpu *cpu, long addr, int byte);
+void sim_flush (struct Cpu *cpu);
+int sim_profile (struct Cpu *cpu);
+void sim_annotate (const struct Cpu *cpu, FILE *lst, FILE *out);
+int sim_load (struct Cpu *cpu, FILE *fp, long addr);
+unsigned char sim_status (const struct Cpu *cpu);
+struct Snapshot *sim_snapshot (struct Cpu *cpu);
+void sim_restore (struct Cpu *cpu, struct Snapshot *snap);
+struct Cpu *sim_fork (struct Snapshot *snap);
+void sim_release (struct Snapshot *snap);
+int sim_map (struct Cpu *cpu, FILE *fp);
+struct Device *sim_attach (struct Cpu *cpu, long addr, int kind);
+int sim_schedule (struct Cpu *cpu, unsigned long when, Firer fire, struct Device *dev);
+void sim_cancel (struct Cpu *cpu, const struct Device *dev);
+void sim_irq (struct Device *dev, int on);
+void sim_drain (struct Cpu *cpu);
+struct Lanes *lanes_new (int n);
+void lanes_free (struct Lanes *l);
+void lanes_put (struct Lanes *l, int i, const struct Cpu *cpu);
+void lanes_get (const struct Lanes *l, int i, struct Cpu *cpu);
+int lanes_peek (const struct Lanes *l, int i, long addr);
+int lanes_run (struct Lanes *l, unsigned long maxcycles);
+
+void init_handlers (void);    /* Inside the library */
+void adc (struct Cpu *cpu, unsigned int m);
+void sbc (struct Cpu *cpu, unsigned int m);
+void free_devices (struct Cpu *cpu);
+void reset_devices (struct Cpu *cpu);
+void fire_events (struct Cpu *cpu);
+#else
+void sim_init ();
+struct Cpu *sim_new ();
+void sim_free ();
+void sim_reset ();
+void sim_clear ();
+int sim_run ();
+int sim_interp ();
+void sim_poke ();
+void sim_flush ();
+int sim_profile ();
+void sim_annotate ();
+int sim_load ();
+unsigned char sim_status ();
+struct Snapshot *sim_snapshot ();
+void sim_restore ();
+struct Cpu *sim_fork ();
+void sim_release ();
+int sim_map ();
+struct Device *sim_attach ();
+int sim_schedule ();
+void sim_cancel ();
+void sim_irq ();
+void sim_drain ();
+struct Lanes *lanes_new ();
+void lanes_free ();
+void lanes_put ();
+void lanes_get ();
+int lanes_peek ();
+int lanes_run ();
+
+void init_handlers ();
+void adc ();
+void sbc ();
+void free_devices ();
+void reset_devices ();
+void fire_events ();
+#endif   /* __STDC__ */
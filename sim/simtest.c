@@ -0,0 +1,443 @@
+/* simtest --- run random programs each way and compare    2026-10-18 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Fills memory with random op-codes and runs it, once one instruction
+ * at a time with sim_interp() and once from decoded blocks with
+ * sim_run().  Both must stop at the same place, for the same reason,
+ * with the same registers, cycle count and memory.  Then it does the
+ * same for lanes run in lockstep, half of them sharing a program but
+ * not its data, each against sim_interp() on its own.  It takes a
+ * snapshot part of the way through a run and runs on from it, forked,
+ * put back and put back again, which must each end as a run straight
+ * through does.  Last, it runs images with devices in the memory map
+ * both ways, starting with code that sets the timers and the ACIA
+ * going, so that events fire and interrupts are taken all through the
+ * run; the devices must end the same too.  The images come from a
+ * generator of our own, so every run tests the same programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#define DEFROUNDS    200         /* Random images of each kind */
+#define RUNCYCLES    2000000UL   /* Cycles for sim_run() */
+#define INTERPCYCLES 20000000UL  /* More, in case sim_run() stops early */
+#define NLANES       64          /* Lanes in each round of lockstep */
+#define LANEROUNDS   20          /* Rounds of images for each round of lanes */
+#define LANECYCLES   300000UL
+#define SNAPCYCLES   100000UL    /* Where to take the snapshot */
+#define DEVCYCLES    300000UL
+#define DEVPAGE      0x20        /* Zero-page pointers aim at the 8 pages from here */
+#define MAXBAD       10          /* Give up after this many */
+
+unsigned long Seed;              /* State of the generator */
+int     Nbad;                    /* Differences found */
+
+const int Devpage[8] = {         /* Devices the zero-page pointers aim at */
+   DEV_ROM, DEV_LATCH, DEV_TIMER, DEV_LATCH, DEV_ACIA, DEV_LED, DEV_TIMER, DEV_BAUD
+};
+
+#define RANDOM       0x100       /* In Setup[], any byte */
+#define NSETUP       9
+
+const unsigned int Setup[NSETUP][2] = {   /* Stores that start those devices: address, byte */
+   { (DEVPAGE + 2) << 8, RANDOM },  /* Timer, every 256 to 511 cycles, interrupting */
+   { ((DEVPAGE + 2) << 8) + 1, 0x01 },
+   { ((DEVPAGE + 2) << 8) + 2, 0x81 },
+   { (DEVPAGE + 6) << 8, RANDOM },  /* Timer, every 255 cycles or less, quietly */
+   { ((DEVPAGE + 6) << 8) + 1, 0x00 },
+   { ((DEVPAGE + 6) << 8) + 2, 0x01 },
+   { (DEVPAGE + 7) << 8, RANDOM },  /* Baud-rate generator */
+   { ((DEVPAGE + 4) << 8) + 3, 0x1f },    /* ACIA at 19200 baud */
+   { ((DEVPAGE + 4) << 8) + 2, 0x05 }     /* with interrupts to send */
+};
+
+#ifdef __STDC__
+int main (int argc, const char * *argv);
+void try_run (int rounds);
+void try_lanes (int rounds);
+void try_snapshots (int rounds);
+void try_devices (int rounds);
+void random_devices (struct Cpu *cpu, unsigned long seed);
+int same_devices (long seed, const struct Cpu *a, const struct Cpu *b);
+void random_cpu (struct Cpu *cpu, unsigned long seed);
+int same (const char *what, long seed, const struct Cpu *a, const struct Cpu *b);
+unsigned int rnd (void);
+#else
+#define const
+int main ();
+void try_run ();
+void try_lanes ();
+void try_snapshots ();
+void try_devices ();
+void random_devices ();
+int same_devices ();
+void random_cpu ();
+int same ();
+unsigned int rnd ();
+#endif   /* __STDC__ */
+
+int main (argc, argv)
+const int argc;
+const char *argv[];
+{
+   int rounds;
+
+   if (argc > 2) {
+      fputs ("Usage: simtest [rounds]\n", stderr);
+      exit (2);
+   }
+
+   rounds = (argc > 1) ? atoi (argv[1]) : DEFROUNDS;
+
+   sim_init ();
+
+   try_run (rounds);
+   try_lanes ((rounds + LANEROUNDS - 1) / LANEROUNDS);
+   try_snapshots (rounds);
+   try_devices (rounds);
+
+   if (Nbad > 0)
+      printf ("simtest: %d differences\n", Nbad);
+
+   return (Nbad > 0);
+}
+
+
+/* try_run --- compare sim_run() with sim_interp() on random images */
+
+void try_run (rounds)
+const int rounds;
+{
+   struct Cpu *a, *b;
+   int r;
+
+   for (r = 1; r <= rounds && Nbad < MAXBAD; r++) {
+      if ((a = sim_new ()) == NULL || (b = sim_new ()) == NULL) {
+         fputs ("simtest: out of memory\n", stderr);
+         exit (2);
+      }
+
+      random_cpu (a, r);
+      random_cpu (b, r);
+
+      sim_run (b, RUNCYCLES);
+      sim_interp (a, (b->Stop == STOP_LIMIT) ? b->Cycles : INTERPCYCLES);
+
+      same ("sim_run", r, a, b);
+
+      sim_free (a);
+      sim_free (b);
+   }
+}
+
+
+/* try_lanes --- compare lanes_run() with sim_interp() on each lane */
+
+void try_lanes (rounds)
+const int rounds;
+{
+   struct Lanes *l;
+   struct Cpu *cpu[NLANES];
+   struct Cpu *o;
+   unsigned long seed;
+   long addr;
+   int r, i;
+
+   for (r = 1; r <= rounds && Nbad < MAXBAD; r++) {
+      if ((l = lanes_new (NLANES)) == NULL || (o = sim_new ()) == NULL) {
+         fputs ("simtest: out of memory\n", stderr);
+         exit (2);
+      }
+
+      l->Brkhalt = r & 1;
+
+      for (i = 0; i < NLANES; i++) {
+         if ((cpu[i] = sim_new ()) == NULL) {
+            fputs ("simtest: out of memory\n", stderr);
+            exit (2);
+         }
+
+         seed = (unsigned long)r * NLANES + i;
+
+         if (i & 1)
+            random_cpu (cpu[i], seed);
+         else {            /* The same program, with other data */
+            random_cpu (cpu[i], r);
+            Seed = seed;
+
+            for (addr = 0L; addr < 0x100L; addr++)
+               cpu[i]->Mem[addr] = rnd () & 0xff;
+
+            cpu[i]->A = rnd () & 0xff;
+            cpu[i]->X = rnd () & 0xff;
+         }
+
+         cpu[i]->Brkhalt = l->Brkhalt;
+         lanes_put (l, i, cpu[i]);
+      }
+
+      lanes_run (l, LANECYCLES);
+
+      for (i = 0; i < NLANES; i++) {
+         lanes_get (l, i, o);
+
+         for (addr = 0L; addr < MEMSIZE; addr++)
+            o->Mem[addr] = lanes_peek (l, i, addr);
+
+         sim_interp (cpu[i], (o->Stop == STOP_LIMIT) ? o->Cycles : INTERPCYCLES);
+
+         same ("lanes_run", (long)r * NLANES + i, cpu[i], o);
+         sim_free (cpu[i]);
+      }
+
+      sim_free (o);
+      lanes_free (l);
+   }
+}
+
+
+/* try_snapshots --- run on from a snapshot in each way, and compare with a run straight through */
+
+void try_snapshots (rounds)
+const int rounds;
+{
+   struct Snapshot *snap;
+   struct Cpu *a, *b;
+   int r;
+
+   for (r = 1; r <= rounds && Nbad < MAXBAD; r++) {
+      if ((a = sim_new ()) == NULL) {
+         fputs ("simtest: out of memory\n", stderr);
+         exit (2);
+      }
+
+      random_cpu (a, r);
+      sim_run (a, SNAPCYCLES);
+
+      if ((snap = sim_snapshot (a)) == NULL || (b = sim_fork (snap)) == NULL) {
+         fputs ("simtest: out of memory\n", stderr);
+         exit (2);
+      }
+
+      sim_run (a, RUNCYCLES);       /* Straight on */
+
+      b->Brkhalt = a->Brkhalt;
+      sim_run (b, RUNCYCLES);
+      same ("sim_fork", r, a, b);
+
+      sim_restore (b, snap);        /* Its decoded blocks must not be stale */
+      sim_run (b, RUNCYCLES);
+      same ("sim_restore", r, a, b);
+
+      sim_restore (b, snap);
+      sim_interp (b, (a->Stop == STOP_LIMIT) ? a->Cycles - b->Cycles : INTERPCYCLES);
+      same ("sim_restore, then sim_interp", r, a, b);
+
+      sim_release (snap);
+      sim_free (a);
+      sim_free (b);
+   }
+}
+
+
+/* try_devices --- compare sim_run() with sim_interp() with devices in the map */
+
+void try_devices (rounds)
+const int rounds;
+{
+   struct Cpu *a, *b;
+   int r;
+
+   for (r = 1; r <= rounds && Nbad < MAXBAD; r++) {
+      if ((a = sim_new ()) == NULL || (b = sim_new ()) == NULL) {
+         fputs ("simtest: out of memory\n", stderr);
+         exit (2);
+      }
+
+      random_devices (a, r);
+      random_devices (b, r);
+
+      sim_run (b, DEVCYCLES);
+      sim_interp (a, (b->Stop == STOP_LIMIT) ? b->Cycles : INTERPCYCLES);
+
+      if (same ("devices", r, a, b))
+         same_devices (r, a, b);
+
+      sim_free (a);
+      sim_free (b);
+   }
+}
+
+
+/* random_devices --- a random image, with devices in random pages and pointers to them */
+
+void random_devices (cpu, seed)
+struct Cpu *cpu;
+const unsigned long seed;
+{
+   struct Device *dev;
+   unsigned int pc;
+   long addr;
+   int page, i;
+
+   random_cpu (cpu, seed);
+   Seed = seed;
+
+   for (addr = 0L; addr < 0x100L; addr++)
+      if (rnd () & 1)
+         cpu->Mem[addr] = DEVPAGE + (rnd () & 7);
+      else
+         cpu->Mem[addr] = rnd () & 0xff;
+
+   for (page = 2; page < NPAGES; page++) {
+      switch (rnd () % 8) {
+      case 0:
+         sim_attach (cpu, (long)page << 8, DEV_ROM);
+         break;
+      case 1:
+         sim_attach (cpu, (long)page << 8, DEV_LATCH);
+         break;
+      case 2:
+         sim_attach (cpu, (long)page << 8, DEV_LED);
+         break;
+      case 3:
+         if ((rnd () & 7) == 0)
+            sim_attach (cpu, (long)page << 8, DEV_ACIA);
+         break;
+      case 4:
+         if ((rnd () & 3) == 0)     /* Events, and interrupts */
+            sim_attach (cpu, (long)page << 8, (rnd () % 3 == 0) ? DEV_BAUD : DEV_TIMER);
+         break;
+      }
+   }
+
+   for (page = 0; page < 8; page++)
+      sim_attach (cpu, (long)(DEVPAGE + page) << 8, Devpage[page]);
+
+   pc = cpu->Pc;        /* Start the timers and the ACIA, then go on at random */
+
+   for (i = 0; i < NSETUP; i++) {
+      cpu->Mem[WORD (pc)] = 0xa9;            /* LDA # */
+      cpu->Mem[WORD (pc + 1)] = (Setup[i][1] == RANDOM) ? rnd () & 0xff : Setup[i][1];
+      cpu->Mem[WORD (pc + 2)] = 0x8d;        /* STA abs */
+      cpu->Mem[WORD (pc + 3)] = Setup[i][0] & 0xff;
+      cpu->Mem[WORD (pc + 4)] = Setup[i][0] >> 8;
+      pc += 5;
+   }
+
+   cpu->Mem[WORD (pc)] = 0x58;               /* CLI */
+
+   for (dev = cpu->Devices; dev != NULL; dev = dev->Next)
+      dev->Out = NULL;
+}
+
+
+/* same_devices --- check that the devices of two 6502s ended up the same */
+
+int same_devices (seed, a, b)
+const long seed;
+const struct Cpu *a;
+const struct Cpu *b;
+{
+   const struct Device *d, *e;
+
+   for (d = a->Devices, e = b->Devices; d != NULL && e != NULL; d = d->Next, e = e->Next)
+      if (memcmp (d->Reg, e->Reg, sizeof (d->Reg)) != 0 || d->Rx != e->Rx || d->Tx != e->Tx ||
+          d->Irq != e->Irq)
+         break;
+
+   if (d == NULL && e == NULL && a->Nevents == b->Nevents && a->Irqs == b->Irqs)
+      return (YES);
+
+   printf ("devices, seed %ld: ", seed);
+
+   if (d != NULL && e != NULL)
+      printf ("%s at %04X differs\n", Devname[d->Kind], d->Base);
+   else
+      printf ("events %d/%d IRQs %d/%d\n", a->Nevents, b->Nevents, a->Irqs, b->Irqs);
+
+   Nbad++;
+
+   return (NO);
+}
+
+
+/* random_cpu --- fill memory and registers from the generator, seeded by 'seed' */
+
+void random_cpu (cpu, seed)
+struct Cpu *cpu;
+const unsigned long seed;
+{
+   long addr;
+   unsigned int op;
+
+   Seed = seed;
+
+   for (addr = 0L; addr < MEMSIZE; addr++) {
+      op = rnd () & 0xff;
+
+      if (Decode[op].Op == I_ILL && (rnd () & 0xff) != 0)
+         op = 0xea;        /* NOP; keep an odd one, to stop on */
+      else if (Decode[op].Op == I_BRK && (rnd () & 7) != 0)
+         op = 0xa9;        /* LDA #, so BRK is rare too */
+
+      cpu->Mem[addr] = op;
+   }
+
+   sim_reset (cpu, rnd () & 0xffff);
+
+   cpu->Brkhalt = seed & 1;   /* Or BRK goes through the vector */
+   cpu->P = rnd () & 0xff;
+   cpu->A = rnd () & 0xff;
+   cpu->X = rnd () & 0xff;
+   cpu->Y = rnd () & 0xff;
+}
+
+
+/* same --- check that two 6502s ended up the same, and say how if not */
+
+int same (what, seed, a, b)
+const char *what;
+const long seed;
+const struct Cpu *a;
+const struct Cpu *b;
+{
+   long addr;
+
+   for (addr = 0L; addr < MEMSIZE; addr++)
+      if (a->Mem[addr] != b->Mem[addr])
+         break;
+
+   if (a->Stop == b->Stop && a->Pc == b->Pc && a->A == b->A && a->X == b->X &&
+       a->Y == b->Y && a->S == b->S && (a->P | 0x30) == (b->P | 0x30) &&
+       a->Cycles == b->Cycles && a->Insns == b->Insns && addr == MEMSIZE)
+      return (YES);
+
+   printf ("%s, seed %ld: stop %d/%d PC=%04X/%04X A=%02X/%02X X=%02X/%02X Y=%02X/%02X ",
+           what, seed, a->Stop, b->Stop, a->Pc, b->Pc, a->A, b->A, a->X, b->X, a->Y, b->Y);
+   printf ("S=%02X/%02X P=%02X/%02X cycles %lu/%lu insns %lu/%lu",
+           a->S, b->S, a->P, b->P, a->Cycles, b->Cycles, a->Insns, b->Insns);
+
+   if (addr < MEMSIZE)
+      printf (" memory at %04lX", addr);
+
+   putchar ('\n');
+   Nbad++;
+
+   return (NO);
+}
+
+
+/* rnd --- the next number from the generator, the rand() of the C standard */
+
+unsigned int rnd ()
+{
+   Seed = (Seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+
+   return ((Seed >> 16) & 0x7fff);
+}
@@ -0,0 +1,234 @@
+/* snapshot --- copy-on-write snapshots of a 6502          2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* A snapshot keeps memory as 256 pages, and shares each page with the
+ * snapshot before it unless a store has hit that page since.  Taking a
+ * snapshot copies only the dirty pages, and so does going back to one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "as6502.h"
+#include "sim6502.h"
+
+#ifdef __STDC__
+struct Page *new_page (const unsigned char *mem);
+void hold_page (struct Page *pg);
+void release_page (struct Page *pg);
+void put_page (struct Cpu *cpu, unsigned int page, const unsigned char *bytes);
+void put_regs (struct Cpu *cpu, const struct Snapshot *snap);
+void rebase (struct Cpu *cpu, struct Snapshot *snap);
+#else
+#define const
+struct Page *new_page ();
+void hold_page ();
+void release_page ();
+void put_page ();
+void put_regs ();
+void rebase ();
+#endif   /* __STDC__ */
+
+
+/* sim_snapshot --- save the state of a 6502, copying only the pages it has changed */
+
+struct Snapshot *sim_snapshot (cpu)
+struct Cpu *cpu;
+{
+   struct Snapshot *snap;
+   struct Page *old;
+   unsigned char *mem;
+   int p;
+
+   snap = calloc (1, sizeof (struct Snapshot));
+   if (snap == NULL)
+      return (NULL);
+
+   snap->Refs = 1;   /* For the caller */
+
+   for (p = 0; p < NPAGES; p++) {
+      mem = cpu->Mem + (p << 8);
+      old = (cpu->Base != NULL) ? cpu->Base->Page[p] : NULL;
+
+      /* A page that was stored to may still hold what it did */
+      if (old != NULL && (!cpu->Dirty[p] || memcmp (old->Byte, mem, 256) == 0)) {
+         hold_page (old);
+         snap->Page[p] = old;
+      }
+      else if ((snap->Page[p] = new_page (mem)) == NULL) {
+         while (--p >= 0)
+            release_page (snap->Page[p]);
+
+         free (snap);
+         return (NULL);
+      }
+   }
+
+   snap->Pc = cpu->Pc;
+   snap->A = cpu->A;
+   snap->X = cpu->X;
+   snap->Y = cpu->Y;
+   snap->S = cpu->S;
+   snap->P = cpu->P;
+   snap->Cycles = cpu->Cycles;
+   snap->Insns = cpu->Insns;
+   snap->Stop = cpu->Stop;
+   snap->Lowaddr = cpu->Lowaddr;
+   snap->Highaddr = cpu->Highaddr;
+   snap->Vecset = cpu->Vecset;
+
+   rebase (cpu, snap);
+
+   return (snap);
+}
+
+
+/* sim_restore --- put a 6502 back as it was in a snapshot, copying only the pages that differ */
+
+void sim_restore (cpu, snap)
+struct Cpu *cpu;
+struct Snapshot *snap;
+{
+   const struct Snapshot *base = cpu->Base;
+   int p;
+
+   for (p = 0; p < NPAGES; p++)
+      if (base == NULL || cpu->Dirty[p] || base->Page[p] != snap->Page[p])
+         put_page (cpu, p, snap->Page[p]->Byte);
+
+   put_regs (cpu, snap);
+   rebase (cpu, snap);
+}
+
+
+/* sim_fork --- make a new 6502 as it was in a snapshot, or NULL */
+
+struct Cpu *sim_fork (snap)
+struct Snapshot *snap;
+{
+   struct Cpu *cpu;
+   int p;
+
+   if ((cpu = sim_new ()) == NULL)
+      return (NULL);
+
+   for (p = 0; p < NPAGES; p++)     /* Nothing is decoded yet, so just copy */
+      memcpy (cpu->Mem + (p << 8), snap->Page[p]->Byte, 256);
+
+   put_regs (cpu, snap);
+   rebase (cpu, snap);
+
+   return (cpu);
+}
+
+
+/* sim_release --- let go of a snapshot, freeing it when nobody holds it */
+
+void sim_release (snap)
+struct Snapshot *snap;
+{
+   int p;
+
+   if (__sync_sub_and_fetch (&snap->Refs, 1) != 0)
+      return;
+
+   for (p = 0; p < NPAGES; p++)
+      release_page (snap->Page[p]);
+
+   free (snap);
+}
+
+
+/* new_page --- a page holding a copy of 256 bytes of memory, or NULL */
+
+struct Page *new_page (mem)
+const unsigned char *mem;
+{
+   struct Page *pg;
+
+   if ((pg = malloc (sizeof (struct Page))) == NULL)
+      return (NULL);
+
+   pg->Refs = 1;
+   memcpy (pg->Byte, mem, 256);
+
+   return (pg);
+}
+
+
+/* hold_page --- share a page with another snapshot */
+
+void hold_page (pg)
+struct Page *pg;
+{
+   __sync_fetch_and_add (&pg->Refs, 1);   /* Forks may be on other threads */
+}
+
+
+/* release_page --- a snapshot no longer needs a page */
+
+void release_page (pg)
+struct Page *pg;
+{
+   if (__sync_sub_and_fetch (&pg->Refs, 1) == 0)
+      free (pg);
+}
+
+
+/* put_page --- copy a page into memory, dropping only the decoded code that changes */
+
+void put_page (cpu, page, bytes)
+struct Cpu *cpu;
+const unsigned int page;
+const unsigned char *bytes;
+{
+   unsigned char *mem = cpu->Mem + (page << 8);
+   int i;
+
+   if (cpu->Codemap == NULL || cpu->Stale) {
+      memcpy (mem, bytes, 256);
+      return;
+   }
+
+   for (i = 0; i < 256; i++)
+      if (mem[i] != bytes[i])
+         sim_poke (cpu, (page << 8) + i, bytes[i]);
+}
+
+
+/* put_regs --- registers, counts and load range from a snapshot */
+
+void put_regs (cpu, snap)
+struct Cpu *cpu;
+const struct Snapshot *snap;
+{
+   cpu->Pc = snap->Pc;
+   cpu->A = snap->A;
+   cpu->X = snap->X;
+   cpu->Y = snap->Y;
+   cpu->S = snap->S;
+   cpu->P = snap->P;
+   cpu->Cycles = snap->Cycles;
+   cpu->Insns = snap->Insns;
+   cpu->Stop = snap->Stop;
+   cpu->Lowaddr = snap->Lowaddr;
+   cpu->Highaddr = snap->Highaddr;
+   cpu->Vecset = snap->Vecset;
+}
+
+
+/* rebase --- memory now matches 'snap', so no page is dirty */
+
+void rebase (cpu, snap)
+struct Cpu *cpu;
+struct Snapshot *snap;
+{
+   __sync_fetch_and_add (&snap->Refs, 1);
+
+   if (cpu->Base != NULL)
+      sim_release (cpu->Base);
+
+   cpu->Base = snap;
+   memset (cpu->Dirty, NO, NPAGES);
+}
@@ -0,0 +1,900 @@
+/* test6502 --- run a directory of 6502 test programs      2026-10-17 */
+/* Copyright (c) 1983 John Honniball, Bambleweeny Computer Systems     */
+
+/* Each test is a program, as assembled or as source to assemble first,
+ * run in a 6502 of its own on a pool of threads.  A test passes if it
+ * stops at BRK or a loop with a zero in the result byte, and then only
+ * if it took no more cycles than it did last time.
+ */
+
+/* Modification:
+ * 2026-10-17 agent Start each test from a snapshot, with an optional ROM image
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "as6502.h"
+#include "libas6502.h"
+#include "sim6502.h"
+
+#define DEFCYCLES    100000000UL    /* Default cycle limit for each test */
+#define RESULTADDR   0xfff8         /* Where a test leaves zero for success */
+#define NOTDONE      0xff           /* Put there first, so a test must change it */
+#define MAXNAME      256
+
+struct Test {                    /* One test program */
+   char    *Name;                /* File name without its directory or extension */
+   char    *File;                /* Path to open */
+   int     Source;               /* Assemble it first */
+   int     Pass;
+   char    *Why;                 /* Reason for failing, or NULL */
+   int     Stop;                 /* STOP_BRK, etc. */
+   unsigned int Pc;              /* Where it stopped */
+   int     Result;               /* Result byte, or ERR */
+   unsigned long Cycles;
+   unsigned long Insns;
+   long    Baseline;             /* Cycles last time, or ERR */
+   char    *Msgs;                /* Assembler's messages */
+   size_t  Msglen;
+};
+
+struct Queue {                   /* Tests for one worker, which idle workers may steal */
+   pthread_mutex_t Lock;
+   long    Head;                 /* Thieves take from here */
+   long    Tail;                 /* The owner takes from here */
+};
+
+struct Worker {                  /* One thread of the pool */
+   int     Id;                   /* Its queue */
+   struct Cpu *Cpu;              /* Made before any thread starts */
+   struct Asm *As;
+};
+
+struct Base {                    /* One line of the baseline file */
+   char    *Name;
+   unsigned long Cycles;
+};
+
+struct Test *Test;               /* Tests, in order of name */
+long    Ntests, Maxtests;
+struct Queue *Queue;
+int     Nworkers;
+
+struct Base *Base;               /* Cycle counts from the baseline file */
+long    Nbase, Maxbase;
+
+unsigned long Maxcycles;         /* Options, for every test */
+long    Resultaddr;
+long    Loadaddr;
+int     Brkhalt;
+int     Slack;                   /* Percent over the baseline allowed */
+const char *Defs;                /* Definitions for every source */
+char    *Deftext;
+long    Deflen;
+const char *Rom;                 /* Image loaded under every test */
+struct Snapshot *Clean;          /* Memory before any test is loaded */
+
+#ifdef __STDC__
+int main (int argc, const char * *argv);
+void add_dir (const char *dir);
+void add_test (const char *dir, const char *file, int source);
+int by_name (const void *a, const void *b);
+void make_clean (void);
+void run_all (int nthreads);
+void *worker (void *arg);
+long take (int id);
+void run_test (struct Worker *w, struct Test *t);
+int from_source (struct Asm *as, struct Test *t, FILE * *fpp);
+void fail (struct Test *t, const char *why);
+int slower (const struct Test *t);
+void read_base (const char *file);
+void write_base (const char *file);
+long find_base (const char *name);
+int report (void);
+char *slurp (const char *path, long *lenp);
+const char *extension (const char *file);
+void *more (void *p, long *maxp, long n, size_t size);
+void nomem (void);
+void usage (void);
+#else
+#define const
+int main ();
+void add_dir ();
+void add_test ();
+int by_name ();
+void make_clean ();
+void run_all ();
+void *worker ();
+long take ();
+void run_test ();
+int from_source ();
+void fail ();
+int slower ();
+void read_base ();
+void write_base ();
+long find_base ();
+int report ();
+char *slurp ();
+const char *extension ();
+void *more ();
+void nomem ();
+void usage ();
+#endif   /* __STDC__ */
+
+const char *Stopname[] = {
+   "running", "BRK", "illegal opcode", "loop", "cycle limit", "out of memory"
+};
+
+int main (argc, argv)
+const int argc;
+const char *argv[];
+{
+   struct stat st;
+   const char *basefile;
+   int update;
+   int nthreads;
+   long n;
+   int a;
+   int status;
+
+   Maxcycles = DEFCYCLES;
+   Resultaddr = RESULTADDR;
+   Loadaddr = ERR;
+   Brkhalt = YES;
+   Slack = 0;
+   Defs = NULL;
+   Rom = NULL;
+   basefile = NULL;
+   update = NO;
+   nthreads = 0;
+
+   for (a = 1; a < argc && argv[a][0] == '-' && argv[a][1] != EOS; a++) {
+      switch (argv[a][1]) {
+      case 'j':
+         if (++a >= argc)
+            usage ();
+
+         nthreads = atoi (argv[a]);    /* Zero for one on each processor */
+         break;
+      case 'c':
+         if (++a >= argc)
+            usage ();
+
+         Maxcycles = strtoul (argv[a], NULL, 0);
+         break;
+      case 'r':
+         if (++a >= argc)
+            usage ();
+
+         Resultaddr = strtol (argv[a], NULL, 0) & 0xffff;
+         break;
+      case 'l':
+         if (++a >= argc)
+            usage ();
+
+         Loadaddr = strtol (argv[a], NULL, 0);   /* Where a binary file goes */
+         break;
+      case 'p':
+         if (++a >= argc)
+            usage ();
+
+         Defs = argv[a];   /* Definitions for every source file */
+         break;
+      case 'R':
+         if (++a >= argc)
+            usage ();
+
+         Rom = argv[a];
+         break;
+      case 'b':
+         if (++a >= argc)
+            usage ();
+
+         basefile = argv[a];
+         break;
+      case 'u':
+         update = YES;     /* Write the new cycle counts to the baseline */
+         break;
+      case 't':
+         if (++a >= argc)
+            usage ();
+
+         Slack = atoi (argv[a]);
+         break;
+      case 'i':
+         Brkhalt = NO;     /* BRK goes through the IRQ vector */
+         break;
+      default:
+         usage ();
+      }
+   }
+
+   if (a >= argc || (update && basefile == NULL))
+      usage ();
+
+   for ( ; a < argc; a++) {
+      if (stat (argv[a], &st) != 0) {
+         fputs (argv[a], stderr);
+         fputs (": can't open\n", stderr);
+         exit (1);
+      }
+
+      if (S_ISDIR (st.st_mode))
+         add_dir (argv[a]);
+      else
+         add_test (NULL, argv[a], strcmp (extension (argv[a]), ".asm") == 0);
+   }
+
+   if (Ntests == 0L) {
+      fputs ("test6502: no tests\n", stderr);
+      exit (1);
+   }
+
+   qsort (Test, Ntests, sizeof (struct Test), by_name);
+
+   if (Defs != NULL && (Deftext = slurp (Defs, &Deflen)) == NULL) {
+      fputs (Defs, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   if (basefile != NULL && access (basefile, F_OK) == 0)
+      read_base (basefile);
+
+   for (n = 0L; n < Ntests; n++)
+      Test[n].Baseline = find_base (Test[n].Name);
+
+   if (nthreads <= 0)
+      nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+
+   make_clean ();
+   run_all (nthreads);
+   sim_release (Clean);
+
+   status = report ();
+
+   if (update)
+      write_base (basefile);
+
+   return (status);
+}
+
+
+/* add_dir --- add the tests in a directory, preferring source to object */
+
+void add_dir (dir)
+const char *dir;
+{
+   DIR *dp;
+   struct dirent *de;
+   const char *ext;
+   long first, n;
+   int pass;
+   size_t len;
+
+   if ((dp = opendir (dir)) == NULL) {
+      fputs (dir, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   first = Ntests;
+
+   /* Source files first, so that their object files can be left out */
+   for (pass = 0; pass < 2; pass++) {
+      rewinddir (dp);
+
+      while ((de = readdir (dp)) != NULL) {
+         ext = extension (de->d_name);
+
+         if (pass == 0) {
+            if (strcmp (ext, ".asm") == 0)
+               add_test (dir, de->d_name, YES);
+         }
+         else if (strcmp (ext, ".hex") == 0 || strcmp (ext, ".s19") == 0 ||
+                  strcmp (ext, ".ihx") == 0 || strcmp (ext, ".bin") == 0) {
+            len = ext - de->d_name;
+
+            for (n = first; n < Ntests; n++)
+               if (Test[n].Source && strlen (Test[n].Name) == len &&
+                   strncmp (Test[n].Name, de->d_name, len) == 0)
+                  break;
+
+            if (n >= Ntests || !Test[n].Source)
+               add_test (dir, de->d_name, NO);
+         }
+      }
+   }
+
+   closedir (dp);
+}
+
+
+/* add_test --- add one test program to the list */
+
+void add_test (dir, file, source)
+const char *dir;
+const char *file;
+const int source;
+{
+   struct Test *t;
+   const char *base;
+   size_t len;
+
+   Test = more (Test, &Maxtests, Ntests + 1, sizeof (struct Test));
+   t = &Test[Ntests++];
+   memset (t, 0, sizeof (struct Test));
+
+   if (dir == NULL) {
+      t->File = strdup (file);
+   }
+   else {
+      t->File = malloc (strlen (dir) + strlen (file) + 2);
+      if (t->File != NULL)
+         sprintf (t->File, "%s/%s", dir, file);
+   }
+
+   if ((base = strrchr (file, '/')) != NULL)
+      base++;
+   else
+      base = file;
+
+   len = extension (base) - base;
+   t->Name = malloc (len + 1);
+
+   if (t->File == NULL || t->Name == NULL)
+      nomem ();
+
+   memcpy (t->Name, base, len);
+   t->Name[len] = EOS;
+
+   t->Source = source;
+   t->Result = ERR;
+   t->Baseline = ERR;
+}
+
+
+/* by_name --- compare two tests for qsort() */
+
+int by_name (a, b)
+const void *a;
+const void *b;
+{
+   const struct Test *p = a;
+   const struct Test *q = b;
+   int cmp;
+
+   if ((cmp = strcmp (p->Name, q->Name)) != 0)
+      return (cmp);
+
+   return (strcmp (p->File, q->File));
+}
+
+
+/* make_clean --- snapshot the memory that every test starts with */
+
+void make_clean ()
+{
+   struct Cpu *cpu;
+   FILE *fp;
+   int bad;
+
+   if ((cpu = sim_new ()) == NULL)
+      nomem ();
+
+   if (Rom != NULL) {
+      if ((fp = fopen (Rom, READBIN)) == NULL) {
+         fputs (Rom, stderr);
+         fputs (": can't open\n", stderr);
+         exit (1);
+      }
+
+      bad = sim_load (cpu, fp, ERR);
+      fclose (fp);
+
+      if (bad != 0)
+         fprintf (stderr, "%s: %d bad records\n", Rom, bad);
+   }
+
+   /* Only what the test itself loads decides where it starts */
+   cpu->Lowaddr = MEMSIZE;
+   cpu->Highaddr = -1L;
+   cpu->Vecset = NO;
+
+   if ((Clean = sim_snapshot (cpu)) == NULL)
+      nomem ();
+
+   sim_free (cpu);
+}
+
+
+/* run_all --- run every test on a pool of threads */
+
+void run_all (nthreads)
+int nthreads;
+{
+   pthread_t *tid;
+   struct Worker *w;
+   int i, j;
+
+   if (nthreads < 1)
+      nthreads = 1;
+
+   if (nthreads > Ntests)
+      nthreads = Ntests;
+
+   Nworkers = nthreads;
+
+   tid = malloc (nthreads * sizeof (pthread_t));
+   w = malloc (nthreads * sizeof (struct Worker));
+   Queue = malloc (nthreads * sizeof (struct Queue));
+   if (tid == NULL || w == NULL || Queue == NULL)
+      nomem ();
+
+   /* Each worker starts with an even share, in order, and steals when it runs out */
+   for (i = 0; i < nthreads; i++) {
+      pthread_mutex_init (&Queue[i].Lock, NULL);
+      Queue[i].Head = (Ntests * i) / nthreads;
+      Queue[i].Tail = (Ntests * (i + 1)) / nthreads;
+
+      w[i].Id = i;
+      w[i].Cpu = sim_fork (Clean);     /* 6502s and contexts are made before any thread starts */
+      w[i].As = as_new ();
+
+      if (w[i].Cpu == NULL || w[i].As == NULL)
+         nomem ();
+
+      w[i].Cpu->Brkhalt = Brkhalt;
+
+      if (Deftext != NULL) {
+         as_source_name (w[i].As, Defs);   /* For its INCLUDE files */
+
+         if (as_predefine (w[i].As, Deftext, Deflen) != 0) {
+            fprintf (stderr, "%s: errors in definitions:\n", Defs);
+
+            for (j = 0; j < as_ndiags (w[i].As); j++)
+               fprintf (stderr, "%s\n", as_diag (w[i].As, j)->Msg);
+
+            exit (1);
+         }
+      }
+   }
+
+   for (i = 1; i < nthreads; i++) {
+      if (pthread_create (&tid[i], NULL, worker, &w[i]) != 0) {
+         fputs ("test6502: can't start thread\n", stderr);
+         exit (1);
+      }
+   }
+
+   worker (&w[0]);      /* This thread does its share too */
+
+   for (i = 1; i < nthreads; i++)
+      pthread_join (tid[i], NULL);
+
+   for (i = 0; i < nthreads; i++) {
+      sim_free (w[i].Cpu);
+      as_free (w[i].As);
+      pthread_mutex_destroy (&Queue[i].Lock);
+   }
+
+   free (Queue);
+   free (w);
+   free (tid);
+}
+
+
+/* worker --- run tests from this worker's queue, then from the others' */
+
+void *worker (arg)
+void *arg;
+{
+   struct Worker *w = arg;
+   long n;
+
+   while ((n = take (w->Id)) != ERR)
+      run_test (w, &Test[n]);
+
+   return (NULL);
+}
+
+
+/* take --- the next test for worker 'id', stolen if need be, or ERR when all are taken */
+
+long take (id)
+const int id;
+{
+   struct Queue *q;
+   long n;
+   int i;
+
+   q = &Queue[id];
+
+   pthread_mutex_lock (&q->Lock);
+   n = (q->Head < q->Tail) ? --q->Tail : ERR;
+   pthread_mutex_unlock (&q->Lock);
+
+   /* Steal from the other end, away from where the owner is working */
+   for (i = 1; n == ERR && i < Nworkers; i++) {
+      q = &Queue[(id + i) % Nworkers];
+
+      pthread_mutex_lock (&q->Lock);
+      if (q->Head < q->Tail)
+         n = q->Head++;
+      pthread_mutex_unlock (&q->Lock);
+   }
+
+   return (n);     /* No test is ever added, so when all are empty we're done */
+}
+
+
+/* run_test --- load or assemble one test, run it and see how it did */
+
+void run_test (w, t)
+struct Worker *w;
+struct Test *t;
+{
+   struct Cpu *cpu = w->Cpu;
+   FILE *fp;
+   int bad;
+   char why[MAXNAME];
+
+   if (t->Source) {
+      if (from_source (w->As, t, &fp) == ERR)
+         return;
+   }
+   else if ((fp = fopen (t->File, READBIN)) == NULL) {
+      fail (t, "can't open");
+      return;
+   }
+
+   sim_restore (cpu, Clean);     /* Copies back only the pages the last test changed */
+   bad = sim_load (cpu, fp, Loadaddr);
+   fclose (fp);
+
+   if (bad != 0) {
+      snprintf (why, sizeof (why), "%d bad records", bad);
+      fail (t, why);
+      return;
+   }
+
+   if (cpu->Highaddr < 0) {
+      fail (t, "nothing to run");
+      return;
+   }
+
+   sim_poke (cpu, Resultaddr, NOTDONE);
+   sim_reset (cpu, cpu->Vecset ? ERR : cpu->Lowaddr);
+   sim_run (cpu, Maxcycles);
+
+   t->Stop = cpu->Stop;
+   t->Pc = cpu->Pc;
+   t->Result = cpu->Mem[Resultaddr];
+   t->Cycles = cpu->Cycles;
+   t->Insns = cpu->Insns;
+
+   if (t->Stop != STOP_BRK && t->Stop != STOP_LOOP) {
+      snprintf (why, sizeof (why), "%s at %04X", Stopname[t->Stop], t->Pc);
+      fail (t, why);
+   }
+   else if (t->Result == NOTDONE) {
+      snprintf (why, sizeof (why), "%s at %04X with no result", Stopname[t->Stop], t->Pc);
+      fail (t, why);
+   }
+   else if (t->Result != 0) {
+      snprintf (why, sizeof (why), "%s at %04X with result $%02X", Stopname[t->Stop], t->Pc, t->Result);
+      fail (t, why);
+   }
+   else if (t->Baseline != ERR && t->Cycles * 100.0 > t->Baseline * (100.0 + Slack)) {
+      snprintf (why, sizeof (why), "slower than baseline of %ld cycles", t->Baseline);
+      fail (t, why);
+   }
+   else {
+      t->Pass = YES;
+   }
+}
+
+
+/* from_source --- assemble a test from source, leaving its object code open to read */
+
+int from_source (as, t, fpp)
+struct Asm *as;
+struct Test *t;
+FILE **fpp;
+{
+   FILE *msgs;
+   const struct Diag *d;
+   const char *obj;
+   char *text;
+   long len;
+   size_t objlen;
+   int errs;
+   int i;
+   char why[MAXNAME];
+
+   if ((text = slurp (t->File, &len)) == NULL) {
+      fail (t, "can't open");
+      return (ERR);
+   }
+
+   as_source_name (as, t->File);   /* For INCLUDE files and messages */
+   errs = as_buffer (as, text, len);
+
+   if (as_ndiags (as) > 0) {
+      if ((msgs = open_memstream (&t->Msgs, &t->Msglen)) == NULL)
+         nomem ();
+
+      for (i = 0; i < as_ndiags (as); i++) {
+         d = as_diag (as, i);
+         fprintf (msgs, "%s\n", d->Msg);
+         if (d->Text != NULL)
+            fprintf (msgs, "%s\n", d->Text);
+      }
+
+      fclose (msgs);
+   }
+
+   free (text);
+
+   if (errs != 0) {
+      snprintf (why, sizeof (why), "%d errors in assembly", errs);
+      fail (t, why);
+      return (ERR);
+   }
+
+   obj = as_object (as, &objlen);
+
+   if (objlen == 0 || (*fpp = fmemopen ((void *)obj, objlen, READ)) == NULL) {
+      fail (t, "no object code");
+      return (ERR);
+   }
+
+   return (OK);
+}
+
+
+/* fail --- record why a test failed */
+
+void fail (t, why)
+struct Test *t;
+const char *why;
+{
+   t->Pass = NO;
+   t->Why = strdup (why);
+   if (t->Why == NULL)
+      nomem ();
+}
+
+
+/* slower --- a test did all it should, but failed only for taking too long */
+
+int slower (t)
+const struct Test *t;
+{
+   return ((t->Stop == STOP_BRK || t->Stop == STOP_LOOP) && t->Result == 0);
+}
+
+
+/* read_base --- read the cycle counts from the last run that was kept */
+
+void read_base (file)
+const char *file;
+{
+   FILE *fp;
+   char lin[BUFSIZ];
+   char name[MAXNAME];
+   unsigned long cycles;
+
+   if ((fp = fopen (file, READ)) == NULL) {
+      fputs (file, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   while (fgets (lin, sizeof (lin), fp) != NULL) {
+      if (lin[0] == '#' || sscanf (lin, "%255s %lu", name, &cycles) != 2)
+         continue;     /* Comment or blank line */
+
+      Base = more (Base, &Maxbase, Nbase + 1, sizeof (struct Base));
+      if ((Base[Nbase].Name = strdup (name)) == NULL)
+         nomem ();
+
+      Base[Nbase++].Cycles = cycles;
+   }
+
+   fclose (fp);
+}
+
+
+/* write_base --- write the cycle counts of the tests that passed, keeping the rest */
+
+void write_base (file)
+const char *file;
+{
+   FILE *fp;
+   long n;
+
+   if ((fp = fopen (file, WRITE)) == NULL) {
+      fputs (file, stderr);
+      fputs (": can't open\n", stderr);
+      exit (1);
+   }
+
+   fputs ("# Cycles taken by each test, from test6502 -u\n", fp);
+
+   for (n = 0L; n < Ntests; n++) {
+      if (Test[n].Pass || slower (&Test[n]))
+         fprintf (fp, "%s %lu\n", Test[n].Name, Test[n].Cycles);
+      else if (Test[n].Baseline != ERR)
+         fprintf (fp, "%s %ld\n", Test[n].Name, Test[n].Baseline);
+   }
+
+   /* Tests that weren't run this time keep their counts */
+   for (n = 0L; n < Nbase; n++) {
+      if (Base[n].Name != NULL)
+         fprintf (fp, "%s %lu\n", Base[n].Name, Base[n].Cycles);
+   }
+
+   fclose (fp);
+}
+
+
+/* find_base --- a test's cycles from the baseline, or ERR; taking it out of the list */
+
+long find_base (name)
+const char *name;
+{
+   long n;
+   long cycles;
+
+   for (n = 0L; n < Nbase; n++) {
+      if (Base[n].Name != NULL && strcmp (Base[n].Name, name) == 0) {
+         cycles = Base[n].Cycles;
+         free (Base[n].Name);
+         Base[n].Name = NULL;
+         return (cycles);
+      }
+   }
+
+   return (ERR);
+}
+
+
+/* report --- print how each test did, in order of name, returning the exit status */
+
+int report ()
+{
+   struct Test *t;
+   long n, npass;
+
+   npass = 0L;
+
+   for (n = 0L; n < Ntests; n++) {
+      t = &Test[n];
+
+      if (t->Msglen != 0) {
+         fprintf (stderr, "%s:\n", t->File);
+         fwrite (t->Msgs, sizeof (char), t->Msglen, stderr);
+      }
+
+      printf ("%s %-24s", t->Pass ? "PASS" : "FAIL", t->Name);
+
+      if (t->Result != ERR) {
+         printf (" %10lu cycles", t->Cycles);
+
+         if (t->Baseline > 0L)
+            printf (" %+6.1f%%", (t->Cycles - (double)t->Baseline) * 100.0 / t->Baseline);
+         else if (t->Baseline == ERR)
+            fputs ("    new", stdout);
+      }
+
+      if (t->Why != NULL)
+         printf ("  %s", t->Why);
+
+      putchar ('\n');
+
+      if (t->Pass)
+         npass++;
+
+      free (t->Why);
+      free (t->Msgs);
+   }
+
+   printf ("%ld tests, %ld passed, %ld failed\n", Ntests, npass, Ntests - npass);
+
+   return (npass == Ntests ? 0 : 1);
+}
+
+
+/* slurp --- read the whole of a file into memory, or NULL */
+
+char *slurp (path, lenp)
+const char *path;
+long *lenp;
+{
+   FILE *fp;
+   char *buf;
+   long max;
+   size_t n;
+
+   if ((fp = fopen (path, READ)) == NULL)
+      return (NULL);
+
+   buf = NULL;
+   max = 0L;
+   *lenp = 0L;
+
+   do {
+      buf = more (buf, &max, *lenp + BUFSIZ, sizeof (char));
+      n = fread (buf + *lenp, sizeof (char), BUFSIZ, fp);
+      *lenp += n;
+   } while (n == BUFSIZ);
+
+   fclose (fp);
+
+   return (buf);
+}
+
+
+/* extension --- the '.' and whatever follows in a file name, or the empty string at its end */
+
+const char *extension (file)
+const char *file;
+{
+   const char *dot, *slash;
+
+   dot = strrchr (file, '.');
+   slash = strrchr (file, '/');
+
+   if (dot == NULL || dot == file || (slash != NULL && dot < slash))
+      return (file + strlen (file));
+
+   return (dot);
+}
+
+
+/* more --- make sure an array has room for 'n' elements */
+
+void *more (p, maxp, n, size)
+void *p;
+long *maxp;
+const long n;
+const size_t size;
+{
+   if (n > *maxp) {
+      *maxp = (*maxp == 0L) ? 64L : *maxp * 2L;
+      if (*maxp < n)
+         *maxp = n;
+
+      if ((p = realloc (p, *maxp * size)) == NULL)
+         nomem ();
+   }
+
+   return (p);
+}
+
+
+/* nomem --- give up for want of memory */
+
+void nomem ()
+{
+   fputs ("test6502: out of memory\n", stderr);
+   exit (1);
+}
+
+
+/* usage --- print a usage message and exit */
+
+void usage ()
+{
+   fputs ("Usage: test6502 [-j threads] [-c maxcycles] [-r resultaddr] [-l loadaddr] [-i]\n", stderr);
+   fputs ("                [-p defs] [-R rom] [-b baseline [-u]] [-t percent] dir-or-file...\n", stderr);
+   exit (1);
+}
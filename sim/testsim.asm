@@ -0,0 +1,191 @@
+; testsim --- test program for the 6502 simulator              2026-10-18
+; Copyright (c) John Honniball. All rights reserved
+
+; This test program runs a few small routines and checks what they
+; leave behind.  It stores zero in the result byte if all is well, or
+; else the number of the first check that went wrong, and then stops
+; at a BRK.  With a memory map it also prints a line on the ACIA and
+; shows the number of checks passed on the LEDs; without one, those
+; stores go to plain memory and do no harm.
+
+ACIA            EQU     $E000             ; 6551 ACIA, as in doc/mmap
+ASTAT           EQU     ACIA+1
+ACTL            EQU     ACIA+3
+TDRE            EQU     $10               ; Transmit register empty
+LEDS            EQU     $E300             ; Front-panel LEDs
+RESULT          EQU     $FFF8             ; Where test6502 looks
+
+PTR             EQU     $20               ; Zero-page pointer
+PROD            EQU     $22               ; 16-bit product
+MPLR            EQU     $24
+SUM             EQU     $25               ; 16-bit sum
+TABLE           EQU     $0280             ; Table to be sorted
+
+                ORG     $0400
+                LDX     #$FF
+                TXS
+                CLD
+                LDA     #$FF
+                STA     RESULT            ; Not finished yet
+                LDA     #TDRE             ; Programmed reset of the ACIA,
+                STA     ASTAT             ;  or room to send without one
+                LDA     #$1F              ; 19200 baud, at 1 MHz
+                STA     ACTL
+
+; Check 1: multiply 123 by 45, by shifting and adding
+                LDA     #45
+                STA     MPLR
+                LDA     #0
+                STA     PROD
+                STA     PROD+1
+                LDX     #8
+MULT            ASL     PROD
+                ROL     PROD+1
+                ASL     MPLR
+                BCC     NOADD
+                CLC
+                LDA     PROD
+                ADC     #123
+                STA     PROD
+                BCC     NOADD
+                INC     PROD+1
+NOADD           DEX
+                BNE     MULT
+                LDA     #1
+                LDX     PROD
+                CPX     #<5535
+                BNE     FAIL
+                LDX     PROD+1
+                CPX     #>5535
+                BNE     FAIL
+                JSR     PASSED
+
+; Check 2: decimal add and subtract
+                SED
+                SEC
+                LDA     #$12
+                SBC     #$34
+                CLD
+                BCS     FAIL2             ; It borrows
+                TAY
+                SED
+                CLC
+                LDA     #$58
+                ADC     #$46
+                CLD
+                BCC     FAIL2             ; It carries
+                TAX
+                LDA     #2
+                CPX     #$04
+                BNE     FAIL
+                CPY     #$78
+                BNE     FAIL
+                JSR     PASSED
+
+; Check 3: add up 1 to 100 in sixteen bits
+                LDA     #0
+                STA     SUM
+                STA     SUM+1
+                LDX     #100
+ADD             TXA
+                CLC
+                ADC     SUM
+                STA     SUM
+                BCC     NOCARRY
+                INC     SUM+1
+NOCARRY         DEX
+                BNE     ADD
+                LDA     #3
+                LDX     SUM
+                CPX     #<5050
+                BNE     FAIL
+                LDX     SUM+1
+                CPX     #>5050
+                BNE     FAIL
+                JSR     PASSED
+                JMP     CHECK4
+
+FAIL2           LDA     #2
+                JMP     FAIL
+FAIL4           LDA     #4
+                JMP     FAIL
+FAIL5           LDA     #5
+FAIL            STA     RESULT            ; Number of the check
+                BRK
+
+; Check 4: copy a table through a pointer and sort it
+CHECK4          LDA     #<UNSORTED
+                STA     PTR
+                LDA     #>UNSORTED
+                STA     PTR+1
+                LDY     #7
+COPY            LDA     (PTR),Y
+                STA     TABLE,Y
+                DEY
+                BPL     COPY
+SORT            LDY     #0                ; No swaps yet
+                LDX     #0
+PAIR            LDA     TABLE,X
+                CMP     TABLE+1,X
+                BCC     INORDER
+                BEQ     INORDER
+                PHA
+                LDA     TABLE+1,X
+                STA     TABLE,X
+                PLA
+                STA     TABLE+1,X
+                INY
+INORDER         INX
+                CPX     #7
+                BNE     PAIR
+                TYA
+                BNE     SORT
+                LDX     #7
+SAME            LDA     TABLE,X
+                CMP     SORTED,X
+                BNE     FAIL4
+                DEX
+                BPL     SAME
+                JSR     PASSED
+
+; Check 5: code that changes its own operand as it runs
+                LDX     #10
+                LDY     #0
+AGAIN           LDA     #0                ; Operand counts up
+                INC     AGAIN+1
+                DEX
+                BNE     AGAIN
+                CMP     #9
+                BNE     FAIL5
+                LDA     AGAIN+1
+                CMP     #10
+                BNE     FAIL5
+                JSR     PASSED
+
+; All done: say so on the ACIA
+                LDX     #0
+PRINT           LDA     MESSAGE,X
+                BEQ     DONE
+                TAY
+WAIT            LDA     ASTAT
+                AND     #TDRE
+                BEQ     WAIT              ; Busy sending the last byte
+                STY     ACIA
+                INX
+                BNE     PRINT
+DONE            LDA     #0
+                STA     RESULT
+                BRK
+
+; PASSED --- count another check passed on the LEDs
+PASSED          INC     COUNT
+                LDA     COUNT
+                STA     LEDS
+                RTS
+
+COUNT           FCB     0
+UNSORTED        FCB     $42,$07,$FF,$00,$80,$07,$13,$7F
+SORTED          FCB     $00,$07,$07,$13,$42,$7F,$80,$FF
+MESSAGE         TEX     "testsim: all checks passed"
+                FCB     $0D,$0A,0
+                END